@@ -0,0 +1,229 @@
+/*
+kextgizmos' pooled async completions for IOUserClient async methods.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTAsyncCompletion.hpp"
+#include <IOKit/IOLib.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOWorkLoop.h>
+
+OSDefineMetaClassAndStructors(DJTAsyncCompletionPool, OSObject);
+
+DJTAsyncCompletionPool* DJTAsyncCompletionPool::withCapacity(uint32_t capacity, IOWorkLoop* work_loop, uint32_t coalesce_window_us)
+{
+	DJTAsyncCompletionPool* pool = OSTypeAlloc(DJTAsyncCompletionPool);
+	if (pool != nullptr && !pool->initWithCapacity(capacity, work_loop, coalesce_window_us))
+		OSSafeReleaseNULL(pool);
+	return pool;
+}
+
+bool DJTAsyncCompletionPool::initWithCapacity(uint32_t capacity, IOWorkLoop* work_loop, uint32_t coalesce_window_us)
+{
+	if (!this->super::init())
+		return false;
+	if (capacity == 0)
+		return false;
+	
+	this->lock = IOLockAlloc();
+	if (this->lock == nullptr)
+		return false;
+	this->completions = static_cast<DJTAsyncCompletion*>(IOMalloc(sizeof(DJTAsyncCompletion) * capacity));
+	if (this->completions == nullptr)
+		return false;
+	this->capacity = capacity;
+	for (uint32_t i = 0; i < capacity; ++i)
+		this->completions[i].next_free = (i + 1 < capacity) ? &this->completions[i + 1] : nullptr;
+	this->free_list = &this->completions[0];
+	
+	if (work_loop != nullptr && coalesce_window_us != 0)
+	{
+		this->coalesce_timer = IOTimerEventSource::timerEventSource(this, coalesceTimerFired);
+		if (this->coalesce_timer == nullptr)
+			return false;
+		if (work_loop->addEventSource(this->coalesce_timer) != kIOReturnSuccess)
+		{
+			OSSafeReleaseNULL(this->coalesce_timer);
+			return false;
+		}
+		work_loop->retain();
+		this->work_loop = work_loop;
+		this->coalesce_window_us = coalesce_window_us;
+	}
+	
+	return true;
+}
+
+void DJTAsyncCompletionPool::free()
+{
+	if (this->lock != nullptr)
+		this->stop();
+	OSSafeReleaseNULL(this->coalesce_timer);
+	if (this->completions != nullptr)
+	{
+		IOFree(this->completions, sizeof(DJTAsyncCompletion) * this->capacity);
+		this->completions = nullptr;
+	}
+	if (this->lock != nullptr)
+	{
+		IOLockFree(this->lock);
+		this->lock = nullptr;
+	}
+	this->super::free();
+}
+
+DJTAsyncCompletion* DJTAsyncCompletionPool::capture(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count)
+{
+	if (wake_port == MACH_PORT_NULL || reference == nullptr || reference_count == 0)
+		return nullptr;
+	if (reference_count > kOSAsyncRef64Count)
+		reference_count = kOSAsyncRef64Count;
+	
+	IOLockLock(this->lock);
+	DJTAsyncCompletion* completion = this->stopped ? nullptr : this->free_list;
+	if (completion != nullptr)
+		this->free_list = completion->next_free;
+	IOLockUnlock(this->lock);
+	if (completion == nullptr)
+		return nullptr;
+	
+	bzero(completion->reference, sizeof(completion->reference));
+	memcpy(completion->reference, reference, reference_count * sizeof(reference[0]));
+	completion->wake_port = wake_port;
+	completion->next_free = nullptr;
+	return completion;
+}
+
+void DJTAsyncCompletionPool::releaseCompletion(DJTAsyncCompletion* completion)
+{
+	assert(completion >= this->completions && completion < this->completions + this->capacity);
+	completion->next_free = this->free_list;
+	this->free_list = completion;
+}
+
+IOReturn DJTAsyncCompletionPool::complete(DJTAsyncCompletion* completion, IOReturn result, io_user_reference_t* args, uint32_t num_args)
+{
+	IOLockLock(this->lock);
+	// Coalesced results queued earlier for the same port must reach the client first
+	if (this->batch_arg_count > 0 && this->batch_port == completion->wake_port)
+		this->sendBatchLocked();
+	IOReturn send_result = IOUserClient::sendAsyncResult64(completion->reference, result, args, num_args);
+	this->releaseCompletion(completion);
+	IOLockUnlock(this->lock);
+	return send_result;
+}
+
+void DJTAsyncCompletionPool::cancel(DJTAsyncCompletion* completion)
+{
+	IOLockLock(this->lock);
+	this->releaseCompletion(completion);
+	IOLockUnlock(this->lock);
+}
+
+void DJTAsyncCompletionPool::completeCoalesced(DJTAsyncCompletion* completion, IOReturn result)
+{
+	bool start_window = false;
+	IOLockLock(this->lock);
+	if (this->batch_arg_count > 0 && this->batch_port != completion->wake_port)
+		this->sendBatchLocked();
+	if (this->batch_arg_count == 0)
+	{
+		memcpy(this->batch_reference, completion->reference, sizeof(this->batch_reference));
+		this->batch_port = completion->wake_port;
+		start_window = true;
+	}
+	this->batch_args[this->batch_arg_count++] = completion->reference[kIOAsyncCalloutRefconIndex];
+	this->batch_args[this->batch_arg_count++] = static_cast<io_user_reference_t>(result);
+	this->releaseCompletion(completion);
+	
+	if (this->batch_arg_count >= 2 * DJT_ASYNC_COALESCE_MAX)
+		this->sendBatchLocked();
+	else if (start_window && this->coalesce_timer != nullptr && !this->stopped)
+		this->coalesce_timer->setTimeoutUS(this->coalesce_window_us);
+	IOLockUnlock(this->lock);
+}
+
+void DJTAsyncCompletionPool::sendBatchLocked()
+{
+	if (this->batch_arg_count == 0)
+		return;
+	IOUserClient::sendAsyncResult64(this->batch_reference, kIOReturnSuccess, this->batch_args, this->batch_arg_count);
+	this->batch_arg_count = 0;
+	this->batch_port = MACH_PORT_NULL;
+}
+
+void DJTAsyncCompletionPool::flush()
+{
+	IOLockLock(this->lock);
+	this->sendBatchLocked();
+	IOLockUnlock(this->lock);
+}
+
+void DJTAsyncCompletionPool::coalesceTimerFired(OSObject* owner, IOTimerEventSource*)
+{
+	DJTAsyncCompletionPool* pool = OSDynamicCast(DJTAsyncCompletionPool, owner);
+	if (pool != nullptr)
+		pool->flush();
+}
+
+void DJTAsyncCompletionPool::stop()
+{
+	IOLockLock(this->lock);
+	this->stopped = true;
+	this->sendBatchLocked();
+	IOLockUnlock(this->lock);
+	
+	if (this->coalesce_timer != nullptr)
+	{
+		this->coalesce_timer->cancelTimeout();
+		if (this->work_loop != nullptr)
+			this->work_loop->removeEventSource(this->coalesce_timer);
+	}
+	OSSafeReleaseNULL(this->work_loop);
+}
@@ -0,0 +1,140 @@
+/*
+kextgizmos' pooled async completions for IOUserClient async methods, with
+optional coalescing of completions into fewer notification messages.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <IOKit/IOUserClient.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+
+class IOWorkLoop;
+class IOTimerEventSource;
+class DJTAsyncCompletionPool;
+
+/* A captured async argument triple, as received by a userclient_method with a
+ * (mach_port_t, io_user_reference_t*, uint32_t) parameter sequence. Obtained
+ * from and returned to a DJTAsyncCompletionPool; never allocated per call. */
+struct DJTAsyncCompletion
+{
+	OSAsyncReference64 reference;
+	mach_port_t wake_port;
+	DJTAsyncCompletion* next_free;
+};
+
+/* Fixed-size pool of DJTAsyncCompletions, typically one per user client.
+ *
+ * complete() sends one async result per completion, like a hand-rolled
+ * sendAsyncResult64(), after first sending any coalesced batch pending for
+ * the same port, so the client sees results in completion order.
+ * completeCoalesced() instead queues the completion's refcon and result, and
+ * sends all queued completions for the same port as a single message once
+ * DJT_ASYNC_COALESCE_MAX have accumulated, when the coalescing window (started
+ * by the first queued completion) expires, or when a completion for a
+ * different port arrives. The message is delivered
+ * to the callback of the first completion in the batch, with kIOReturnSuccess
+ * as the result and the arguments being (refcon, IOReturn) pairs, one per
+ * completion in the batch, oldest first. The client must therefore use the
+ * same callback for all coalesced methods and dispatch on the refcon.
+ *
+ * Call stop() from clientClose()/clientDied(). */
+class DJTAsyncCompletionPool : public OSObject
+{
+	OSDeclareDefaultStructors(DJTAsyncCompletionPool);
+private:
+	typedef OSObject super;
+	
+	IOLock* lock;
+	DJTAsyncCompletion* completions;
+	DJTAsyncCompletion* free_list;
+	uint32_t capacity;
+	
+	IOWorkLoop* work_loop;
+	IOTimerEventSource* coalesce_timer;
+	uint32_t coalesce_window_us;
+	// Pending coalesced batch, protected by lock
+	OSAsyncReference64 batch_reference;
+	mach_port_t batch_port;
+	io_user_reference_t batch_args[kMaxAsyncArgs];
+	uint32_t batch_arg_count;
+	bool stopped;
+	
+	void releaseCompletion(DJTAsyncCompletion* completion);
+	void sendBatchLocked();
+	static void coalesceTimerFired(OSObject* owner, IOTimerEventSource* sender);
+
+public:
+	// Completions per coalesced message, each taking 2 async arguments
+	static const uint32_t DJT_ASYNC_COALESCE_MAX = kMaxAsyncArgs / 2;
+	
+	/* If work_loop is null, or coalesce_window_us 0, completeCoalesced() only
+	 * batches up to DJT_ASYNC_COALESCE_MAX and otherwise relies on flush(). */
+	static DJTAsyncCompletionPool* withCapacity(uint32_t capacity, IOWorkLoop* work_loop = nullptr, uint32_t coalesce_window_us = 0);
+	virtual bool initWithCapacity(uint32_t capacity, IOWorkLoop* work_loop, uint32_t coalesce_window_us);
+	virtual void free() override;
+	
+	/* Copies the async triple into a pooled completion. Returns null if the
+	 * arguments are invalid or the pool is exhausted or stopped; methods should
+	 * then fail with kIOReturnNoResources. */
+	DJTAsyncCompletion* capture(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count);
+	
+	// Sends the async result immediately and returns the completion to the pool.
+	IOReturn complete(DJTAsyncCompletion* completion, IOReturn result, io_user_reference_t* args = nullptr, uint32_t num_args = 0);
+	// Queues the result for a coalesced message and returns the completion to the pool.
+	void completeCoalesced(DJTAsyncCompletion* completion, IOReturn result);
+	// Returns the completion to the pool without notifying the client.
+	void cancel(DJTAsyncCompletion* completion);
+	
+	// Sends any pending coalesced message now.
+	void flush();
+	// Flushes, detaches from the work loop and refuses further captures.
+	void stop();
+};
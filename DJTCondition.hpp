@@ -0,0 +1,214 @@
+/*
+kextgizmos' condition variable on top of DJTLock, with keyed waits and
+targeted notification, for waking only as many waiters as there is work for.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "DJTLock.hpp"
+
+/* All functions must be called with the DJTLock held. Waiters always re-check
+ * their predicate under the lock, so spurious and stolen wakeups are harmless
+ * and no wakeup can be lost between the check and going to sleep.
+ *
+ * A key identifies a particular wait queue, e.g. the address of the resource
+ * being waited for, so notifying one key doesn't wake threads waiting on
+ * another. Keys are only compared by address, and default to the condition
+ * object itself. Waiter counts are tracked per key, so notifying a key
+ * nobody is waiting on costs nothing, and notifyN() wakes at most as many
+ * threads as are waiting. Up to DJT_CONDITION_TRACKED_KEYS keys with waiters
+ * are tracked exactly; waiters on further keys at the same time are counted
+ * as potentially waiting on any key. */
+#define DJT_CONDITION_TRACKED_KEYS 4
+
+class DJTCondition
+{
+	DJTCondition(const DJTCondition&) = delete;
+	DJTCondition& operator=(const DJTCondition&) = delete;
+	
+	struct key_waiters
+	{
+		void* event;
+		uint32_t count; // entry is free if 0
+	};
+	
+	DJTLock* lock;
+	// Waiter counts, protected by the lock.
+	key_waiters keys[DJT_CONDITION_TRACKED_KEYS];
+	// Waiters on keys that didn't fit in keys[].
+	uint32_t untracked_waiters;
+	
+	void* eventForKey(const void* key) const
+	{
+		return const_cast<void*>(key != nullptr ? key : static_cast<const void*>(this));
+	}
+	
+	// Returns the counter to decrement once the waiter wakes up.
+	uint32_t* addWaiter(void* event)
+	{
+		key_waiters* free_entry = nullptr;
+		for (unsigned i = 0; i < DJT_CONDITION_TRACKED_KEYS; ++i)
+		{
+			key_waiters* entry = &this->keys[i];
+			if (entry->count == 0)
+			{
+				if (free_entry == nullptr)
+					free_entry = entry;
+			}
+			else if (entry->event == event)
+			{
+				++entry->count;
+				return &entry->count;
+			}
+		}
+		if (free_entry == nullptr)
+		{
+			++this->untracked_waiters;
+			return &this->untracked_waiters;
+		}
+		free_entry->event = event;
+		free_entry->count = 1;
+		return &free_entry->count;
+	}
+	
+	uint32_t waitersForEvent(void* event) const
+	{
+		uint32_t waiters = this->untracked_waiters;
+		for (unsigned i = 0; i < DJT_CONDITION_TRACKED_KEYS; ++i)
+		{
+			if (this->keys[i].count != 0 && this->keys[i].event == event)
+				waiters += this->keys[i].count;
+		}
+		return waiters;
+	}
+
+public:
+	// Retains the lock.
+	explicit DJTCondition(DJTLock* _lock) :
+		lock(_lock), keys(), untracked_waiters(0)
+	{
+		assert(_lock != nullptr);
+		_lock->retain();
+	}
+	
+	~DJTCondition()
+	{
+#ifndef NDEBUG
+		for (unsigned i = 0; i < DJT_CONDITION_TRACKED_KEYS; ++i)
+			assert(this->keys[i].count == 0);
+#endif
+		assert(this->untracked_waiters == 0);
+		OSSafeReleaseNULL(this->lock);
+	}
+	
+	DJTLock* getLock() const
+	{
+		return this->lock;
+	}
+	
+	// Upper bound on the number of threads waiting on key; exact unless too many keys are in use.
+	uint32_t getWaiterCount(const void* key = nullptr) const
+	{
+		return this->waitersForEvent(this->eventForKey(key));
+	}
+	
+	/* Sleeps until pred() returns true or the absolute deadline (in
+	 * mach_absolute_time() units, see DJTLock::deadlineAfterNanoseconds();
+	 * 0 = no timeout) passes. Returns the final value of pred(), so false
+	 * means timed out or interrupted. */
+	template <typename PRED> bool waitUntil(const void* key, uint64_t deadline_abs, PRED pred, uint32_t interruptible = THREAD_UNINT)
+	{
+		void* event = this->eventForKey(key);
+		while (!pred())
+		{
+			uint32_t* waiters = this->addWaiter(event);
+			int wait_result = this->lock->sleepUntil(event, deadline_abs, interruptible);
+			--*waiters;
+			if (wait_result != THREAD_AWAKENED)
+				return pred();
+		}
+		return true;
+	}
+	
+	template <typename PRED> void wait(const void* key, PRED pred)
+	{
+		this->waitUntil(key, 0, pred, THREAD_UNINT);
+	}
+	
+	void notifyOne(const void* key = nullptr)
+	{
+		void* event = this->eventForKey(key);
+		if (this->waitersForEvent(event) > 0)
+			this->lock->wakeupSleepingThread(event);
+	}
+	
+	void notifyAll(const void* key = nullptr)
+	{
+		void* event = this->eventForKey(key);
+		if (this->waitersForEvent(event) > 0)
+			this->lock->wakeupAllSleepingThreads(event);
+	}
+	
+	// Wakes up to count threads waiting on key, e.g. one per new work item.
+	void notifyN(const void* key, uint32_t count)
+	{
+		void* event = this->eventForKey(key);
+		uint32_t waiters = this->waitersForEvent(event);
+		if (waiters == 0 || count == 0)
+			return;
+		if (count >= waiters)
+		{
+			this->lock->wakeupAllSleepingThreads(event);
+			return;
+		}
+		for (uint32_t i = 0; i < count; ++i)
+			this->lock->wakeupSleepingThread(event);
+	}
+};
@@ -0,0 +1,196 @@
+/*
+kextgizmos' epoch-based (RCU-style) publication of OSObject pointers.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTEpochPointer.hpp"
+#include "DJTPerCPU.hpp"
+#include <IOKit/IOLib.h>
+
+OSDefineMetaClassAndStructors(DJTEpochPointer, OSObject);
+
+// Number of active readers in each of the two epoch parities.
+struct djt_epoch_reader_counts
+{
+	uint32_t active[2];
+};
+
+// Per-CPU reader counts. Readers which land on the same slot (more CPUs than
+// slots, or preemption and migration) remain correct, they just share a cache
+// line, so unlike DJTPerCPU's, slots aren't locked: a reader may be preempted
+// or migrate inside its read section and still decrement the count it
+// incremented.
+struct DJTEpochPointer::reader_slots : DJTPerCPUArray<djt_epoch_reader_counts, DJT_PERCPU_DEFAULT_SLOTS>
+{
+};
+
+// Spin this many times waiting for readers before falling back to sleeping.
+static const unsigned DJT_EPOCH_SPIN_LIMIT = 1000;
+
+DJTEpochPointer* DJTEpochPointer::withObject(OSObject* initial_object)
+{
+	DJTEpochPointer* pointer = OSTypeAlloc(DJTEpochPointer);
+	if (pointer != nullptr && !pointer->initWithObject(initial_object))
+		OSSafeReleaseNULL(pointer);
+	return pointer;
+}
+
+bool DJTEpochPointer::initWithObject(OSObject* initial_object)
+{
+	if (!this->super::init())
+		return false;
+	
+	this->writer_lock = IOLockAlloc();
+	if (this->writer_lock == nullptr)
+		return false;
+	
+	this->slots = static_cast<reader_slots*>(IOMallocAligned(sizeof(reader_slots), alignof(reader_slots)));
+	if (this->slots == nullptr)
+		return false;
+	bzero(static_cast<void*>(this->slots), sizeof(reader_slots));
+	
+	this->epoch = 0;
+	if (initial_object != nullptr)
+		initial_object->retain();
+	this->current = initial_object;
+	
+	return true;
+}
+
+void DJTEpochPointer::free()
+{
+	OSSafeReleaseNULL(this->current);
+	if (this->slots != nullptr)
+	{
+		IOFreeAligned(this->slots, sizeof(reader_slots));
+		this->slots = nullptr;
+	}
+	if (this->writer_lock != nullptr)
+	{
+		IOLockFree(this->writer_lock);
+		this->writer_lock = nullptr;
+	}
+	this->super::free();
+}
+
+DJTEpochPointer::read_section DJTEpochPointer::readLock()
+{
+	read_section section;
+	section.slot = reader_slots::currentSlotHint();
+	section.parity = __atomic_load_n(&this->epoch, __ATOMIC_RELAXED) & 1u;
+	// Must be globally visible before we load the pointer, so the writer either
+	// sees us or we see its new pointer.
+	__atomic_fetch_add(&(*this->slots)[section.slot].active[section.parity], 1, __ATOMIC_SEQ_CST);
+	return section;
+}
+
+void DJTEpochPointer::readUnlock(read_section section)
+{
+	__atomic_fetch_sub(&(*this->slots)[section.slot].active[section.parity], 1, __ATOMIC_RELEASE);
+}
+
+OSObject* DJTEpochPointer::getObject() const
+{
+	return __atomic_load_n(&this->current, __ATOMIC_SEQ_CST);
+}
+
+OSObject* DJTEpochPointer::copyObject()
+{
+	read_section section = this->readLock();
+	OSObject* object = this->getObject();
+	if (object != nullptr)
+		object->retain();
+	this->readUnlock(section);
+	return object;
+}
+
+void DJTEpochPointer::waitForReaders(uint32_t parity)
+{
+	unsigned spins = 0;
+	for (uint32_t i = 0; i < reader_slots::slotCount(); ++i)
+	{
+		while (__atomic_load_n(&(*this->slots)[i].active[parity], __ATOMIC_SEQ_CST) != 0)
+		{
+			if (spins < DJT_EPOCH_SPIN_LIMIT)
+			{
+				++spins;
+				DJT_CPU_RELAX();
+			}
+			else
+			{
+				IOSleep(1);
+			}
+		}
+	}
+}
+
+void DJTEpochPointer::synchronize()
+{
+	IOLockLock(this->writer_lock);
+	
+	uint32_t cur_epoch = __atomic_load_n(&this->epoch, __ATOMIC_RELAXED);
+	/* Readers that sampled the epoch just before the previous flip may only just
+	 * have registered in the inactive parity; they could hold the pointer
+	 * we're about to retire, so drain them first. */
+	this->waitForReaders((cur_epoch + 1) & 1u);
+	// New readers now go to the other parity, so this one will drain.
+	__atomic_store_n(&this->epoch, cur_epoch + 1, __ATOMIC_SEQ_CST);
+	this->waitForReaders(cur_epoch & 1u);
+	
+	IOLockUnlock(this->writer_lock);
+}
+
+void DJTEpochPointer::replace(OSObject* new_object)
+{
+	if (new_object != nullptr)
+		new_object->retain();
+	OSObject* old_object = __atomic_exchange_n(&this->current, new_object, __ATOMIC_SEQ_CST);
+	this->synchronize();
+	OSSafeReleaseNULL(old_object);
+}
@@ -0,0 +1,144 @@
+/*
+kextgizmos' epoch-based (RCU-style) publication of OSObject pointers. For hot
+paths that read an object, e.g. a configuration OSDictionary, which is only
+occasionally replaced.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+
+/* Readers bracket their accesses with readLock()/readUnlock() (or use
+ * DJTEpochReadGuard), and may use the current object without retaining it until
+ * they leave the read section. Entering and leaving only touch a counter
+ * belonging to the current CPU, so readers on different CPUs don't contend.
+ * 
+ * replace() publishes a new object and then waits for a grace period: until
+ * every reader that might still be using the old object has left its read
+ * section. Only then is the old object released. Writers are serialized and
+ * must be able to block, while readers never block on writers.
+ *
+ * Read sections must be short and must not sleep, as they hold up writers.
+ * Readers must not call replace() from inside a read section (deadlock).
+ * Retain the object (or use copyObject()) if it's needed beyond the read
+ * section. */
+class DJTEpochPointer : public OSObject
+{
+	OSDeclareDefaultStructors(DJTEpochPointer);
+private:
+	typedef OSObject super;
+	
+	struct reader_slots;
+	
+	OSObject* current;
+	uint32_t epoch;
+	reader_slots* slots;
+	IOLock* writer_lock;
+	
+	void waitForReaders(uint32_t parity);
+
+public:
+	struct read_section
+	{
+		uint32_t slot;
+		uint32_t parity;
+	};
+
+	static DJTEpochPointer* withObject(OSObject* initial_object);
+	// initial_object may be null; it is retained if not.
+	virtual bool initWithObject(OSObject* initial_object);
+	virtual void free() override;
+	
+	read_section readLock();
+	void readUnlock(read_section section);
+	// Must only be called inside a read section; result is not retained.
+	OSObject* getObject() const;
+	// Returns a retained reference which outlives the read section.
+	OSObject* copyObject();
+	
+	// Retains new_object, blocks until a grace period has elapsed, then releases the old object.
+	void replace(OSObject* new_object);
+	// Blocks until all read sections in progress at the time of the call have ended.
+	void synchronize();
+};
+
+/* Does NOT retain the DJTEpochPointer, as that would defeat the point; the
+ * caller must ensure it stays alive for the lifetime of the guard. */
+class DJTEpochReadGuard
+{
+	DJTEpochReadGuard(const DJTEpochReadGuard&) = delete;
+	DJTEpochPointer* pointer;
+	DJTEpochPointer::read_section section;
+	
+public:
+	DJTEpochReadGuard(DJTEpochPointer* _pointer) :
+		pointer(_pointer), section()
+	{
+		if (_pointer != nullptr)
+			this->section = _pointer->readLock();
+	}
+	
+	~DJTEpochReadGuard()
+	{
+		if (this->pointer != nullptr)
+			this->pointer->readUnlock(this->section);
+	}
+	
+	OSObject* getObject() const
+	{
+		return this->pointer != nullptr ? this->pointer->getObject() : nullptr;
+	}
+	
+	template <class T> T* getObjectAs() const
+	{
+		return OSDynamicCast(T, this->getObject());
+	}
+};
@@ -0,0 +1,224 @@
+/*
+kextgizmos' flat combining wrapper. Lets many threads apply operations to a
+shared data structure with one lock acquisition per batch of operations,
+rather than one per operation.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "DJTLock.hpp"
+#include "DJTPerCPU.hpp"
+
+/* Threads publish an operation in a request slot and then try to acquire the
+ * lock. Whichever thread gets it becomes the combiner and executes all
+ * published operations, including those of other threads, before releasing the
+ * lock. The other threads spin on their own slot until their operation has been
+ * executed, and only contend for the lock if no combiner is running (or they've
+ * waited for a long time). The protected data therefore stays in the
+ * combiner's cache and the lock changes hands once per batch.
+ *
+ * Operations run with the lock held on an arbitrary thread, so they must not
+ * depend on the calling thread's identity and should be short. They may not
+ * call execute() on the same combiner. Code which accesses the data directly
+ * (not via execute()) must hold the same DJTLock.
+ *
+ * NUM_SLOTS should be at least the number of CPUs; if all slots are busy,
+ * callers skip publishing and run their operation under the lock directly. */
+template <typename T, unsigned NUM_SLOTS = 64> class DJTFlatCombiner
+{
+public:
+	typedef IOReturn (*operation_fn)(T* data, void* context);
+
+private:
+	DJTFlatCombiner(const DJTFlatCombiner&) = delete;
+	DJTFlatCombiner& operator=(const DJTFlatCombiner&) = delete;
+	
+	enum
+	{
+		SLOT_FREE = 0,
+		SLOT_CLAIMED,
+		SLOT_PENDING,
+		SLOT_DONE,
+	};
+	
+	struct request_slot
+	{
+		uint32_t state;
+		IOReturn result;
+		operation_fn function;
+		void* context;
+	};
+	
+	// Number of passes over the slots a combiner makes, to pick up operations
+	// published while it was combining.
+	static const unsigned COMBINE_PASSES = 2;
+	// Spin this many times on our slot before blocking on the lock.
+	static const unsigned SPIN_LIMIT = 2000;
+	// Upper bound on spins between failed tryLock() attempts.
+	static const unsigned TRY_LOCK_BACKOFF_LIMIT = 64;
+	
+	/* Not DJTPerCPU itself: the state field is the slot's lock, and the owner
+	 * and the combiner each hold it for part of a request's lifetime. */
+	DJTPerCPUArray<request_slot, NUM_SLOTS> slots;
+	T* data;
+	DJTLock* lock;
+	// Non-zero while a combiner is running; waiters don't touch the lock then.
+	alignas(DJT_CACHE_LINE_SIZE) uint32_t combining;
+	
+	// Returns nullptr if a pass over all slots found none free.
+	request_slot* claimSlot()
+	{
+		unsigned index = this->slots.currentSlotHint();
+		for (unsigned i = 0; i < NUM_SLOTS; ++i)
+		{
+			request_slot* slot = &this->slots[(index + i) % NUM_SLOTS];
+			uint32_t expected = SLOT_FREE;
+			if (__atomic_load_n(&slot->state, __ATOMIC_RELAXED) == SLOT_FREE
+			    && __atomic_compare_exchange_n(&slot->state, &expected, SLOT_CLAIMED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				return slot;
+		}
+		return nullptr;
+	}
+	
+	// Must be called with the lock held.
+	void combine()
+	{
+		__atomic_store_n(&this->combining, 1, __ATOMIC_RELAXED);
+		for (unsigned pass = 0; pass < COMBINE_PASSES; ++pass)
+		{
+			for (unsigned i = 0; i < NUM_SLOTS; ++i)
+			{
+				request_slot* slot = &this->slots[i];
+				if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != SLOT_PENDING)
+					continue;
+				slot->result = slot->function(this->data, slot->context);
+				__atomic_store_n(&slot->state, SLOT_DONE, __ATOMIC_RELEASE);
+			}
+		}
+		__atomic_store_n(&this->combining, 0, __ATOMIC_RELAXED);
+	}
+
+public:
+	// Retains the lock. The data pointer must remain valid for the lifetime of the combiner.
+	DJTFlatCombiner(T* _data, DJTLock* _lock) :
+		slots(), data(_data), lock(_lock), combining(0)
+	{
+		assert(_lock != nullptr);
+		_lock->retain();
+	}
+	
+	~DJTFlatCombiner()
+	{
+		OSSafeReleaseNULL(this->lock);
+	}
+	
+	// Runs function(data, context) under the lock and returns its result.
+	IOReturn execute(operation_fn function, void* context)
+	{
+		request_slot* slot = this->claimSlot();
+		if (slot == nullptr)
+		{
+			// More callers than slots; run ours directly, and anyone else's while we're at it
+			this->lock->lock();
+			IOReturn result = function(this->data, context);
+			this->combine();
+			this->lock->unlock();
+			return result;
+		}
+		slot->function = function;
+		slot->context = context;
+		__atomic_store_n(&slot->state, SLOT_PENDING, __ATOMIC_RELEASE);
+		
+		/* Spin on our own slot (a plain load), and only try for the lock while
+		 * no combiner is running, as a running one will likely get to our
+		 * request. Each failed tryLock() doubles the spins until the next
+		 * attempt, so waiters don't keep bouncing the lock's cache line
+		 * between them while it's held outside of combining. */
+		unsigned spins = 0;
+		unsigned next_try = 0;
+		unsigned backoff = 1;
+		while (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != SLOT_DONE)
+		{
+			if (spins < SPIN_LIMIT)
+			{
+				++spins;
+				if (spins < next_try || __atomic_load_n(&this->combining, __ATOMIC_RELAXED) != 0)
+				{
+					DJT_CPU_RELAX();
+					continue;
+				}
+				if (!this->lock->tryLock())
+				{
+					if (backoff < TRY_LOCK_BACKOFF_LIMIT)
+						backoff *= 2;
+					next_try = spins + backoff;
+					DJT_CPU_RELAX();
+					continue;
+				}
+			}
+			else
+			{
+				// Lock is probably held by someone not combining; wait our turn
+				this->lock->lock();
+			}
+			this->combine();
+			this->lock->unlock();
+		}
+		
+		IOReturn result = slot->result;
+		__atomic_store_n(&slot->state, SLOT_FREE, __ATOMIC_RELEASE);
+		return result;
+	}
+	
+	DJTLock* getLock() const
+	{
+		return this->lock;
+	}
+};
@@ -51,6 +51,8 @@ misrepresented as being the original software.
 */
 
 #include "DJTLock.hpp"
+#include "djt_cpu_hints.h"
+#include <IOKit/IOLib.h>
 
 OSDefineMetaClassAndStructors(DJTLock, OSObject);
 
@@ -85,22 +87,78 @@ void DJTLock::unlock()
 	assert(this->lock_obj != nullptr);
 	IOLockUnlock(this->lock_obj);
 }
+bool DJTLock::tryLock()
+{
+	assert(this->lock_obj != nullptr);
+	return IOLockTryLock(this->lock_obj);
+}
 
-static AbsoluteTime timeout_deadline(uint64_t nanoseconds)
+static uint64_t timeout_deadline_abs(uint64_t nanoseconds)
 {
 	uint64_t absinterval, deadline;
 	nanoseconds_to_absolutetime(nanoseconds, &absinterval);
 	clock_absolutetime_interval_to_deadline(absinterval, &deadline);
+	return deadline;
+}
+static AbsoluteTime timeout_deadline(uint64_t nanoseconds)
+{
+	uint64_t deadline = timeout_deadline_abs(nanoseconds);
 	return *(AbsoluteTime*)&deadline;
 }
 
+// Spin this many times before backing off to sleeping between attempts.
+static const unsigned DJT_LOCK_DEADLINE_SPIN_LIMIT = 1000;
+
+bool DJTLock::lockWithDeadline(uint64_t deadline_nsec)
+{
+	assert(this->lock_obj != nullptr);
+	if (IOLockTryLock(this->lock_obj))
+		return true;
+	
+	uint64_t deadline = timeout_deadline_abs(deadline_nsec);
+	unsigned attempts = 0;
+	while (true)
+	{
+		if (attempts < DJT_LOCK_DEADLINE_SPIN_LIMIT)
+		{
+			++attempts;
+			DJT_CPU_RELAX();
+		}
+		else
+		{
+			IOSleep(1);
+		}
+		
+		if (IOLockTryLock(this->lock_obj))
+			return true;
+		if (mach_absolute_time() >= deadline)
+			return false;
+	}
+}
+
 void DJTLock::sleepWithDeadline(void* event, uint64_t deadline_nsec, uint32_t interruptible)
 {
 	AbsoluteTime deadline = timeout_deadline(deadline_nsec);
 	IOLockSleepDeadline(this->lock_obj, event, deadline, interruptible);
 }
 
+int DJTLock::sleepUntil(void* event, uint64_t deadline_abs, uint32_t interruptible)
+{
+	if (deadline_abs == 0)
+		return IOLockSleep(this->lock_obj, event, interruptible);
+	return IOLockSleepDeadline(this->lock_obj, event, *(AbsoluteTime*)&deadline_abs, interruptible);
+}
+
 void DJTLock::wakeupSleepingThread(void *event)
 {
 	IOLockWakeup(this->lock_obj, event, true /* one thread (singular function) */);
 }
+void DJTLock::wakeupAllSleepingThreads(void *event)
+{
+	IOLockWakeup(this->lock_obj, event, false /* all threads */);
+}
+
+uint64_t DJTLock::deadlineAfterNanoseconds(uint64_t nsec)
+{
+	return timeout_deadline_abs(nsec);
+}
@@ -68,10 +68,24 @@ public:
 	
 	void lock();
 	void unlock();
+	// Acquires the lock only if that's possible without blocking.
+	bool tryLock();
+	/* Gives up and returns false if the lock could not be acquired within
+	 * deadline_nsec nanoseconds from now. IOLock has no timed acquire, so this
+	 * polls with backoff; don't use it for precise timeouts. */
+	bool lockWithDeadline(uint64_t deadline_nsec);
 
 	// Must only be called with lock held, will temporarily release while sleeping
 	void sleepWithDeadline(void* event, uint64_t deadline_nsec, uint32_t interruptible = THREAD_UNINT);
+	/* Same, but with an absolute deadline in mach_absolute_time() units (0 for
+	 * no timeout). Returns THREAD_AWAKENED, THREAD_TIMED_OUT or
+	 * THREAD_INTERRUPTED. */
+	int sleepUntil(void* event, uint64_t deadline_abs, uint32_t interruptible = THREAD_UNINT);
 	void wakeupSleepingThread(void* event);
+	void wakeupAllSleepingThreads(void* event);
+	
+	// Absolute deadline for sleepUntil(), nanoseconds from now.
+	static uint64_t deadlineAfterNanoseconds(uint64_t nsec);
 };
 
 class DJTLockGuard
@@ -104,3 +118,86 @@ public:
 		return this->lock;
 	}
 };
+
+/* Like DJTLockGuard, but doesn't retain the lock, saving two atomic operations
+ * per critical section. Only for callers that are guaranteed to hold a
+ * reference to the lock for the guard's whole lifetime. The guard is movable,
+ * so it can be returned from functions, and it can be constructed without
+ * acquiring the lock, via tryLock()/lockWithDeadline(). Check ownsLock() in that
+ * case. */
+class DJTUnretainedLockGuard
+{
+	DJTUnretainedLockGuard(const DJTUnretainedLockGuard&) = delete;
+	DJTUnretainedLockGuard& operator=(const DJTUnretainedLockGuard&) = delete;
+	DJTLock* lock;
+	
+	struct adopt_lock_t {};
+	DJTUnretainedLockGuard(DJTLock* _lock, adopt_lock_t) :
+		lock(_lock)
+	{
+	}
+	
+public:
+	DJTUnretainedLockGuard(DJTLock* _lock) :
+		lock(_lock)
+	{
+		if (_lock != nullptr)
+			_lock->lock();
+	}
+	
+	DJTUnretainedLockGuard(DJTUnretainedLockGuard&& other) :
+		lock(other.lock)
+	{
+		other.lock = nullptr;
+	}
+	
+	DJTUnretainedLockGuard& operator=(DJTUnretainedLockGuard&& other)
+	{
+		if (this != &other)
+		{
+			this->unlock();
+			this->lock = other.lock;
+			other.lock = nullptr;
+		}
+		return *this;
+	}
+	
+	~DJTUnretainedLockGuard()
+	{
+		this->unlock();
+	}
+	
+	static DJTUnretainedLockGuard tryLock(DJTLock* lock)
+	{
+		if (lock != nullptr && lock->tryLock())
+			return DJTUnretainedLockGuard(lock, adopt_lock_t());
+		return DJTUnretainedLockGuard(nullptr, adopt_lock_t());
+	}
+	
+	static DJTUnretainedLockGuard lockWithDeadline(DJTLock* lock, uint64_t deadline_nsec)
+	{
+		if (lock != nullptr && lock->lockWithDeadline(deadline_nsec))
+			return DJTUnretainedLockGuard(lock, adopt_lock_t());
+		return DJTUnretainedLockGuard(nullptr, adopt_lock_t());
+	}
+	
+	// Releases the lock before the guard goes out of scope.
+	void unlock()
+	{
+		if (this->lock != nullptr)
+		{
+			this->lock->unlock();
+			this->lock = nullptr;
+		}
+	}
+	
+	bool ownsLock() const
+	{
+		return this->lock != nullptr;
+	}
+	
+	DJTLock* getLock() const
+	{
+		return this->lock;
+	}
+};
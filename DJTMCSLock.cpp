@@ -0,0 +1,148 @@
+/*
+kextgizmos' reference-counted MCS queue lock.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTMCSLock.hpp"
+
+OSDefineMetaClassAndStructors(DJTMCSLock, OSObject);
+
+enum
+{
+	DJT_MCS_WAITING = 0,
+	DJT_MCS_PARKED = 1,
+	DJT_MCS_GRANTED = 2,
+};
+
+// Number of spin iterations before a waiter parks itself.
+static const unsigned DJT_MCS_SPIN_LIMIT = 4000;
+
+bool DJTMCSLock::init()
+{
+	if (!this->super::init())
+		return false;
+	
+	this->tail = nullptr;
+	this->park_lock = IOLockAlloc();
+	if (this->park_lock == nullptr)
+		return false;
+	
+	return true;
+}
+void DJTMCSLock::free()
+{
+	assert(this->tail == nullptr);
+	if (this->park_lock != nullptr)
+	{
+		IOLockFree(this->park_lock);
+		this->park_lock = nullptr;
+	}
+	this->super::free();
+}
+
+void DJTMCSLock::lock(DJTMCSLockNode* node)
+{
+	node->next = nullptr;
+	node->state = DJT_MCS_WAITING;
+	
+	DJTMCSLockNode* prev = __atomic_exchange_n(&this->tail, node, __ATOMIC_ACQ_REL);
+	if (prev == nullptr)
+		return; // uncontended
+	
+	__atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+	
+	for (unsigned spins = 0; spins < DJT_MCS_SPIN_LIMIT; ++spins)
+	{
+		if (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) == DJT_MCS_GRANTED)
+			return;
+		DJT_CPU_RELAX();
+	}
+	
+	IOLockLock(this->park_lock);
+	uint32_t expected = DJT_MCS_WAITING;
+	if (__atomic_compare_exchange_n(&node->state, &expected, DJT_MCS_PARKED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		while (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) != DJT_MCS_GRANTED)
+			IOLockSleep(this->park_lock, node, THREAD_UNINT);
+	}
+	IOLockUnlock(this->park_lock);
+}
+
+bool DJTMCSLock::tryLock(DJTMCSLockNode* node)
+{
+	node->next = nullptr;
+	node->state = DJT_MCS_WAITING;
+	DJTMCSLockNode* expected = nullptr;
+	return __atomic_compare_exchange_n(&this->tail, &expected, node, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void DJTMCSLock::unlock(DJTMCSLockNode* node)
+{
+	DJTMCSLockNode* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	if (next == nullptr)
+	{
+		DJTMCSLockNode* expected = node;
+		if (__atomic_compare_exchange_n(&this->tail, &expected, nullptr, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return; // no waiters
+		
+		// A successor has swapped itself into the tail but not linked itself in yet
+		while ((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == nullptr)
+			DJT_CPU_RELAX();
+	}
+	
+	/* After this, the successor may return from lock() and its node may go
+	 * away, so only the node's address may be used (as a wakeup event). */
+	uint32_t prev_state = __atomic_exchange_n(&next->state, DJT_MCS_GRANTED, __ATOMIC_ACQ_REL);
+	if (prev_state == DJT_MCS_PARKED)
+	{
+		IOLockLock(this->park_lock);
+		IOLockWakeup(this->park_lock, next, true /* one thread */);
+		IOLockUnlock(this->park_lock);
+	}
+}
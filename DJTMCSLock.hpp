@@ -0,0 +1,127 @@
+/*
+kextgizmos' reference-counted MCS queue lock. A FIFO alternative to DJTLock for
+heavily contended locks, where each waiter spins on its own cache line.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_cpu_hints.h"
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+
+/* Queue node; one per acquisition. Typically lives on the stack of the thread
+ * acquiring the lock (DJTMCSLockGuard takes care of this) and must stay valid
+ * until the matching unlock() returns. */
+struct alignas(DJT_CACHE_LINE_SIZE) DJTMCSLockNode
+{
+	DJTMCSLockNode* next;
+	uint32_t state;
+};
+
+/* Waiters form a queue and are granted the lock strictly in arrival order. Each
+ * waiter spins only on its own node, so handing over the lock touches one
+ * cache line regardless of the number of waiters. Waiters that spin for too
+ * long park themselves and are woken by their predecessor, so holding the lock
+ * for a long time or getting preempted while holding it doesn't burn CPU in
+ * every waiter. Strict FIFO handoff means a lock convoy if there are more
+ * runnable contenders than CPUs; prefer DJTLock for lightly contended locks.
+ *
+ * Unlike DJTLock, there is no sleep/wakeup support, and the lock can't be used
+ * recursively. */
+class DJTMCSLock : public OSObject
+{
+	OSDeclareDefaultStructors(DJTMCSLock);
+private:
+	typedef OSObject super;
+	
+	DJTMCSLockNode* tail;
+	// Only used by waiters that stop spinning and go to sleep.
+	IOLock* park_lock;
+
+public:
+	virtual bool init() override;
+	virtual void free() override;
+	
+	void lock(DJTMCSLockNode* node);
+	bool tryLock(DJTMCSLockNode* node);
+	void unlock(DJTMCSLockNode* node);
+};
+
+class DJTMCSLockGuard
+{
+	DJTMCSLockGuard(const DJTMCSLockGuard&) = delete;
+	DJTMCSLock* lock;
+	DJTMCSLockNode node;
+	
+public:
+	DJTMCSLockGuard(DJTMCSLock* _lock) :
+		lock(_lock), node()
+	{
+		if (_lock != nullptr)
+		{
+			_lock->retain();
+			_lock->lock(&this->node);
+		}
+	}
+	
+	~DJTMCSLockGuard()
+	{
+		if (this->lock != nullptr)
+		{
+			this->lock->unlock(&this->node);
+			OSSafeReleaseNULL(this->lock);
+		}
+	}
+	
+	DJTMCSLock* getLock() const
+	{
+		return this->lock;
+	}
+};
@@ -0,0 +1,157 @@
+/*
+kextgizmos' intrusive lock-free multi-producer/single-consumer queue. For handing
+work items from interrupt filters or many threads to a single consumer, such
+as an IOWorkLoop action.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/* Items must derive from DJTMPSCQueueLink. An item may only be in one queue at
+ * a time, and the queue doesn't manage item lifetimes or reference counts.
+ *
+ * push() is a single compare-and-swap loop with no locks and no allocation, so
+ * it's safe from primary interrupt context (e.g. an IOFilterInterruptEventSource
+ * filter) as well as from any thread. Only one thread at a time may consume
+ * (drainAll()/takeAll()), which is typically the work loop the producers
+ * signal. The consumer detaches the whole list with one atomic exchange, so
+ * there is no ABA problem, and producers and consumer never wait for each
+ * other.
+ *
+ * Header-only; works in kexts, dexts and user space. */
+struct DJTMPSCQueueLink
+{
+	DJTMPSCQueueLink* mpsc_next;
+};
+
+template <typename T> class DJTMPSCQueue
+{
+	DJTMPSCQueue(const DJTMPSCQueue&) = delete;
+	DJTMPSCQueue& operator=(const DJTMPSCQueue&) = delete;
+	
+	// Most recently pushed item first
+	DJTMPSCQueueLink* head;
+	
+	static DJTMPSCQueueLink* reverse(DJTMPSCQueueLink* list)
+	{
+		DJTMPSCQueueLink* reversed = nullptr;
+		while (list != nullptr)
+		{
+			DJTMPSCQueueLink* next = list->mpsc_next;
+			list->mpsc_next = reversed;
+			reversed = list;
+			list = next;
+		}
+		return reversed;
+	}
+
+public:
+	DJTMPSCQueue() :
+		head(nullptr)
+	{
+	}
+	
+	/* Returns true if the queue was empty, i.e. the consumer needs to be
+	 * signalled. Producers which see false can rely on a signal already being
+	 * pending, as long as the consumer drains until the queue is empty. */
+	bool push(T* item)
+	{
+		DJTMPSCQueueLink* link = static_cast<DJTMPSCQueueLink*>(item);
+		DJTMPSCQueueLink* old_head = __atomic_load_n(&this->head, __ATOMIC_RELAXED);
+		do
+		{
+			link->mpsc_next = old_head;
+		} while (!__atomic_compare_exchange_n(&this->head, &old_head, link, true /* weak */, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		return old_head == nullptr;
+	}
+	
+	bool isEmpty() const
+	{
+		return __atomic_load_n(&this->head, __ATOMIC_RELAXED) == nullptr;
+	}
+	
+	/* Consumer only. Detaches all queued items and returns the oldest; follow
+	 * next() to walk them in the order they were pushed. The returned items
+	 * are no longer part of the queue and may be pushed again. */
+	T* takeAll()
+	{
+		if (this->isEmpty())
+			return nullptr;
+		DJTMPSCQueueLink* list = __atomic_exchange_n(&this->head, nullptr, __ATOMIC_ACQUIRE);
+		return static_cast<T*>(reverse(list));
+	}
+	
+	// For walking a list returned by takeAll(). Read this before re-pushing or freeing item.
+	static T* next(T* item)
+	{
+		return static_cast<T*>(static_cast<DJTMPSCQueueLink*>(item)->mpsc_next);
+	}
+	
+	/* Consumer only. Calls fn(T* item) for every queued item in FIFO order, repeating until
+	 * the queue is observed empty. fn may free or re-push the item. Returns the
+	 * number of items processed. */
+	template <typename FN> unsigned drainAll(FN fn)
+	{
+		unsigned count = 0;
+		T* item;
+		while ((item = this->takeAll()) != nullptr)
+		{
+			do
+			{
+				T* next_item = next(item);
+				fn(item);
+				++count;
+				item = next_item;
+			} while (item != nullptr);
+		}
+		return count;
+	}
+};
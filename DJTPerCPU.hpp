@@ -0,0 +1,233 @@
+/*
+kextgizmos' per-CPU data template. Cache-line padded instances of a type,
+one per CPU, for statistics and caches that would otherwise bounce a shared
+cache line between CPUs. Works in kexts; dexts and user space fall back to
+per-thread slot selection.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_cpu_hints.h"
+#include <stdint.h>
+#ifdef KERNEL
+#include <kern/cpu_number.h>
+#else
+#include <pthread.h>
+#endif
+
+#define DJT_PERCPU_DEFAULT_SLOTS 64
+
+/* Just the slot placement of DJTPerCPU, without the per-slot lock: NUM_SLOTS
+ * instances of T on separate cache lines, and the calling thread's preferred
+ * index. For data structures whose slots are only accessed atomically or
+ * follow their own protocol, which tolerate several threads using the same
+ * slot, or which need to hold on to a slot across calls (DJTEpochPointer's
+ * reader counts, DJTFlatCombiner's request slots). */
+template <typename T, unsigned NUM_SLOTS = DJT_PERCPU_DEFAULT_SLOTS> class DJTPerCPUArray
+{
+	DJTPerCPUArray(const DJTPerCPUArray&) = delete;
+	DJTPerCPUArray& operator=(const DJTPerCPUArray&) = delete;
+	
+	struct alignas(DJT_CACHE_LINE_SIZE) slot
+	{
+		T value;
+	};
+	slot slots[NUM_SLOTS];
+
+public:
+	DJTPerCPUArray() :
+		slots()
+	{
+	}
+	
+	// Index of the slot the calling thread would prefer, i.e. the current CPU (kernel) or a per-thread hash.
+	static unsigned currentSlotHint()
+	{
+#ifdef KERNEL
+		return static_cast<unsigned>(cpu_number()) % NUM_SLOTS;
+#else
+		uintptr_t thread = reinterpret_cast<uintptr_t>(pthread_self());
+		return static_cast<unsigned>((thread >> 4) ^ (thread >> 12)) % NUM_SLOTS;
+#endif
+	}
+	
+	T& operator[](unsigned index)
+	{
+		return this->slots[index].value;
+	}
+	const T& operator[](unsigned index) const
+	{
+		return this->slots[index].value;
+	}
+	
+	static constexpr unsigned slotCount()
+	{
+		return NUM_SLOTS;
+	}
+};
+
+/* NUM_SLOTS instances of T, one per CPU where possible, for exclusive local
+ * access.
+ *
+ * Kexts can't disable preemption via a public KPI, and dexts have no notion
+ * of the current CPU at all. Each slot is therefore guarded by a tiny lock
+ * which is uncontended in the common case. If the preferred slot is busy
+ * (the thread was preempted or migrated while another thread on the CPU was
+ * using it), the next free slot is used instead. Local access is therefore
+ * always exclusive and never waits for long, and the data lives on
+ * CPU-local cache lines nearly all of the time. As a consequence, the
+ * per-slot values are only meaningful in aggregate: use this for data that
+ * can be combined with fold(), such as counters, sums or object caches, and
+ * not for data that must be tied to a specific CPU.
+ *
+ * NUM_SLOTS should be at least the number of CPUs. The storage is inline, so
+ * embed the object in something allocated at cache line granularity for best
+ * results. Access functions must not block, and must not be used from primary
+ * interrupt context. */
+template <typename T, unsigned NUM_SLOTS = DJT_PERCPU_DEFAULT_SLOTS> class DJTPerCPU
+{
+	DJTPerCPU(const DJTPerCPU&) = delete;
+	DJTPerCPU& operator=(const DJTPerCPU&) = delete;
+	
+	struct slot
+	{
+		uint32_t busy;
+		T value;
+	};
+	DJTPerCPUArray<slot, NUM_SLOTS> slots;
+	
+	static bool tryLockSlot(slot* s)
+	{
+		return __atomic_load_n(&s->busy, __ATOMIC_RELAXED) == 0
+			&& !__atomic_exchange_n(&s->busy, 1, __ATOMIC_ACQUIRE);
+	}
+	static void unlockSlot(slot* s)
+	{
+		__atomic_store_n(&s->busy, 0, __ATOMIC_RELEASE);
+	}
+	
+	slot* lockLocalSlot()
+	{
+		unsigned index = currentSlotHint();
+		while (true)
+		{
+			for (unsigned i = 0; i < NUM_SLOTS; ++i)
+			{
+				slot* s = &this->slots[(index + i) % NUM_SLOTS];
+				if (tryLockSlot(s))
+					return s;
+			}
+			DJT_CPU_RELAX();
+		}
+	}
+	
+	slot* lockSlot(unsigned index)
+	{
+		slot* s = &this->slots[index];
+		while (!tryLockSlot(s))
+			DJT_CPU_RELAX();
+		return s;
+	}
+
+public:
+	DJTPerCPU() :
+		slots()
+	{
+	}
+	
+	// Index of the slot the calling thread would prefer, i.e. the current CPU (kernel) or a per-thread hash.
+	static unsigned currentSlotHint()
+	{
+		return DJTPerCPUArray<slot, NUM_SLOTS>::currentSlotHint();
+	}
+	
+	// Calls fn(T& value) with exclusive access to the current CPU's instance and returns its result.
+	template <typename FN> auto withLocal(FN fn) -> decltype(fn(*static_cast<T*>(nullptr)))
+	{
+		slot* s = this->lockLocalSlot();
+		struct unlocker
+		{
+			slot* s;
+			~unlocker() { unlockSlot(this->s); }
+		} unlock = { s };
+		return fn(s->value);
+	}
+	
+	/* Combines all instances: returns fn(...fn(fn(initial, v0), v1)..., vN-1).
+	 * Each instance is locked while fn runs on it, so it's seen in a
+	 * consistent state, but there is no snapshot across instances. */
+	template <typename R, typename FN> R fold(R initial, FN fn)
+	{
+		R accumulator = initial;
+		for (unsigned i = 0; i < NUM_SLOTS; ++i)
+		{
+			slot* s = this->lockSlot(i);
+			accumulator = fn(accumulator, const_cast<const T&>(s->value));
+			unlockSlot(s);
+		}
+		return accumulator;
+	}
+	
+	// Calls fn(T& value) on every instance in turn, e.g. for resetting or draining.
+	template <typename FN> void forEach(FN fn)
+	{
+		for (unsigned i = 0; i < NUM_SLOTS; ++i)
+		{
+			slot* s = this->lockSlot(i);
+			fn(s->value);
+			unlockSlot(s);
+		}
+	}
+	
+	static constexpr unsigned slotCount()
+	{
+		return NUM_SLOTS;
+	}
+};
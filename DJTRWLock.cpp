@@ -0,0 +1,109 @@
+/*
+kextgizmos' reference-counted IORWLock wrapper. The reader/writer counterpart
+to DJTLock, for sharing read-mostly state between multiple OSObject-derived
+objects.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTRWLock.hpp"
+#include <kern/locks.h>
+
+OSDefineMetaClassAndStructors(DJTRWLock, OSObject);
+
+bool DJTRWLock::init()
+{
+	if (!this->super::init())
+		return false;
+	
+	this->lock_obj = IORWLockAlloc();
+	if (this->lock_obj == nullptr)
+		return false;
+	
+	return true;
+}
+void DJTRWLock::free()
+{
+	if (this->lock_obj != nullptr)
+	{
+		IORWLockFree(this->lock_obj);
+		this->lock_obj = nullptr;
+	}
+	this->super::free();
+}
+
+void DJTRWLock::lockShared()
+{
+	assert(this->lock_obj != nullptr);
+	IORWLockRead(this->lock_obj);
+}
+void DJTRWLock::lockExclusive()
+{
+	assert(this->lock_obj != nullptr);
+	IORWLockWrite(this->lock_obj);
+}
+void DJTRWLock::unlock()
+{
+	assert(this->lock_obj != nullptr);
+	IORWLockUnlock(this->lock_obj);
+}
+
+bool DJTRWLock::upgradeToExclusive()
+{
+	assert(this->lock_obj != nullptr);
+	// On failure, lck_rw_lock_shared_to_exclusive() has already dropped our shared hold
+	if (lck_rw_lock_shared_to_exclusive(IORWLockGetMachLock(this->lock_obj)))
+		return true;
+	IORWLockWrite(this->lock_obj);
+	return false;
+}
+void DJTRWLock::downgradeToShared()
+{
+	assert(this->lock_obj != nullptr);
+	lck_rw_lock_exclusive_to_shared(IORWLockGetMachLock(this->lock_obj));
+}
@@ -0,0 +1,185 @@
+/*
+kextgizmos' reference-counted IORWLock wrapper. The reader/writer counterpart
+to DJTLock, for sharing read-mostly state between multiple OSObject-derived
+objects.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+
+class DJTRWLock : public OSObject
+{
+	OSDeclareDefaultStructors(DJTRWLock);
+private:
+	typedef OSObject super;
+	IORWLock* lock_obj;
+
+public:
+	virtual bool init() override;
+	virtual void free() override;
+	
+	void lockShared();
+	void lockExclusive();
+	// Releases the lock regardless of whether it's held shared or exclusive
+	void unlock();
+
+	/* Must only be called with the lock held shared. Always returns with the lock
+	 * held exclusively. If another thread was also attempting to upgrade, the
+	 * shared hold is dropped before the lock is re-acquired exclusively, and the
+	 * function returns false. In that case, any state read under the shared lock
+	 * must be assumed stale and re-validated. */
+	bool upgradeToExclusive();
+	// Must only be called with the lock held exclusively. Never blocks.
+	void downgradeToShared();
+};
+
+class DJTRWLockSharedGuard
+{
+	DJTRWLockSharedGuard(const DJTRWLockSharedGuard&) = delete;
+	DJTRWLock* lock;
+	bool exclusive;
+	
+public:
+	DJTRWLockSharedGuard(DJTRWLock* _lock) :
+		lock(_lock), exclusive(false)
+	{
+		if (_lock != nullptr)
+		{
+			_lock->retain();
+			_lock->lockShared();
+		}
+	}
+	
+	~DJTRWLockSharedGuard()
+	{
+		if (this->lock != nullptr)
+		{
+			this->lock->unlock();
+			OSSafeReleaseNULL(this->lock);
+		}
+	}
+	
+	// See DJTRWLock::upgradeToExclusive() for the meaning of the return value.
+	bool upgrade()
+	{
+		if (this->lock == nullptr || this->exclusive)
+			return true;
+		this->exclusive = true;
+		return this->lock->upgradeToExclusive();
+	}
+	
+	void downgrade()
+	{
+		if (this->lock != nullptr && this->exclusive)
+		{
+			this->lock->downgradeToShared();
+			this->exclusive = false;
+		}
+	}
+	
+	bool isExclusive() const
+	{
+		return this->exclusive;
+	}
+	
+	DJTRWLock* getLock() const
+	{
+		return this->lock;
+	}
+};
+
+class DJTRWLockExclusiveGuard
+{
+	DJTRWLockExclusiveGuard(const DJTRWLockExclusiveGuard&) = delete;
+	DJTRWLock* lock;
+	bool exclusive;
+	
+public:
+	DJTRWLockExclusiveGuard(DJTRWLock* _lock) :
+		lock(_lock), exclusive(true)
+	{
+		if (_lock != nullptr)
+		{
+			_lock->retain();
+			_lock->lockExclusive();
+		}
+	}
+	
+	~DJTRWLockExclusiveGuard()
+	{
+		if (this->lock != nullptr)
+		{
+			this->lock->unlock();
+			OSSafeReleaseNULL(this->lock);
+		}
+	}
+	
+	// Lets other readers in once the modification is complete.
+	void downgrade()
+	{
+		if (this->lock != nullptr && this->exclusive)
+		{
+			this->lock->downgradeToShared();
+			this->exclusive = false;
+		}
+	}
+	
+	bool isExclusive() const
+	{
+		return this->exclusive;
+	}
+	
+	DJTRWLock* getLock() const
+	{
+		return this->lock;
+	}
+};
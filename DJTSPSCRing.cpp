@@ -0,0 +1,153 @@
+/*
+kextgizmos' kernel-to-user-space ring buffer.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTSPSCRing.hpp"
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/IOLib.h>
+
+OSDefineMetaClassAndStructors(DJTSPSCRing, OSObject);
+
+DJTSPSCRing* DJTSPSCRing::withCapacity(uint32_t capacity)
+{
+	DJTSPSCRing* ring = OSTypeAlloc(DJTSPSCRing);
+	if (ring != nullptr && !ring->initWithCapacity(capacity))
+		OSSafeReleaseNULL(ring);
+	return ring;
+}
+
+bool DJTSPSCRing::initWithCapacity(uint32_t capacity)
+{
+	if (!this->super::init())
+		return false;
+	
+	this->notification_lock = IOLockAlloc();
+	if (this->notification_lock == nullptr)
+		return false;
+	
+	size_t size = djt_spsc_ring_total_size(capacity);
+	this->memory = IOBufferMemoryDescriptor::inTaskWithOptions(
+		kernel_task, kIODirectionInOut | kIOMemoryKernelUserShared, size, page_size);
+	if (this->memory == nullptr)
+		return false;
+	void* address = this->memory->getBytesNoCopy();
+	if (!djt_spsc_ring_init(address, capacity))
+		return false;
+	djt_spsc_ring_producer_init(&this->producer, address, capacity);
+	
+	return true;
+}
+
+void DJTSPSCRing::free()
+{
+	OSSafeReleaseNULL(this->memory);
+	if (this->notification_lock != nullptr)
+	{
+		IOLockFree(this->notification_lock);
+		this->notification_lock = nullptr;
+	}
+	this->super::free();
+}
+
+IOMemoryDescriptor* DJTSPSCRing::getMemoryDescriptor() const
+{
+	return this->memory;
+}
+
+IOReturn DJTSPSCRing::setNotification(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count)
+{
+	if (wake_port == MACH_PORT_NULL || reference == nullptr || reference_count == 0)
+		return kIOReturnBadArgument;
+	if (reference_count > kOSAsyncRef64Count)
+		reference_count = kOSAsyncRef64Count;
+	
+	IOLockLock(this->notification_lock);
+	bzero(this->notification_ref, sizeof(this->notification_ref));
+	memcpy(this->notification_ref, reference, reference_count * sizeof(reference[0]));
+	this->notification_armed = true;
+	IOLockUnlock(this->notification_lock);
+	return kIOReturnSuccess;
+}
+
+void DJTSPSCRing::clearNotification()
+{
+	IOLockLock(this->notification_lock);
+	this->notification_armed = false;
+	IOLockUnlock(this->notification_lock);
+}
+
+IOReturn DJTSPSCRing::enqueue(const void* record, uint32_t length)
+{
+	bool wake = false;
+	djt_spsc_ring_status status = djt_spsc_ring_enqueue(&this->producer, record, length, &wake);
+	switch (status)
+	{
+	case DJT_SPSC_RING_OK:
+		break;
+	case DJT_SPSC_RING_FULL:
+		return kIOReturnNoSpace;
+	case DJT_SPSC_RING_TOO_LARGE:
+		return kIOReturnBadArgument;
+	default:
+		return kIOReturnIOError;
+	}
+	
+	if (wake)
+		this->sendNotification();
+	return kIOReturnSuccess;
+}
+
+void DJTSPSCRing::sendNotification()
+{
+	IOLockLock(this->notification_lock);
+	if (this->notification_armed)
+		IOUserClient::sendAsyncResult64(this->notification_ref, kIOReturnSuccess, nullptr, 0);
+	IOLockUnlock(this->notification_lock);
+}
@@ -0,0 +1,109 @@
+/*
+kextgizmos' kernel-to-user-space ring buffer. Streams variable-length records
+from a kext to a user client through shared memory, with a notification only
+when the user-space consumer is idle.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_spsc_ring.h"
+#include <IOKit/IOUserClient.h>
+#include <libkern/c++/OSObject.h>
+
+class IOBufferMemoryDescriptor;
+
+/* Owns the shared IOBufferMemoryDescriptor and the producer side of a
+ * djt_spsc_ring. Typical use in an IOUserClient subclass:
+ *  - Create in initWithTask()/start().
+ *  - Return getMemoryDescriptor() (retained) from clientMemoryForType(); user
+ *    space maps it with IOConnectMapMemory64() and attaches a
+ *    djt_spsc_ring_consumer.
+ *  - Expose setNotification() as an async external method, e.g. via
+ *    userclient_method, as its signature matches the async argument triple.
+ *    The client gets an async result with kIOReturnSuccess whenever data
+ *    arrives while it is idle.
+ *  - Call clearNotification() from clientClose()/clientDied().
+ *
+ * enqueue() must only be called from one thread at a time (e.g. the work
+ * loop). */
+class DJTSPSCRing : public OSObject
+{
+	OSDeclareDefaultStructors(DJTSPSCRing);
+private:
+	typedef OSObject super;
+	
+	IOBufferMemoryDescriptor* memory;
+	djt_spsc_ring_producer_t producer;
+	IOLock* notification_lock;
+	OSAsyncReference64 notification_ref;
+	bool notification_armed;
+
+public:
+	static DJTSPSCRing* withCapacity(uint32_t capacity);
+	// capacity is the size of the data area in bytes and must be a power of two.
+	virtual bool initWithCapacity(uint32_t capacity);
+	virtual void free() override;
+	
+	IOMemoryDescriptor* getMemoryDescriptor() const;
+	
+	IOReturn setNotification(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count);
+	void clearNotification();
+	
+	/* Returns kIOReturnNoSpace if the ring is full, kIOReturnBadArgument if the
+	 * record is too large for the ring and kIOReturnIOError if the client has
+	 * corrupted the shared header. */
+	IOReturn enqueue(const void* record, uint32_t length);
+	
+	/* Sends the async notification, if armed. For producers which write to the
+	 * ring memory directly with their own djt_spsc_ring_producer, such as
+	 * DJTUserClientRings, when djt_spsc_ring_enqueue() asks for a wakeup. Don't
+	 * mix such direct production with enqueue(). */
+	void sendNotification();
+};
@@ -0,0 +1,200 @@
+/*
+kextgizmos' sequence lock template, for small read-mostly structs which are read
+far more often than they're modified. Readers never write to shared memory.
+Works in kexts, dexts and user space.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_cpu_hints.h"
+#include <stdint.h>
+
+/* Readers take an optimistic copy of the protected value and retry if a writer
+ * was active at the same time, so reads are only a couple of loads and never
+ * dirty the cache line for other CPUs. Writers are serialized by the sequence
+ * counter itself (an odd value means a write is in progress) and briefly spin if
+ * contended, so keep write sections short and never block inside them.
+ *
+ * T must be trivially copyable, as readers may copy it while it's being
+ * modified and then discard the torn result.
+ *
+ * Can be embedded directly in another object, or allocated with create() and
+ * shared between multiple objects using retain()/release(), like DJTLock. */
+template <typename T> class DJTSeqLock
+{
+	static_assert(__is_trivially_copyable(T), "DJTSeqLock can only protect trivially copyable types");
+	
+	DJTSeqLock(const DJTSeqLock&) = delete;
+	DJTSeqLock& operator=(const DJTSeqLock&) = delete;
+	
+	uint32_t sequence;
+	uint32_t retain_count;
+	T value;
+	
+public:
+	explicit DJTSeqLock(const T& initial_value = T()) :
+		sequence(0), retain_count(1), value(initial_value)
+	{
+	}
+	
+	// Heap-allocated, reference-counted instance; starts with a retain count of 1.
+	static DJTSeqLock* create(const T& initial_value = T())
+	{
+		return new DJTSeqLock(initial_value);
+	}
+	void retain()
+	{
+		__atomic_fetch_add(&this->retain_count, 1, __ATOMIC_RELAXED);
+	}
+	// Only for create()d instances, not embedded ones.
+	void release()
+	{
+		if (__atomic_fetch_sub(&this->retain_count, 1, __ATOMIC_ACQ_REL) == 1)
+			delete this;
+	}
+	
+	/* Low level read protocol, for when copying the whole of T is not desirable:
+	 *   uint32_t seq;
+	 *   do {
+	 *     seq = lock->readBegin();
+	 *     x = lock->unsafeValue().x;
+	 *   } while (lock->readRetry(seq));
+	 * Values read between readBegin() and a successful readRetry() must not be
+	 * acted upon (e.g. dereferenced) until readRetry() returns false. */
+	uint32_t readBegin() const
+	{
+		uint32_t seq;
+		while ((seq = __atomic_load_n(&this->sequence, __ATOMIC_ACQUIRE)) & 1u)
+			DJT_CPU_RELAX();
+		return seq;
+	}
+	bool readRetry(uint32_t begin_seq) const
+	{
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		return __atomic_load_n(&this->sequence, __ATOMIC_RELAXED) != begin_seq;
+	}
+	const T& unsafeValue() const
+	{
+		return this->value;
+	}
+	
+	// Returns a consistent snapshot of the protected value.
+	T read() const
+	{
+		T copy;
+		uint32_t seq;
+		do
+		{
+			seq = this->readBegin();
+			__builtin_memcpy(&copy, &this->value, sizeof(copy));
+		} while (this->readRetry(seq));
+		return copy;
+	}
+	
+	/* Exclusive modification in place. Must be paired with endWrite(); prefer
+	 * DJTSeqLockWriteGuard or write(). Readers spin while a write is in
+	 * progress, so don't block between these calls. */
+	T* beginWrite()
+	{
+		uint32_t seq = __atomic_load_n(&this->sequence, __ATOMIC_RELAXED);
+		while (true)
+		{
+			if ((seq & 1u) == 0
+			    && __atomic_compare_exchange_n(&this->sequence, &seq, seq + 1, true /* weak */, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+			DJT_CPU_RELAX();
+			seq = __atomic_load_n(&this->sequence, __ATOMIC_RELAXED);
+		}
+		// Order the odd sequence number before any of the data stores
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		return &this->value;
+	}
+	void endWrite()
+	{
+		__atomic_fetch_add(&this->sequence, 1, __ATOMIC_RELEASE);
+	}
+	
+	void write(const T& new_value)
+	{
+		T* dest = this->beginWrite();
+		__builtin_memcpy(dest, &new_value, sizeof(*dest));
+		this->endWrite();
+	}
+};
+
+template <typename T> class DJTSeqLockWriteGuard
+{
+	DJTSeqLockWriteGuard(const DJTSeqLockWriteGuard&) = delete;
+	DJTSeqLock<T>* lock;
+	T* value;
+	
+public:
+	DJTSeqLockWriteGuard(DJTSeqLock<T>* _lock) :
+		lock(_lock), value(nullptr)
+	{
+		if (_lock != nullptr)
+			this->value = _lock->beginWrite();
+	}
+	
+	~DJTSeqLockWriteGuard()
+	{
+		if (this->lock != nullptr)
+			this->lock->endWrite();
+	}
+	
+	T* operator->() const
+	{
+		return this->value;
+	}
+	T& operator*() const
+	{
+		return *this->value;
+	}
+};
@@ -0,0 +1,325 @@
+/*
+kextgizmos' hierarchical timing wheel, for tracking large numbers of timeouts
+(e.g. one per in-flight command) with O(1) arm and cancel. This is the
+OS-independent core; DJTTimingWheelTimer drives it from an IOTimerEventSource.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/* Time is measured in ticks of a fixed resolution chosen by the user. The wheel
+ * has DJT_TIMING_WHEEL_LEVELS levels of 64 slots; level n covers deltas of up to
+ * 64^(n+1) ticks at a granularity of 64^n ticks. Arming and cancelling are a
+ * doubly-linked list insert/removal. Entries in the upper levels are moved
+ * down ("cascaded") as their slot comes around, so each entry is moved at
+ * most once per level.
+ *
+ * Resolution tradeoff: timeouts fire on the first tick at or after their
+ * expiry, i.e. never early but up to one tick late. The driving timer only
+ * needs to fire at nextEventTick(), the next tick with an expiry or cascade,
+ * and advance() skips the ticks in between. A coarse tick (e.g. 1-10ms for
+ * command timeouts) means cheap bookkeeping and lets nearby timeouts share a
+ * wakeup. A fine tick gives accuracy but fewer shared wakeups. The range is
+ * 64^DJT_TIMING_WHEEL_LEVELS ticks (about 4.6 hours at 1ms); longer timeouts
+ * are parked in the last slot and re-inserted when it comes round.
+ *
+ * Not internally synchronized: all calls must be serialized, e.g. by a work
+ * loop gate. Callbacks run from advance() and may re-arm or cancel any entry,
+ * including their own. A nested advance() from a callback does nothing; the
+ * outer one carries on up to its own target tick. */
+#define DJT_TIMING_WHEEL_LEVELS 4
+#define DJT_TIMING_WHEEL_SLOT_BITS 6
+#define DJT_TIMING_WHEEL_SLOTS (1u << DJT_TIMING_WHEEL_SLOT_BITS)
+
+struct DJTTimingWheelEntry
+{
+	typedef void (*expiry_fn)(DJTTimingWheelEntry* entry, void* context);
+	
+	DJTTimingWheelEntry* prev;
+	DJTTimingWheelEntry* next;
+	uint64_t expiry_tick;
+	expiry_fn function;
+	void* context;
+	
+	// Call before first use.
+	void init(expiry_fn _function, void* _context)
+	{
+		this->prev = this->next = nullptr;
+		this->expiry_tick = 0;
+		this->function = _function;
+		this->context = _context;
+	}
+	
+	bool isArmed() const
+	{
+		return this->prev != nullptr;
+	}
+};
+
+class DJTTimingWheel
+{
+	DJTTimingWheel(const DJTTimingWheel&) = delete;
+	DJTTimingWheel& operator=(const DJTTimingWheel&) = delete;
+	
+	// Circular lists with sentinel heads, so unlinking needs no slot lookup.
+	DJTTimingWheelEntry slots[DJT_TIMING_WHEEL_LEVELS][DJT_TIMING_WHEEL_SLOTS];
+	/* Bit n set if slot n of the level may be non-empty. Set on insert and
+	 * cleared when a slot is emptied by advance(), or found empty (after
+	 * cancellations) by nextEventTick(). */
+	uint64_t occupied[DJT_TIMING_WHEEL_LEVELS];
+	uint64_t current_tick;
+	uint32_t armed_count;
+	bool advancing;
+	
+	static void listInit(DJTTimingWheelEntry* head)
+	{
+		head->prev = head->next = head;
+	}
+	static void listInsert(DJTTimingWheelEntry* head, DJTTimingWheelEntry* entry)
+	{
+		entry->next = head;
+		entry->prev = head->prev;
+		head->prev->next = entry;
+		head->prev = entry;
+	}
+	static void listRemove(DJTTimingWheelEntry* entry)
+	{
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+		entry->prev = entry->next = nullptr;
+	}
+	// Moves a slot's entries to a separate list headed by 'into'.
+	static void listTakeAll(DJTTimingWheelEntry* head, DJTTimingWheelEntry* into)
+	{
+		if (head->next == head)
+		{
+			listInit(into);
+			return;
+		}
+		into->next = head->next;
+		into->prev = head->prev;
+		into->next->prev = into;
+		into->prev->next = into;
+		listInit(head);
+	}
+	
+	/* While cascading, the current tick's level 0 slot is still to be processed,
+	 * so entries due now can go there. Otherwise, it has already been
+	 * processed and entries that are due fire on the next tick. */
+	void place(DJTTimingWheelEntry* entry, bool cascading = false)
+	{
+		uint64_t expiry = entry->expiry_tick;
+		uint64_t earliest = cascading ? this->current_tick : this->current_tick + 1;
+		if (expiry < earliest)
+			expiry = earliest;
+		uint64_t delta = expiry - this->current_tick;
+		
+		unsigned level = 0;
+		while (level < DJT_TIMING_WHEEL_LEVELS - 1 && delta >= (1ull << (DJT_TIMING_WHEEL_SLOT_BITS * (level + 1))))
+			++level;
+		uint64_t max_delta = (1ull << (DJT_TIMING_WHEEL_SLOT_BITS * DJT_TIMING_WHEEL_LEVELS)) - 1;
+		if (delta > max_delta)
+			expiry = this->current_tick + max_delta; // re-placed when cascaded
+		
+		unsigned slot = (expiry >> (DJT_TIMING_WHEEL_SLOT_BITS * level)) & (DJT_TIMING_WHEEL_SLOTS - 1);
+		listInsert(&this->slots[level][slot], entry);
+		this->occupied[level] |= 1ull << slot;
+	}
+	
+	void takeSlot(unsigned level, unsigned slot, DJTTimingWheelEntry* into)
+	{
+		listTakeAll(&this->slots[level][slot], into);
+		this->occupied[level] &= ~(1ull << slot);
+	}
+	
+	/* Number of slot steps from the one after 'index' to the first non-empty
+	 * slot of the level, or DJT_TIMING_WHEEL_SLOTS if there is none. */
+	unsigned nextOccupiedSlot(unsigned level, unsigned index)
+	{
+		while (this->occupied[level] != 0)
+		{
+			unsigned start = (index + 1) & (DJT_TIMING_WHEEL_SLOTS - 1);
+			uint64_t rotated = (this->occupied[level] >> start) | (start != 0 ? this->occupied[level] << (DJT_TIMING_WHEEL_SLOTS - start) : 0);
+			unsigned steps = __builtin_ctzll(rotated);
+			unsigned slot = (start + steps) & (DJT_TIMING_WHEEL_SLOTS - 1);
+			if (this->slots[level][slot].next != &this->slots[level][slot])
+				return steps;
+			this->occupied[level] &= ~(1ull << slot); // emptied by cancel()
+		}
+		return DJT_TIMING_WHEEL_SLOTS;
+	}
+	
+	void cascade(unsigned level)
+	{
+		unsigned slot = (this->current_tick >> (DJT_TIMING_WHEEL_SLOT_BITS * level)) & (DJT_TIMING_WHEEL_SLOTS - 1);
+		DJTTimingWheelEntry pending;
+		this->takeSlot(level, slot, &pending);
+		while (pending.next != &pending)
+		{
+			DJTTimingWheelEntry* entry = pending.next;
+			listRemove(entry);
+			this->place(entry, true);
+		}
+	}
+	
+	void tick()
+	{
+		++this->current_tick;
+		for (unsigned level = 1; level < DJT_TIMING_WHEEL_LEVELS; ++level)
+		{
+			// Cascade a level whenever all the levels below it wrap around
+			if ((this->current_tick & ((1ull << (DJT_TIMING_WHEEL_SLOT_BITS * level)) - 1)) != 0)
+				break;
+			this->cascade(level);
+		}
+		
+		unsigned slot = this->current_tick & (DJT_TIMING_WHEEL_SLOTS - 1);
+		DJTTimingWheelEntry expired;
+		this->takeSlot(0, slot, &expired);
+		while (expired.next != &expired)
+		{
+			DJTTimingWheelEntry* entry = expired.next;
+			listRemove(entry);
+			if (entry->expiry_tick > this->current_tick)
+			{
+				// Parked beyond the wheel's range
+				this->place(entry);
+				continue;
+			}
+			--this->armed_count;
+			entry->function(entry, entry->context);
+		}
+	}
+
+public:
+	explicit DJTTimingWheel(uint64_t start_tick = 0) :
+		occupied(), current_tick(start_tick), armed_count(0), advancing(false)
+	{
+		for (unsigned level = 0; level < DJT_TIMING_WHEEL_LEVELS; ++level)
+			for (unsigned slot = 0; slot < DJT_TIMING_WHEEL_SLOTS; ++slot)
+				listInit(&this->slots[level][slot]);
+	}
+	
+	// Re-arming an armed entry moves it.
+	void arm(DJTTimingWheelEntry* entry, uint64_t expiry_tick)
+	{
+		if (entry->isArmed())
+			listRemove(entry);
+		else
+			++this->armed_count;
+		entry->expiry_tick = expiry_tick;
+		this->place(entry);
+	}
+	
+	// Returns false if the entry wasn't armed (e.g. it already fired).
+	bool cancel(DJTTimingWheelEntry* entry)
+	{
+		if (!entry->isArmed())
+			return false;
+		listRemove(entry);
+		--this->armed_count;
+		return true;
+	}
+	
+	/* Fires all entries due up to and including now_tick. Ticks with nothing
+	 * to fire or cascade are skipped. (Slots are indexed by absolute tick, so
+	 * this is safe.) */
+	void advance(uint64_t now_tick)
+	{
+		if (this->advancing)
+			return;
+		this->advancing = true;
+		while (this->current_tick < now_tick)
+		{
+			uint64_t next = this->nextEventTick();
+			if (next > now_tick)
+			{
+				this->current_tick = now_tick;
+				break;
+			}
+			this->current_tick = next - 1;
+			this->tick();
+		}
+		this->advancing = false;
+	}
+	
+	/* The next tick after the current one at which advance() has work to do,
+	 * i.e. when the driving timer needs to fire; UINT64_MAX if nothing is
+	 * armed. This may be a cascade rather than an expiry. */
+	uint64_t nextEventTick()
+	{
+		if (this->armed_count == 0)
+			return UINT64_MAX;
+		uint64_t next = UINT64_MAX;
+		for (unsigned level = 0; level < DJT_TIMING_WHEEL_LEVELS; ++level)
+		{
+			unsigned shift = DJT_TIMING_WHEEL_SLOT_BITS * level;
+			unsigned index = (this->current_tick >> shift) & (DJT_TIMING_WHEEL_SLOTS - 1);
+			unsigned steps = this->nextOccupiedSlot(level, index);
+			if (steps == DJT_TIMING_WHEEL_SLOTS)
+				continue;
+			// Level 0 slots fire on their tick; higher levels cascade when the levels below wrap to it
+			uint64_t slot_tick = ((this->current_tick >> shift) + 1 + steps) << shift;
+			if (slot_tick < next)
+				next = slot_tick;
+		}
+		return next;
+	}
+	
+	uint64_t currentTick() const
+	{
+		return this->current_tick;
+	}
+	uint32_t armedCount() const
+	{
+		return this->armed_count;
+	}
+};
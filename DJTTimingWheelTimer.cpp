@@ -0,0 +1,164 @@
+/*
+kextgizmos' work loop driven timing wheel.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTTimingWheelTimer.hpp"
+#include <IOKit/IOLib.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOWorkLoop.h>
+
+OSDefineMetaClassAndStructors(DJTTimingWheelTimer, OSObject);
+
+DJTTimingWheelTimer* DJTTimingWheelTimer::withWorkLoop(IOWorkLoop* work_loop, uint64_t tick_ns)
+{
+	DJTTimingWheelTimer* timer = OSTypeAlloc(DJTTimingWheelTimer);
+	if (timer != nullptr && !timer->initWithWorkLoop(work_loop, tick_ns))
+		OSSafeReleaseNULL(timer);
+	return timer;
+}
+
+bool DJTTimingWheelTimer::initWithWorkLoop(IOWorkLoop* work_loop, uint64_t tick_ns)
+{
+	if (!this->super::init())
+		return false;
+	if (work_loop == nullptr || tick_ns == 0)
+		return false;
+	
+	this->tick_ns = tick_ns;
+	nanoseconds_to_absolutetime(tick_ns, &this->tick_abs);
+	if (this->tick_abs == 0)
+		return false;
+	this->origin_abs = mach_absolute_time();
+	this->scheduled_tick = UINT64_MAX;
+	
+	this->wheel = new DJTTimingWheel(0);
+	if (this->wheel == nullptr)
+		return false;
+	
+	this->timer = IOTimerEventSource::timerEventSource(this, timerFired);
+	if (this->timer == nullptr)
+		return false;
+	if (work_loop->addEventSource(this->timer) != kIOReturnSuccess)
+	{
+		OSSafeReleaseNULL(this->timer);
+		return false;
+	}
+	work_loop->retain();
+	this->work_loop = work_loop;
+	
+	return true;
+}
+
+void DJTTimingWheelTimer::free()
+{
+	if (this->timer != nullptr)
+	{
+		this->timer->cancelTimeout();
+		if (this->work_loop != nullptr)
+			this->work_loop->removeEventSource(this->timer);
+		OSSafeReleaseNULL(this->timer);
+	}
+	OSSafeReleaseNULL(this->work_loop);
+	if (this->wheel != nullptr)
+	{
+		assert(this->wheel->armedCount() == 0);
+		delete this->wheel;
+		this->wheel = nullptr;
+	}
+	this->super::free();
+}
+
+uint64_t DJTTimingWheelTimer::nowTick() const
+{
+	return (mach_absolute_time() - this->origin_abs) / this->tick_abs;
+}
+
+// Programs the timer for the wheel's next expiry or cascade.
+void DJTTimingWheelTimer::scheduleNextEvent()
+{
+	uint64_t next_tick = this->wheel->nextEventTick();
+	if (next_tick == this->scheduled_tick || next_tick == UINT64_MAX)
+		return;
+	uint64_t next_tick_abs = this->origin_abs + next_tick * this->tick_abs;
+	this->timer->wakeAtTime(*reinterpret_cast<AbsoluteTime*>(&next_tick_abs));
+	this->scheduled_tick = next_tick;
+}
+
+void DJTTimingWheelTimer::timerFired(OSObject* owner, IOTimerEventSource*)
+{
+	DJTTimingWheelTimer* me = OSDynamicCast(DJTTimingWheelTimer, owner);
+	if (me == nullptr)
+		return;
+	me->scheduled_tick = UINT64_MAX;
+	me->wheel->advance(me->nowTick());
+	// Callbacks may have armed entries and set the timer already
+	me->scheduleNextEvent();
+}
+
+void DJTTimingWheelTimer::arm(DJTTimingWheelEntry* entry, uint64_t timeout_ns)
+{
+	uint64_t now = this->nowTick();
+	/* An idle wheel can skip ahead without firing anything. Otherwise, leave
+	 * catching up to the timer action, so callbacks never run from here. */
+	if (this->wheel->armedCount() == 0)
+		this->wheel->advance(now);
+	// +1 as the current tick has already partially elapsed
+	uint64_t expiry_tick = now + (timeout_ns + this->tick_ns - 1) / this->tick_ns + 1;
+	this->wheel->arm(entry, expiry_tick);
+	// Any earlier cascade this needs comes no later than its expiry
+	if (expiry_tick < this->scheduled_tick)
+		this->scheduleNextEvent();
+}
+
+bool DJTTimingWheelTimer::cancel(DJTTimingWheelEntry* entry)
+{
+	// The timer is left to run out on its own; it finds nothing to do and moves on.
+	return this->wheel->cancel(entry);
+}
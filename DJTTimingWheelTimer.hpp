@@ -0,0 +1,104 @@
+/*
+kextgizmos' work loop driven timing wheel, for large numbers of driver
+timeouts (e.g. one per in-flight command) on a single periodic timer.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "DJTTimingWheel.hpp"
+#include <libkern/c++/OSObject.h>
+
+class IOWorkLoop;
+class IOTimerEventSource;
+
+/* Owns a DJTTimingWheel and an IOTimerEventSource on the given work loop. The
+ * timer is programmed for the next tick on which the wheel has something to
+ * do, not every tick, and is idle while nothing is armed. Entry callbacks run
+ * on the work loop, from the timer action only.
+ *
+ * arm() and cancel() must be called on the work loop, i.e. from an event
+ * source action or IOWorkLoop::runAction(), including from entry callbacks.
+ * They never run callbacks themselves. See DJTTimingWheel.hpp for the choice
+ * of tick resolution. */
+class DJTTimingWheelTimer : public OSObject
+{
+	OSDeclareDefaultStructors(DJTTimingWheelTimer);
+private:
+	typedef OSObject super;
+	
+	IOWorkLoop* work_loop;
+	IOTimerEventSource* timer;
+	DJTTimingWheel* wheel;
+	uint64_t tick_ns;
+	uint64_t tick_abs;
+	uint64_t origin_abs;
+	// Tick the timer is set for, UINT64_MAX if it isn't.
+	uint64_t scheduled_tick;
+	
+	static void timerFired(OSObject* owner, IOTimerEventSource* sender);
+	uint64_t nowTick() const;
+	void scheduleNextEvent();
+
+public:
+	static DJTTimingWheelTimer* withWorkLoop(IOWorkLoop* work_loop, uint64_t tick_ns);
+	virtual bool initWithWorkLoop(IOWorkLoop* work_loop, uint64_t tick_ns);
+	virtual void free() override;
+	
+	/* Fires entry after timeout_ns nanoseconds: never early, and at most one
+	 * tick (plus timer latency) late. Re-arming an armed entry moves it. */
+	void arm(DJTTimingWheelEntry* entry, uint64_t timeout_ns);
+	// Returns false if the entry wasn't armed, e.g. it already fired.
+	bool cancel(DJTTimingWheelEntry* entry);
+	
+	uint64_t tickNanoseconds() const
+	{
+		return this->tick_ns;
+	}
+};
@@ -0,0 +1,276 @@
+/*
+kextgizmos' per-user-client cache of kernel mappings of client memory.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTUserClientMapCache.hpp"
+#include <IOKit/IOLib.h>
+
+OSDefineMetaClassAndStructors(DJTUserClientMapCache, OSObject);
+
+DJTUserClientMapCache* DJTUserClientMapCache::withTask(task_t client_task, uint32_t max_entries, uint64_t max_wired_bytes)
+{
+	DJTUserClientMapCache* cache = OSTypeAlloc(DJTUserClientMapCache);
+	if (cache != nullptr && !cache->initWithTask(client_task, max_entries, max_wired_bytes))
+		OSSafeReleaseNULL(cache);
+	return cache;
+}
+
+bool DJTUserClientMapCache::initWithTask(task_t client_task, uint32_t max_entries, uint64_t max_wired_bytes)
+{
+	if (!this->super::init())
+		return false;
+	if (client_task == nullptr || max_entries == 0 || max_wired_bytes == 0)
+		return false;
+	
+	this->lock = IOLockAlloc();
+	if (this->lock == nullptr)
+		return false;
+	this->entries = static_cast<entry*>(IOMalloc(sizeof(entry) * max_entries));
+	if (this->entries == nullptr)
+		return false;
+	bzero(this->entries, sizeof(entry) * max_entries);
+	this->max_entries = max_entries;
+	this->max_wired_bytes = max_wired_bytes;
+	this->wired_bytes = 0;
+	this->task = client_task;
+	
+	return true;
+}
+
+void DJTUserClientMapCache::free()
+{
+	if (this->entries != nullptr)
+	{
+		for (uint32_t i = 0; i < this->max_entries; ++i)
+			this->releaseEntry(&this->entries[i]);
+		IOFree(this->entries, sizeof(entry) * this->max_entries);
+		this->entries = nullptr;
+	}
+	if (this->lock != nullptr)
+	{
+		IOLockFree(this->lock);
+		this->lock = nullptr;
+	}
+	this->super::free();
+}
+
+void DJTUserClientMapCache::releaseEntry(entry* e)
+{
+	OSSafeReleaseNULL(e->map);
+	if (e->descriptor != nullptr)
+	{
+		e->descriptor->complete(e->direction);
+		OSSafeReleaseNULL(e->descriptor);
+		this->wired_bytes -= e->length;
+	}
+	e->address = 0;
+	e->length = 0;
+}
+
+// These must be called with the lock held.
+
+DJTUserClientMapCache::entry* DJTUserClientMapCache::findEntry(mach_vm_address_t address, mach_vm_size_t length, IODirection direction)
+{
+	for (uint32_t i = 0; i < this->max_entries; ++i)
+	{
+		entry* e = &this->entries[i];
+		if (e->map != nullptr
+		    && address >= e->address && address + length <= e->address + e->length
+		    && (e->direction & direction) == (direction & kIODirectionInOut))
+			return e;
+	}
+	return nullptr;
+}
+
+void DJTUserClientMapCache::useEntry(entry* e, mach_vm_address_t address, IOMemoryMap** out_map, void** out_kernel_address)
+{
+	e->last_use = ++this->use_counter;
+	e->map->retain();
+	*out_map = e->map;
+	*out_kernel_address = reinterpret_cast<void*>(e->map->getAddress() + (address - e->address));
+}
+
+// A free slot if there is one, otherwise the least recently used entry.
+DJTUserClientMapCache::entry* DJTUserClientMapCache::leastRecentlyUsed()
+{
+	entry* lru = &this->entries[0];
+	for (uint32_t i = 0; i < this->max_entries; ++i)
+	{
+		entry* e = &this->entries[i];
+		if (e->map == nullptr || (lru->map != nullptr && e->last_use < lru->last_use))
+			lru = e;
+	}
+	return lru;
+}
+
+/* Accounts for length bytes about to be wired, evicting entries in LRU order
+ * to stay within the limit. Fails if that's not enough, e.g. because other
+ * threads' ranges are being mapped. */
+bool DJTUserClientMapCache::reserveWiredBytes(mach_vm_size_t length)
+{
+	while (this->wired_bytes + length > this->max_wired_bytes)
+	{
+		entry* oldest = nullptr;
+		for (uint32_t i = 0; i < this->max_entries; ++i)
+		{
+			entry* e = &this->entries[i];
+			if (e->map != nullptr && (oldest == nullptr || e->last_use < oldest->last_use))
+				oldest = e;
+		}
+		if (oldest == nullptr)
+			return false;
+		this->releaseEntry(oldest);
+	}
+	this->wired_bytes += length;
+	return true;
+}
+
+IOReturn DJTUserClientMapCache::mapRange(mach_vm_address_t address, mach_vm_size_t length, IODirection direction, IOMemoryMap** out_map, void** out_kernel_address)
+{
+	if (length == 0 || address + length < address || (direction & kIODirectionInOut) == 0)
+		return kIOReturnBadArgument;
+	if (length > this->max_wired_bytes)
+		return kIOReturnNoResources;
+	
+	IOLockLock(this->lock);
+	entry* e = this->findEntry(address, length, direction);
+	if (e != nullptr)
+	{
+		this->useEntry(e, address, out_map, out_kernel_address);
+		IOLockUnlock(this->lock);
+		return kIOReturnSuccess;
+	}
+	// Make room first, so the limit also holds while the range is being wired
+	bool reserved = this->reserveWiredBytes(length);
+	IOLockUnlock(this->lock);
+	if (!reserved)
+		return kIOReturnNoResources;
+	
+	// Miss: create the mapping without holding the lock, as this may fault and block.
+	IOMemoryDescriptor* descriptor = IOMemoryDescriptor::withAddressRange(address, length, direction & kIODirectionInOut, this->task);
+	IOMemoryMap* map = nullptr;
+	IOReturn result = kIOReturnNoMemory;
+	if (descriptor != nullptr)
+		result = descriptor->prepare(direction & kIODirectionInOut);
+	if (result == kIOReturnSuccess)
+	{
+		IOOptionBits map_options = kIOMapAnywhere;
+		if ((direction & kIODirectionIn) == 0)
+			map_options |= kIOMapReadOnly;
+		map = descriptor->createMappingInTask(kernel_task, 0, map_options);
+		if (map == nullptr)
+		{
+			descriptor->complete(direction & kIODirectionInOut);
+			result = kIOReturnVMError;
+		}
+	}
+	
+	IOLockLock(this->lock);
+	// Another thread may have missed on the same range meanwhile and got here first
+	e = (result == kIOReturnSuccess) ? this->findEntry(address, length, direction) : nullptr;
+	if (result != kIOReturnSuccess || e != nullptr)
+	{
+		this->wired_bytes -= length;
+		if (e != nullptr)
+			this->useEntry(e, address, out_map, out_kernel_address);
+		IOLockUnlock(this->lock);
+		if (map != nullptr)
+		{
+			map->release();
+			descriptor->complete(direction & kIODirectionInOut);
+		}
+		OSSafeReleaseNULL(descriptor);
+		return result;
+	}
+	
+	// The reservation becomes the new entry's
+	e = this->leastRecentlyUsed();
+	this->releaseEntry(e);
+	e->address = address;
+	e->length = length;
+	e->direction = direction & kIODirectionInOut;
+	e->descriptor = descriptor;
+	e->map = map;
+	e->last_use = ++this->use_counter;
+	map->retain();
+	IOLockUnlock(this->lock);
+	
+	*out_map = map;
+	*out_kernel_address = reinterpret_cast<void*>(map->getAddress());
+	return kIOReturnSuccess;
+}
+
+void DJTUserClientMapCache::invalidateRange(mach_vm_address_t address, mach_vm_size_t length)
+{
+	IOLockLock(this->lock);
+	for (uint32_t i = 0; i < this->max_entries; ++i)
+	{
+		entry* e = &this->entries[i];
+		if (e->map != nullptr && address < e->address + e->length && e->address < address + length)
+			this->releaseEntry(e);
+	}
+	IOLockUnlock(this->lock);
+}
+
+void DJTUserClientMapCache::flush()
+{
+	IOLockLock(this->lock);
+	for (uint32_t i = 0; i < this->max_entries; ++i)
+		this->releaseEntry(&this->entries[i]);
+	IOLockUnlock(this->lock);
+}
+
+uint64_t DJTUserClientMapCache::getWiredBytes()
+{
+	IOLockLock(this->lock);
+	uint64_t bytes = this->wired_bytes;
+	IOLockUnlock(this->lock);
+	return bytes;
+}
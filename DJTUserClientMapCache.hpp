@@ -0,0 +1,131 @@
+/*
+kextgizmos' per-user-client cache of kernel mappings of client memory, for
+methods which repeatedly receive large buffers and shouldn't pay for mapping
+and unmapping them on every call.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <IOKit/IOMemoryDescriptor.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+
+/* The IOMemoryDescriptor which IOUserClient creates for an out-of-line struct
+ * argument is new for every call, so it can't serve as a cache key, and
+ * map_struct_arguments() must map it afresh each time. For buffers a client
+ * uses over and over, have the client pass the buffer's address and length as
+ * scalar arguments instead, and resolve them with mapRange(). The first call
+ * for a range creates a wired descriptor over the client's memory and a
+ * kernel mapping; subsequent calls which fall within a cached range just
+ * return the existing mapping.
+ *
+ * Call flush() from clientClose()/clientDied() so client memory isn't kept
+ * wired beyond the client's lifetime, and offer the client a way to call
+ * invalidateRange() before it unmaps or repurposes a buffer, as the cache
+ * otherwise keeps referring to the old pages. Entries are evicted in least
+ * recently used order when the cache is full, or to keep the client's wired
+ * memory within max_wired_bytes. */
+#define DJT_MAP_CACHE_DEFAULT_MAX_WIRED_BYTES (64ull * 1024 * 1024)
+
+class DJTUserClientMapCache : public OSObject
+{
+	OSDeclareDefaultStructors(DJTUserClientMapCache);
+private:
+	typedef OSObject super;
+	
+	struct entry
+	{
+		mach_vm_address_t address;
+		mach_vm_size_t length;
+		IODirection direction;
+		IOMemoryDescriptor* descriptor;
+		IOMemoryMap* map;
+		uint64_t last_use;
+	};
+	
+	task_t task;
+	IOLock* lock;
+	entry* entries;
+	uint32_t max_entries;
+	uint64_t use_counter;
+	uint64_t max_wired_bytes;
+	// Cached ranges plus those being mapped
+	uint64_t wired_bytes;
+	
+	void releaseEntry(entry* e);
+	entry* findEntry(mach_vm_address_t address, mach_vm_size_t length, IODirection direction);
+	void useEntry(entry* e, mach_vm_address_t address, IOMemoryMap** out_map, void** out_kernel_address);
+	entry* leastRecentlyUsed();
+	bool reserveWiredBytes(mach_vm_size_t length);
+
+public:
+	static DJTUserClientMapCache* withTask(
+		task_t client_task, uint32_t max_entries = 8, uint64_t max_wired_bytes = DJT_MAP_CACHE_DEFAULT_MAX_WIRED_BYTES);
+	virtual bool initWithTask(task_t client_task, uint32_t max_entries, uint64_t max_wired_bytes);
+	virtual void free() override;
+	
+	/* Maps [address, address + length) of the client task into the kernel,
+	 * reusing a cached mapping if one covers the range with the required
+	 * direction (kIODirectionOut: kernel reads, kIODirectionIn: kernel writes).
+	 * On success, *out_map holds a retained IOMemoryMap which keeps the mapping
+	 * valid even if it's evicted or invalidated meanwhile; release it when
+	 * done. *out_kernel_address points at 'address' within that mapping.
+	 * Returns kIOReturnNoResources if the range can't be wired within
+	 * max_wired_bytes, even after evicting everything else. */
+	IOReturn mapRange(mach_vm_address_t address, mach_vm_size_t length, IODirection direction, IOMemoryMap** out_map, void** out_kernel_address);
+	
+	// Drops cached mappings overlapping the range.
+	void invalidateRange(mach_vm_address_t address, mach_vm_size_t length);
+	// Drops all cached mappings.
+	void flush();
+	
+	// Bytes of client memory currently wired by the cache.
+	uint64_t getWiredBytes();
+};
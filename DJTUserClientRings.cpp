@@ -0,0 +1,206 @@
+/*
+kextgizmos' shared memory submission/completion rings for issuing user client
+external methods without a trap per call.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTUserClientRings.hpp"
+#include "DJTSPSCRing.hpp"
+#include "userclient.hpp"
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/IOInterruptEventSource.h>
+#include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOLib.h>
+
+OSDefineMetaClassAndStructors(DJTUserClientRings, OSObject);
+
+DJTUserClientRings* DJTUserClientRings::withClient(
+	IOUserClient* client, IOWorkLoop* work_loop, const IOExternalMethodDispatch* methods, uint32_t method_count,
+	uint32_t submission_capacity, uint32_t completion_capacity)
+{
+	DJTUserClientRings* rings = OSTypeAlloc(DJTUserClientRings);
+	if (rings != nullptr && !rings->initWithClient(client, work_loop, methods, method_count, submission_capacity, completion_capacity))
+		OSSafeReleaseNULL(rings);
+	return rings;
+}
+
+bool DJTUserClientRings::initWithClient(
+	IOUserClient* client, IOWorkLoop* work_loop, const IOExternalMethodDispatch* methods, uint32_t method_count,
+	uint32_t submission_capacity, uint32_t completion_capacity)
+{
+	if (!this->super::init())
+		return false;
+	if (client == nullptr || work_loop == nullptr || methods == nullptr)
+		return false;
+	this->client = client;
+	this->methods = methods;
+	this->method_count = method_count;
+	
+	size_t size = djt_spsc_ring_total_size(submission_capacity);
+	this->submission_memory = IOBufferMemoryDescriptor::inTaskWithOptions(
+		kernel_task, kIODirectionInOut | kIOMemoryKernelUserShared, size, page_size);
+	if (this->submission_memory == nullptr)
+		return false;
+	void* submission_address = this->submission_memory->getBytesNoCopy();
+	if (!djt_spsc_ring_init(submission_address, submission_capacity))
+		return false;
+	
+	this->completion_ring = DJTSPSCRing::withCapacity(completion_capacity);
+	if (this->completion_ring == nullptr)
+		return false;
+	
+	this->scratch_size = djt_iouc_ring_server_scratch_size(submission_capacity, completion_capacity);
+	this->scratch = static_cast<uint8_t*>(IOMalloc(this->scratch_size));
+	if (this->scratch == nullptr)
+		return false;
+	// DJTSPSCRing's memory is always an IOBufferMemoryDescriptor
+	IOBufferMemoryDescriptor* completion_memory = static_cast<IOBufferMemoryDescriptor*>(this->completion_ring->getMemoryDescriptor());
+	if (!djt_iouc_ring_server_init(
+		&this->server, submission_address, size,
+		completion_memory->getBytesNoCopy(), completion_capacity,
+		this->scratch, this->scratch_size))
+		return false;
+	
+	this->doorbell = IOInterruptEventSource::interruptEventSource(this, doorbellRung);
+	if (this->doorbell == nullptr)
+		return false;
+	if (work_loop->addEventSource(this->doorbell) != kIOReturnSuccess)
+	{
+		OSSafeReleaseNULL(this->doorbell);
+		return false;
+	}
+	work_loop->retain();
+	this->work_loop = work_loop;
+	
+	return true;
+}
+
+void DJTUserClientRings::free()
+{
+	this->stop();
+	OSSafeReleaseNULL(this->doorbell);
+	OSSafeReleaseNULL(this->completion_ring);
+	OSSafeReleaseNULL(this->submission_memory);
+	if (this->scratch != nullptr)
+	{
+		IOFree(this->scratch, this->scratch_size);
+		this->scratch = nullptr;
+	}
+	this->super::free();
+}
+
+IOMemoryDescriptor* DJTUserClientRings::getSubmissionMemory() const
+{
+	return this->submission_memory;
+}
+
+IOMemoryDescriptor* DJTUserClientRings::getCompletionMemory() const
+{
+	return this->completion_ring->getMemoryDescriptor();
+}
+
+IOReturn DJTUserClientRings::setCompletionNotification(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count)
+{
+	return this->completion_ring->setNotification(wake_port, reference, reference_count);
+}
+
+IOReturn DJTUserClientRings::ringDoorbell()
+{
+	if (__atomic_load_n(&this->broken, __ATOMIC_RELAXED))
+		return kIOReturnIOError;
+	IOInterruptEventSource* doorbell = this->doorbell;
+	if (doorbell == nullptr || this->work_loop == nullptr)
+		return kIOReturnNotOpen;
+	doorbell->interruptOccurred(nullptr, nullptr, 0);
+	return kIOReturnSuccess;
+}
+
+void DJTUserClientRings::stop()
+{
+	if (this->work_loop != nullptr)
+	{
+		if (this->doorbell != nullptr)
+			this->work_loop->removeEventSource(this->doorbell);
+		OSSafeReleaseNULL(this->work_loop);
+	}
+	if (this->completion_ring != nullptr)
+		this->completion_ring->clearNotification();
+}
+
+void DJTUserClientRings::doorbellRung(OSObject* owner, IOInterruptEventSource* sender, int)
+{
+	DJTUserClientRings* rings = OSDynamicCast(DJTUserClientRings, owner);
+	if (rings == nullptr || rings->broken)
+		return;
+	
+	bool wake_client = false;
+	djt_spsc_ring_status status = djt_iouc_ring_drain(&rings->server, dispatchCommand, rings, DRAIN_BATCH, &wake_client);
+	if (wake_client)
+		rings->completion_ring->sendNotification();
+	switch (status)
+	{
+	case DJT_SPSC_RING_OK:
+		// More submissions may be waiting: go round the work loop again.
+		sender->interruptOccurred(nullptr, nullptr, 0);
+		break;
+	case DJT_SPSC_RING_EMPTY:
+	case DJT_SPSC_RING_FULL:
+		// Idle until the next doorbell
+		break;
+	default:
+		__atomic_store_n(&rings->broken, true, __ATOMIC_RELAXED);
+		break;
+	}
+}
+
+void DJTUserClientRings::dispatchCommand(void* context, const djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result)
+{
+	DJTUserClientRings* rings = static_cast<DJTUserClientRings*>(context);
+	djt_dispatch_packed_call(rings->methods, rings->method_count, rings->client, nullptr, *entry, payload, result);
+}
@@ -0,0 +1,131 @@
+/*
+kextgizmos' shared memory submission/completion rings for issuing user client
+external methods without a trap per call.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_iouc_ring.h"
+#include <IOKit/IOUserClient.h>
+#include <libkern/c++/OSObject.h>
+
+class IOBufferMemoryDescriptor;
+class IOInterruptEventSource;
+class IOWorkLoop;
+class DJTSPSCRing;
+
+/* Kernel side of the djt_iouc_ring protocol: commands name selectors in the
+ * same IOExternalMethodDispatch table used for external methods (e.g. built
+ * with DJT_IOUC_METHOD), and run on the given work loop in submission order.
+ * Typical use in an IOUserClient subclass:
+ *  - Create in start(), with the client's work loop and method table.
+ *  - Return getSubmissionMemory()/getCompletionMemory() (retained) from
+ *    clientMemoryForType().
+ *  - Expose ringDoorbell() as a scalar-free external method, and
+ *    setCompletionNotification() as an async one; both must be outside the
+ *    table handed to the rings, so commands can't ring the doorbell.
+ *  - Call stop() from clientClose()/clientDied().
+ *
+ * The rings don't retain the client, which is expected to own them. Commands
+ * are dispatched with no async wake port and a null reference. */
+class DJTUserClientRings : public OSObject
+{
+	OSDeclareDefaultStructors(DJTUserClientRings);
+private:
+	typedef OSObject super;
+	
+	IOUserClient* client;
+	const IOExternalMethodDispatch* methods;
+	uint32_t method_count;
+	IOWorkLoop* work_loop;
+	IOInterruptEventSource* doorbell;
+	IOBufferMemoryDescriptor* submission_memory;
+	DJTSPSCRing* completion_ring;
+	djt_iouc_ring_server_t server;
+	uint8_t* scratch;
+	uint32_t scratch_size;
+	bool broken;
+	
+	static void doorbellRung(OSObject* owner, IOInterruptEventSource* sender, int count);
+	static void dispatchCommand(void* context, const djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result);
+
+public:
+	// Commands processed per work loop pass before yielding to other event sources
+	static const uint32_t DRAIN_BATCH = 64;
+	
+	/* Capacities are the ring data area sizes in bytes and must be powers of two.
+	 * 'methods' must outlive the rings. */
+	static DJTUserClientRings* withClient(
+		IOUserClient* client, IOWorkLoop* work_loop, const IOExternalMethodDispatch* methods, uint32_t method_count,
+		uint32_t submission_capacity, uint32_t completion_capacity);
+	template <size_t NUM_SEL> static DJTUserClientRings* withClient(
+		IOUserClient* client, IOWorkLoop* work_loop, const IOExternalMethodDispatch (&methods)[NUM_SEL],
+		uint32_t submission_capacity, uint32_t completion_capacity)
+	{
+		return withClient(client, work_loop, methods, NUM_SEL, submission_capacity, completion_capacity);
+	}
+	virtual bool initWithClient(
+		IOUserClient* client, IOWorkLoop* work_loop, const IOExternalMethodDispatch* methods, uint32_t method_count,
+		uint32_t submission_capacity, uint32_t completion_capacity);
+	virtual void free() override;
+	
+	IOMemoryDescriptor* getSubmissionMemory() const;
+	IOMemoryDescriptor* getCompletionMemory() const;
+	
+	IOReturn setCompletionNotification(mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count);
+	
+	/* Schedules draining of the submission ring on the work loop. Returns
+	 * kIOReturnIOError once the client has corrupted the rings' shared state,
+	 * and kIOReturnNotOpen after stop(). */
+	IOReturn ringDoorbell();
+	
+	// Detaches from the work loop and disarms the completion notification.
+	void stop();
+};
@@ -0,0 +1,599 @@
+/*
+kextgizmos' work-stealing thread pool, for background work such as checksums,
+compaction or parsing. The scheduler is portable: the same code runs on kernel
+threads in a kext or on pthreads in user space, for testing and benchmarking
+on any host.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_cpu_hints.h"
+#include <stdint.h>
+#ifdef KERNEL
+#include <IOKit/IOLocks.h>
+#include <kern/thread.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Each worker owns a bounded deque (Chase-Lev). Tasks submitted from inside a
+ * running task go to the current worker's deque and are run LIFO, which keeps
+ * their data in cache. Idle workers steal the oldest tasks from other workers'
+ * deques. Tasks submitted from outside the pool go to a shared injection
+ * queue, which submitBatch() fills under one lock acquisition with one round
+ * of wakeups.
+ *
+ * Task objects are intrusive and owned by the caller. They must remain valid
+ * until they have run, which is easiest to ensure with a DJTPoolTaskGroup and
+ * wait(). Tasks must not block for long, as that ties up a worker.
+ *
+ * The PLATFORM parameter supplies the lock/sleep/wakeup and thread start
+ * primitives; see DJTPoolKernelPlatform and DJTPoolPosixPlatform below. */
+
+struct DJTPoolTaskGroup;
+template <typename PLATFORM> class DJTWorkStealingPool;
+template <typename PLATFORM> class DJTPoolWorkerContext;
+
+struct DJTPoolTask
+{
+	// Called on a worker thread; context allows submitting and waiting from inside the task.
+	typedef void (*task_fn)(DJTPoolTask* task, void* context);
+	task_fn function;
+	// Optional; counted down when the task has completed.
+	DJTPoolTaskGroup* group;
+	// Used by the injection queue.
+	DJTPoolTask* next;
+};
+
+// Counts outstanding tasks, for waiting on their completion.
+struct DJTPoolTaskGroup
+{
+	uint32_t pending;
+};
+
+#ifdef KERNEL
+struct DJTPoolKernelPlatform
+{
+	class lock_type
+	{
+		IOLock* lock;
+	public:
+		bool init() { this->lock = IOLockAlloc(); return this->lock != nullptr; }
+		void destroy() { if (this->lock != nullptr) IOLockFree(this->lock); this->lock = nullptr; }
+		void acquire() { IOLockLock(this->lock); }
+		void release() { IOLockUnlock(this->lock); }
+		// Must be called with the lock held; may return spuriously.
+		void sleep(void* event) { IOLockSleep(this->lock, event, THREAD_UNINT); }
+		void wakeupOne(void* event) { IOLockWakeup(this->lock, event, true); }
+		void wakeupAll(void* event) { IOLockWakeup(this->lock, event, false); }
+	};
+	
+	struct thread_start
+	{
+		void (*entry)(void*);
+		void* arg;
+	};
+	static void threadEntry(void* parameter, wait_result_t)
+	{
+		thread_start* start = static_cast<thread_start*>(parameter);
+		start->entry(start->arg);
+		thread_terminate(current_thread());
+	}
+	// start must remain valid until the thread exits.
+	static bool startThread(thread_start* start)
+	{
+		thread_t thread = nullptr;
+		if (kernel_thread_start(threadEntry, start, &thread) != KERN_SUCCESS)
+			return false;
+		thread_deallocate(thread);
+		return true;
+	}
+};
+typedef DJTPoolKernelPlatform DJTPoolDefaultPlatform;
+#else
+struct DJTPoolPosixPlatform
+{
+	/* A single condition variable stands in for the kernel's event-keyed
+	 * waits; all sleepers re-check their predicate, so broadcasting is
+	 * correct, if less efficient. */
+	class lock_type
+	{
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+	public:
+		bool init()
+		{
+			if (pthread_mutex_init(&this->mutex, nullptr) != 0)
+				return false;
+			if (pthread_cond_init(&this->cond, nullptr) != 0)
+			{
+				pthread_mutex_destroy(&this->mutex);
+				return false;
+			}
+			return true;
+		}
+		void destroy() { pthread_cond_destroy(&this->cond); pthread_mutex_destroy(&this->mutex); }
+		void acquire() { pthread_mutex_lock(&this->mutex); }
+		void release() { pthread_mutex_unlock(&this->mutex); }
+		void sleep(void*) { pthread_cond_wait(&this->cond, &this->mutex); }
+		void wakeupOne(void*) { pthread_cond_broadcast(&this->cond); }
+		void wakeupAll(void*) { pthread_cond_broadcast(&this->cond); }
+	};
+	
+	struct thread_start
+	{
+		void (*entry)(void*);
+		void* arg;
+	};
+	static void* threadEntry(void* parameter)
+	{
+		thread_start* start = static_cast<thread_start*>(parameter);
+		start->entry(start->arg);
+		return nullptr;
+	}
+	static bool startThread(thread_start* start)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, nullptr, threadEntry, start) != 0)
+			return false;
+		pthread_detach(thread);
+		return true;
+	}
+};
+typedef DJTPoolPosixPlatform DJTPoolDefaultPlatform;
+#endif
+
+// Bounded Chase-Lev work-stealing deque. push()/pop() by the owner only, steal() by anyone.
+class DJTPoolDeque
+{
+	DJTPoolDeque(const DJTPoolDeque&) = delete;
+	DJTPoolDeque& operator=(const DJTPoolDeque&) = delete;
+	
+	// Padding keeps thieves (top) and owner (bottom) off each other's cache
+	// line; kernel operator new doesn't honour extended alignment.
+	int64_t top;
+	uint8_t top_pad[DJT_CACHE_LINE_SIZE - sizeof(int64_t)];
+	int64_t bottom;
+	uint8_t bottom_pad[DJT_CACHE_LINE_SIZE - sizeof(int64_t)];
+	DJTPoolTask** buffer;
+	int64_t mask;
+
+public:
+	DJTPoolDeque() :
+		top(0), top_pad(), bottom(0), bottom_pad(), buffer(nullptr), mask(0)
+	{
+	}
+	
+	// capacity must be a power of two
+	bool init(uint32_t capacity)
+	{
+		this->buffer = new DJTPoolTask*[capacity];
+		this->mask = static_cast<int64_t>(capacity) - 1;
+		return this->buffer != nullptr;
+	}
+	void destroy()
+	{
+		delete[] this->buffer;
+		this->buffer = nullptr;
+	}
+	
+	// Returns false if full.
+	bool push(DJTPoolTask* task)
+	{
+		int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_RELAXED);
+		int64_t t = __atomic_load_n(&this->top, __ATOMIC_ACQUIRE);
+		if (b - t > this->mask)
+			return false;
+		__atomic_store_n(&this->buffer[b & this->mask], task, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		__atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+		return true;
+	}
+	
+	// Newest task first.
+	DJTPoolTask* pop()
+	{
+		int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_RELAXED) - 1;
+		__atomic_store_n(&this->bottom, b, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int64_t t = __atomic_load_n(&this->top, __ATOMIC_RELAXED);
+		if (t > b)
+		{
+			__atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+			return nullptr;
+		}
+		DJTPoolTask* task = __atomic_load_n(&this->buffer[b & this->mask], __ATOMIC_RELAXED);
+		if (t == b)
+		{
+			// Last item, race against thieves
+			if (!__atomic_compare_exchange_n(&this->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+				task = nullptr;
+			__atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+		}
+		return task;
+	}
+	
+	// Oldest task first. May fail spuriously under contention.
+	DJTPoolTask* steal()
+	{
+		int64_t t = __atomic_load_n(&this->top, __ATOMIC_ACQUIRE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_ACQUIRE);
+		if (t >= b)
+			return nullptr;
+		DJTPoolTask* task = __atomic_load_n(&this->buffer[t & this->mask], __ATOMIC_RELAXED);
+		if (!__atomic_compare_exchange_n(&this->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			return nullptr;
+		return task;
+	}
+};
+
+template <typename PLATFORM = DJTPoolDefaultPlatform> class DJTWorkStealingPool
+{
+	DJTWorkStealingPool(const DJTWorkStealingPool&) = delete;
+	DJTWorkStealingPool& operator=(const DJTWorkStealingPool&) = delete;
+	
+	struct worker
+	{
+		DJTPoolDeque deque;
+		DJTWorkStealingPool* pool;
+		typename PLATFORM::thread_start start;
+		uint32_t index;
+		uint32_t steal_seed;
+	};
+	
+	typename PLATFORM::lock_type lock;
+	worker* workers;
+	uint32_t num_workers;
+	
+	// Protected by lock
+	DJTPoolTask* inject_head;
+	DJTPoolTask* inject_tail;
+	uint32_t running_workers;
+	uint32_t idle_workers;
+	bool stopping;
+	
+	// Tasks queued but not yet picked up by a worker
+	uint32_t queued_tasks;
+	
+	friend class DJTPoolWorkerContext<PLATFORM>;
+	
+	void* idleEvent() { return &this->idle_workers; }
+	void* exitEvent() { return &this->running_workers; }
+	
+	void wakeIdleWorkers(uint32_t count)
+	{
+		if (__atomic_load_n(&this->idle_workers, __ATOMIC_SEQ_CST) == 0)
+			return;
+		this->lock.acquire();
+		if (count >= this->idle_workers)
+			this->lock.wakeupAll(this->idleEvent());
+		else
+			for (uint32_t i = 0; i < count; ++i)
+				this->lock.wakeupOne(this->idleEvent());
+		this->lock.release();
+	}
+	
+	DJTPoolTask* takeInjected()
+	{
+		if (__atomic_load_n(&this->inject_head, __ATOMIC_RELAXED) == nullptr)
+			return nullptr;
+		this->lock.acquire();
+		DJTPoolTask* task = this->inject_head;
+		if (task != nullptr)
+		{
+			__atomic_store_n(&this->inject_head, task->next, __ATOMIC_RELAXED);
+			if (task->next == nullptr)
+				this->inject_tail = nullptr;
+		}
+		this->lock.release();
+		return task;
+	}
+	
+	DJTPoolTask* findTask(worker* self)
+	{
+		DJTPoolTask* task = nullptr;
+		if (self != nullptr)
+			task = self->deque.pop();
+		if (task == nullptr)
+			task = this->takeInjected();
+		if (task == nullptr)
+		{
+			// Start stealing at a pseudo-random victim to spread contention
+			uint32_t start = 0;
+			if (self != nullptr)
+			{
+				self->steal_seed = self->steal_seed * 1103515245u + 12345u;
+				start = (self->steal_seed >> 16) % this->num_workers;
+			}
+			for (uint32_t i = 0; i < this->num_workers && task == nullptr; ++i)
+			{
+				worker* victim = &this->workers[(start + i) % this->num_workers];
+				if (victim != self)
+					task = victim->deque.steal();
+			}
+		}
+		if (task != nullptr)
+			__atomic_fetch_sub(&this->queued_tasks, 1, __ATOMIC_RELAXED);
+		return task;
+	}
+	
+	void runTask(DJTPoolTask* task, worker* self);
+	
+	static void workerMain(void* arg)
+	{
+		worker* self = static_cast<worker*>(arg);
+		DJTWorkStealingPool* pool = self->pool;
+		while (true)
+		{
+			DJTPoolTask* task = pool->findTask(self);
+			if (task != nullptr)
+			{
+				pool->runTask(task, self);
+				continue;
+			}
+			
+			pool->lock.acquire();
+			__atomic_fetch_add(&pool->idle_workers, 1, __ATOMIC_SEQ_CST);
+			while (!pool->stopping && __atomic_load_n(&pool->queued_tasks, __ATOMIC_SEQ_CST) == 0)
+				pool->lock.sleep(pool->idleEvent());
+			__atomic_fetch_sub(&pool->idle_workers, 1, __ATOMIC_RELAXED);
+			bool exit = pool->stopping && __atomic_load_n(&pool->queued_tasks, __ATOMIC_SEQ_CST) == 0;
+			if (exit)
+			{
+				--pool->running_workers;
+				pool->lock.wakeupAll(pool->exitEvent());
+			}
+			pool->lock.release();
+			if (exit)
+				return;
+		}
+	}
+	
+	void enqueueInjected(DJTPoolTask* const tasks[], uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			if (tasks[i]->group != nullptr)
+				__atomic_fetch_add(&tasks[i]->group->pending, 1, __ATOMIC_RELAXED);
+		
+		this->lock.acquire();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			tasks[i]->next = nullptr;
+			if (this->inject_tail != nullptr)
+				this->inject_tail->next = tasks[i];
+			else
+				__atomic_store_n(&this->inject_head, tasks[i], __ATOMIC_RELAXED);
+			this->inject_tail = tasks[i];
+		}
+		__atomic_fetch_add(&this->queued_tasks, count, __ATOMIC_SEQ_CST);
+		this->lock.release();
+		this->wakeIdleWorkers(count);
+	}
+	
+	// Returns once group has no pending tasks; workers help out meanwhile.
+	void waitGroup(DJTPoolTaskGroup* group, worker* self)
+	{
+		while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+		{
+			DJTPoolTask* task = (self != nullptr) ? this->findTask(self) : nullptr;
+			if (task != nullptr)
+			{
+				this->runTask(task, self);
+				continue;
+			}
+			this->lock.acquire();
+			if (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+				this->lock.sleep(group);
+			this->lock.release();
+		}
+	}
+
+public:
+	DJTWorkStealingPool() :
+		workers(nullptr), num_workers(0), inject_head(nullptr), inject_tail(nullptr),
+		running_workers(0), idle_workers(0), stopping(false), queued_tasks(0)
+	{
+	}
+	
+	/* Starts worker_count threads, each with a deque of deque_capacity (power of
+	 * two) entries; when a worker's deque is full, further tasks it submits
+	 * are run inline. */
+	bool start(uint32_t worker_count, uint32_t deque_capacity = 256)
+	{
+		if (worker_count == 0 || (deque_capacity & (deque_capacity - 1)) != 0)
+			return false;
+		if (!this->lock.init())
+			return false;
+		this->workers = new worker[worker_count];
+		if (this->workers == nullptr)
+		{
+			this->lock.destroy();
+			return false;
+		}
+		this->num_workers = worker_count;
+		for (uint32_t i = 0; i < worker_count; ++i)
+		{
+			worker* w = &this->workers[i];
+			w->pool = this;
+			w->index = i;
+			w->steal_seed = i + 1;
+			w->start.entry = workerMain;
+			w->start.arg = w;
+			if (!w->deque.init(deque_capacity))
+			{
+				this->stop();
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < worker_count; ++i)
+		{
+			this->lock.acquire();
+			++this->running_workers;
+			this->lock.release();
+			if (!PLATFORM::startThread(&this->workers[i].start))
+			{
+				this->lock.acquire();
+				--this->running_workers;
+				this->lock.release();
+				this->stop();
+				return false;
+			}
+		}
+		return true;
+	}
+	
+	// Runs all queued tasks to completion, then stops the workers and frees resources.
+	void stop()
+	{
+		if (this->workers == nullptr)
+			return;
+		this->lock.acquire();
+		this->stopping = true;
+		this->lock.wakeupAll(this->idleEvent());
+		while (this->running_workers > 0)
+			this->lock.sleep(this->exitEvent());
+		this->lock.release();
+		
+		for (uint32_t i = 0; i < this->num_workers; ++i)
+			this->workers[i].deque.destroy();
+		delete[] this->workers;
+		this->workers = nullptr;
+		this->num_workers = 0;
+		this->lock.destroy();
+	}
+	
+	~DJTWorkStealingPool()
+	{
+		this->stop();
+	}
+	
+	// From outside the pool. Inside a task, use the DJTPoolWorkerContext instead.
+	void submit(DJTPoolTask* task)
+	{
+		this->enqueueInjected(&task, 1);
+	}
+	void submitBatch(DJTPoolTask* const tasks[], uint32_t count)
+	{
+		if (count > 0)
+			this->enqueueInjected(tasks, count);
+	}
+	
+	// From outside the pool; blocks until all tasks in group have completed.
+	void wait(DJTPoolTaskGroup* group)
+	{
+		this->waitGroup(group, nullptr);
+	}
+	
+	uint32_t workerCount() const
+	{
+		return this->num_workers;
+	}
+};
+
+// Passed as the context argument to task functions.
+template <typename PLATFORM = DJTPoolDefaultPlatform> class DJTPoolWorkerContext
+{
+	typedef DJTWorkStealingPool<PLATFORM> pool_type;
+	pool_type* pool;
+	typename pool_type::worker* self;
+	
+	friend class DJTWorkStealingPool<PLATFORM>;
+	DJTPoolWorkerContext(pool_type* _pool, typename pool_type::worker* _self) :
+		pool(_pool), self(_self)
+	{
+	}
+
+public:
+	static DJTPoolWorkerContext* fromContext(void* context)
+	{
+		return static_cast<DJTPoolWorkerContext*>(context);
+	}
+	
+	// Pushes onto this worker's own deque, where idle workers can steal it.
+	void submit(DJTPoolTask* task)
+	{
+		if (task->group != nullptr)
+			__atomic_fetch_add(&task->group->pending, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&this->pool->queued_tasks, 1, __ATOMIC_SEQ_CST);
+		if (!this->self->deque.push(task))
+		{
+			__atomic_fetch_sub(&this->pool->queued_tasks, 1, __ATOMIC_RELAXED);
+			this->pool->runTask(task, this->self);
+			return;
+		}
+		this->pool->wakeIdleWorkers(1);
+	}
+	
+	// Runs other tasks while waiting, so it's safe to wait for subtasks from inside a task.
+	void wait(DJTPoolTaskGroup* group)
+	{
+		this->pool->waitGroup(group, this->self);
+	}
+	
+	uint32_t workerIndex() const
+	{
+		return this->self->index;
+	}
+};
+
+template <typename PLATFORM> void DJTWorkStealingPool<PLATFORM>::runTask(DJTPoolTask* task, worker* self)
+{
+	DJTPoolWorkerContext<PLATFORM> context(this, self);
+	DJTPoolTaskGroup* group = task->group;
+	task->function(task, &context);
+	// The task object may be gone once the group is released
+	if (group != nullptr && __atomic_sub_fetch(&group->pending, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		this->lock.acquire();
+		this->lock.wakeupAll(group);
+		this->lock.release();
+	}
+}
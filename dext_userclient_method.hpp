@@ -0,0 +1,466 @@
+/*
+kextgizmos dext_userclient_method: signature-driven DriverKit ExternalMethod
+dispatch, the counterpart of userclient_method in userclient.hpp.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <TargetConditionals.h>
+
+#if TARGET_OS_DRIVERKIT
+
+#if __cplusplus < 201703L
+#error dext_userclient_method.hpp requires C++17 or later
+#endif
+
+#include <DriverKit/IOUserClient.h>
+#include <DriverKit/IOMemoryDescriptor.h>
+#include <DriverKit/IOMemoryMap.h>
+#include <DriverKit/OSData.h>
+#include <DriverKit/OSAction.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* As with userclient_method for kexts, each method's parameter types determine
+ * its IOUserClientMethodDispatch entry and how IOUserClientMethodArguments are
+ * unpacked, so no hand-written ExternalMethod switch statements:
+ *
+ *   static const IOUserClientMethodDispatch methods[] = {
+ *     DJT_DEXT_METHOD(MyUserClient::readStatus),
+ *     DJT_DEXT_METHOD(MyUserClient::writeBlock),
+ *   };
+ *   kern_return_t MyUserClient::ExternalMethod(uint64_t selector, IOUserClientMethodArguments* arguments,
+ *     const IOUserClientMethodDispatch* dispatch, OSObject* target, void* reference)
+ *   {
+ *     return djt_dext_dispatch_methods(methods, this, selector, arguments, dispatch, target, reference);
+ *   }
+ *
+ * Parameter types are classified as in userclient.hpp: uint64_t* is a scalar
+ * output, (const void*, size_t) a variable sized struct input, (void*, size_t)
+ * a variable sized struct output, other const T* a fixed size struct input,
+ * other T* a fixed size struct output, and anything else a scalar input. The
+ * async triple is replaced by OSAction*, which receives the call's completion
+ * action (and requires one).
+ *
+ * Struct inputs are passed straight from the OSData the runtime supplies.
+ * Inputs too large for that arrive as structureInputDescriptor, which is only
+ * mapped if the method actually takes a struct input. Struct outputs are
+ * written into a buffer on the dispatcher's stack and returned as OSData, or
+ * directly into a mapping of structureOutputDescriptor for large outputs. The
+ * wrapper does not allocate otherwise; the OSData and mappings are required by
+ * the DriverKit ABI. */
+
+// Largest struct output returned inline (as OSData) rather than by descriptor
+#define DJT_DEXT_INLINE_STRUCT_MAX 4096u
+
+namespace
+{
+	/* Per-call struct argument state. Only methods which take a struct input or
+	 * output get the real thing; for the rest, these compile to nothing. */
+	template <bool HAS_STRUCT_INPUT> struct dext_struct_input_state
+	{
+		kern_return_t prepare(IOUserClientMethodArguments* arguments) { return kIOReturnSuccess; }
+		void release() {}
+	};
+	template <> struct dext_struct_input_state<true>
+	{
+		IOMemoryMap* map = nullptr;
+		const void* bytes = nullptr;
+		size_t length = 0;
+		
+		kern_return_t prepare(IOUserClientMethodArguments* arguments)
+		{
+			if (arguments->structureInput != nullptr)
+			{
+				this->bytes = arguments->structureInput->getBytesNoCopy();
+				this->length = arguments->structureInput->getLength();
+			}
+			else if (arguments->structureInputDescriptor != nullptr)
+			{
+				uint64_t length = 0;
+				kern_return_t result = arguments->structureInputDescriptor->GetLength(&length);
+				if (result != kIOReturnSuccess)
+					return result;
+				result = arguments->structureInputDescriptor->CreateMapping(kIOMemoryMapReadOnly, 0, 0, 0, 0, &this->map);
+				if (result != kIOReturnSuccess)
+					return result;
+				this->bytes = reinterpret_cast<const void*>(this->map->GetAddress());
+				this->length = static_cast<size_t>(length);
+			}
+			return kIOReturnSuccess;
+		}
+		void release()
+		{
+			OSSafeReleaseNULL(this->map);
+		}
+	};
+	
+	template <bool HAS_STRUCT_OUTPUT, size_t INLINE_CAPACITY> struct dext_struct_output_state
+	{
+		kern_return_t prepare(IOUserClientMethodArguments* arguments) { return kIOReturnSuccess; }
+		kern_return_t finish(IOUserClientMethodArguments* arguments, kern_return_t result) { return result; }
+		void release() {}
+	};
+	template <size_t INLINE_CAPACITY> struct dext_struct_output_state<true, INLINE_CAPACITY>
+	{
+		IOMemoryMap* map = nullptr;
+		void* bytes = nullptr;
+		size_t length = 0;
+		alignas(16) uint8_t inline_buffer[INLINE_CAPACITY];
+		
+		kern_return_t prepare(IOUserClientMethodArguments* arguments)
+		{
+			if (arguments->structureOutputDescriptor != nullptr)
+			{
+				uint64_t length = 0;
+				kern_return_t result = arguments->structureOutputDescriptor->GetLength(&length);
+				if (result != kIOReturnSuccess)
+					return result;
+				result = arguments->structureOutputDescriptor->CreateMapping(0, 0, 0, 0, 0, &this->map);
+				if (result != kIOReturnSuccess)
+					return result;
+				this->bytes = reinterpret_cast<void*>(this->map->GetAddress());
+				this->length = static_cast<size_t>(length);
+			}
+			else
+			{
+				if (arguments->structureOutputMaximumSize > INLINE_CAPACITY)
+					return kIOReturnBadArgument;
+				this->bytes = this->inline_buffer;
+				this->length = static_cast<size_t>(arguments->structureOutputMaximumSize);
+				// finish() returns all of it, whether or not the method writes every byte
+				memset(this->inline_buffer, 0, this->length);
+			}
+			return kIOReturnSuccess;
+		}
+		// Hands inline output back to the runtime, which releases the OSData
+		kern_return_t finish(IOUserClientMethodArguments* arguments, kern_return_t result)
+		{
+			if (result != kIOReturnSuccess || this->map != nullptr || this->length == 0)
+				return result;
+			arguments->structureOutput = OSData::withBytes(this->inline_buffer, this->length);
+			return arguments->structureOutput != nullptr ? kIOReturnSuccess : kIOReturnNoMemory;
+		}
+		void release()
+		{
+			OSSafeReleaseNULL(this->map);
+		}
+	};
+	
+	/* Argument selectors: each extracts one method argument from the call, and
+	 * records what it contributes to the method's dispatch entry. */
+	struct dext_arg_sel_base
+	{
+		static constexpr uint32_t scalar_inputs = 0;
+		static constexpr uint32_t scalar_outputs = 0;
+		static constexpr uint32_t struct_inputs = 0;
+		static constexpr uint64_t struct_input_size = 0;
+		static constexpr uint32_t struct_outputs = 0;
+		static constexpr uint64_t struct_output_size = 0;
+		static constexpr bool completion = false;
+	};
+	
+	template <typename T, int I> struct dext_arg_sel_scalar_input : dext_arg_sel_base
+	{
+		typedef T type;
+		static constexpr uint32_t scalar_inputs = 1;
+		template <class STATE> static T extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return static_cast<T>(arguments->scalarInput[I]);
+		}
+	};
+	template <int I> struct dext_arg_sel_scalar_output : dext_arg_sel_base
+	{
+		typedef uint64_t* type;
+		static constexpr uint32_t scalar_outputs = 1;
+		template <class STATE> static uint64_t* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return &arguments->scalarOutput[I];
+		}
+	};
+	template <typename T> struct dext_arg_sel_fixed_struct_input : dext_arg_sel_base
+	{
+		typedef const T* type;
+		static_assert(sizeof(T) > 0, "zero-sized input structs not allowed");
+		static constexpr uint32_t struct_inputs = 1;
+		static constexpr uint64_t struct_input_size = sizeof(T);
+		template <class STATE> static const T* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return static_cast<const T*>(state.input.bytes);
+		}
+	};
+	struct dext_arg_sel_variable_struct_input_ptr : dext_arg_sel_base
+	{
+		typedef const void* type;
+		static constexpr uint32_t struct_inputs = 1;
+		static constexpr uint64_t struct_input_size = kIOUserClientVariableStructureSize;
+		template <class STATE> static const void* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return state.input.bytes;
+		}
+	};
+	struct dext_arg_sel_variable_struct_input_size : dext_arg_sel_base
+	{
+		typedef size_t type;
+		template <class STATE> static size_t extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return state.input.length;
+		}
+	};
+	template <typename T> struct dext_arg_sel_fixed_struct_output : dext_arg_sel_base
+	{
+		typedef T* type;
+		static_assert(sizeof(T) > 0, "No zero-sized output struct types");
+		static_assert(alignof(T) <= 16, "Output struct alignment exceeds the inline buffer's");
+		static constexpr uint32_t struct_outputs = 1;
+		static constexpr uint64_t struct_output_size = sizeof(T);
+		template <class STATE> static T* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return static_cast<T*>(state.output.bytes);
+		}
+	};
+	struct dext_arg_sel_variable_struct_output_ptr : dext_arg_sel_base
+	{
+		typedef void* type;
+		static constexpr uint32_t struct_outputs = 1;
+		static constexpr uint64_t struct_output_size = kIOUserClientVariableStructureSize;
+		template <class STATE> static void* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return state.output.bytes;
+		}
+	};
+	struct dext_arg_sel_variable_struct_output_size : dext_arg_sel_base
+	{
+		typedef size_t type;
+		template <class STATE> static size_t extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return state.output.length;
+		}
+	};
+	struct dext_arg_sel_completion : dext_arg_sel_base
+	{
+		typedef OSAction* type;
+		static constexpr bool completion = true;
+		template <class STATE> static OSAction* extract_argument(IOUserClientMethodArguments* arguments, STATE& state)
+		{
+			return arguments->completion;
+		}
+	};
+	
+	/* The method's argument selector sequence, and the dispatch entry values
+	 * and per-call state it implies. */
+	template <typename... ARGSELS> struct dext_arg_seq
+	{
+		static constexpr uint32_t scalar_inputs = (0 + ... + ARGSELS::scalar_inputs);
+		static constexpr uint32_t scalar_outputs = (0 + ... + ARGSELS::scalar_outputs);
+		static_assert((0 + ... + ARGSELS::struct_inputs) <= 1, "Only one struct input allowed.");
+		static_assert((0 + ... + ARGSELS::struct_outputs) <= 1, "Only one struct output allowed.");
+		static constexpr uint32_t struct_input_size = static_cast<uint32_t>((0 + ... + ARGSELS::struct_input_size));
+		static constexpr uint32_t struct_output_size = static_cast<uint32_t>((0 + ... + ARGSELS::struct_output_size));
+		static constexpr bool completion = (false || ... || ARGSELS::completion);
+		
+		static constexpr bool has_struct_input = (0 + ... + ARGSELS::struct_inputs) > 0;
+		static constexpr bool has_struct_output = (0 + ... + ARGSELS::struct_outputs) > 0;
+		// Fixed size outputs only need their own size inline
+		static constexpr size_t inline_output_capacity =
+			(struct_output_size != kIOUserClientVariableStructureSize && struct_output_size <= DJT_DEXT_INLINE_STRUCT_MAX)
+			? struct_output_size : DJT_DEXT_INLINE_STRUCT_MAX;
+		
+		struct state
+		{
+			dext_struct_input_state<has_struct_input> input;
+			dext_struct_output_state<has_struct_output, inline_output_capacity> output;
+			
+			kern_return_t prepare(IOUserClientMethodArguments* arguments)
+			{
+				kern_return_t result = this->input.prepare(arguments);
+				if (result == kIOReturnSuccess)
+					result = this->output.prepare(arguments);
+				if (result != kIOReturnSuccess)
+					return result;
+				// The runtime checks fixed struct sizes against the dispatch entry; this just guards the pointers handed to the method
+				if constexpr (has_struct_input && struct_input_size != kIOUserClientVariableStructureSize)
+				{
+					if (this->input.length < struct_input_size)
+						return kIOReturnBadArgument;
+				}
+				if constexpr (has_struct_output && struct_output_size != kIOUserClientVariableStructureSize)
+				{
+					if (this->output.length < struct_output_size)
+						return kIOReturnBadArgument;
+				}
+				return kIOReturnSuccess;
+			}
+			void release()
+			{
+				this->output.release();
+				this->input.release();
+			}
+		};
+	};
+	
+	// Builds the dext_arg_seq for a method's parameter types, as arg_seq_accum in userclient.hpp.
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARG_SEQ, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum;
+	
+	// Scalar inputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename T, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, T, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT + 1, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_scalar_input<T, NEXT_INPUT>>, REMAIN_ARGS...>::seq seq;
+	};
+	// Scalar outputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, uint64_t*, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT + 1,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_scalar_output<NEXT_OUTPUT>>, REMAIN_ARGS...>::seq seq;
+	};
+	// Fixed size struct inputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename T, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, const T*, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_fixed_struct_input<T>>, REMAIN_ARGS...>::seq seq;
+	};
+	// Variable size struct inputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, const void*, size_t, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_variable_struct_input_ptr, dext_arg_sel_variable_struct_input_size>, REMAIN_ARGS...>::seq seq;
+	};
+	// Fixed size struct outputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename T, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, T*, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_fixed_struct_output<T>>, REMAIN_ARGS...>::seq seq;
+	};
+	// Variable size struct outputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, void*, size_t, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_variable_struct_output_ptr, dext_arg_sel_variable_struct_output_size>, REMAIN_ARGS...>::seq seq;
+	};
+	// Completion action of async methods
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>, OSAction*, REMAIN_ARGS...>
+	{
+		typedef typename dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT,
+			dext_arg_seq<ARGSELS..., dext_arg_sel_completion>, REMAIN_ARGS...>::seq seq;
+	};
+	// Termination condition
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS>
+		struct dext_arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, dext_arg_seq<ARGSELS...>>
+	{
+		typedef dext_arg_seq<ARGSELS...> seq;
+	};
+	
+	template <typename MethodPointerSignature, MethodPointerSignature METHOD> struct dext_userclient_method;
+	template <class UCC, typename... Args, kern_return_t(UCC::*METHOD)(Args...)>
+	struct dext_userclient_method<kern_return_t(UCC::*)(Args...), METHOD>
+	{
+		typedef typename dext_arg_seq_accum<0, 0, dext_arg_seq<>, Args...>::seq seq;
+		
+		template <typename... ARGSELS>
+			static kern_return_t apply_fn(UCC* target, IOUserClientMethodArguments* arguments, dext_arg_seq<ARGSELS...>)
+		{
+			typename seq::state state;
+			kern_return_t result = state.prepare(arguments);
+			if (result == kIOReturnSuccess)
+			{
+				result = (target->*METHOD)(ARGSELS::extract_argument(arguments, state) ...);
+				result = state.output.finish(arguments, result);
+			}
+			state.release();
+			return result;
+		}
+		
+		static kern_return_t external_method(OSObject* target, void* reference, IOUserClientMethodArguments* arguments)
+		{
+			UCC* uc = OSDynamicCast(UCC, target);
+			if (!uc)
+				return kIOReturnBadArgument;
+			return apply_fn(uc, arguments, seq());
+		}
+		
+		constexpr static const IOUserClientMethodDispatch dispatch = {
+			external_method,
+			seq::completion,
+			seq::scalar_inputs,
+			seq::struct_input_size,
+			seq::scalar_outputs,
+			seq::struct_output_size
+		};
+	};
+	
+	/* Call from the user client's ExternalMethod(): dispatches selectors in the
+	 * table with the client as target, and passes everything else on to
+	 * IOUserClient::ExternalMethod() unchanged. */
+	template <size_t NUM_SEL> kern_return_t djt_dext_dispatch_methods(
+		const IOUserClientMethodDispatch (&methods)[NUM_SEL], IOUserClient* client, uint64_t selector, IOUserClientMethodArguments* arguments,
+		const IOUserClientMethodDispatch* dispatch, OSObject* target, void* reference)
+	{
+		if (selector < NUM_SEL && methods[selector].function != nullptr)
+		{
+			dispatch = &methods[selector];
+			target = client;
+		}
+		return client->IOUserClient::ExternalMethod(selector, arguments, dispatch, target, reference);
+	}
+}
+
+#define DJT_DEXT_METHOD(METHOD) dext_userclient_method<decltype(&METHOD), &METHOD>::dispatch
+
+#endif
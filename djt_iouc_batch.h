@@ -0,0 +1,178 @@
+/*
+kextgizmos' packed record format for batching many external method calls into
+a single IOConnectCallMethod, shared between the kext and user space.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The batch selector's struct input is a djt_iouc_batch_header followed by
+ * 'count' entries, each a djt_iouc_batch_entry, then scalar_input_count
+ * uint64_t scalars, then struct_input_size bytes of struct input, padded to 8
+ * bytes.
+ *
+ * Its struct output is a djt_iouc_batch_header ('count' being the number of
+ * entries processed) followed by one result per entry: a djt_iouc_batch_result,
+ * then scalar_output_count uint64_t slots, then struct_output_size bytes (the
+ * capacity requested in the entry), padded to 8 bytes. Result sizes depend
+ * only on the entry, so user space knows where each result is before the call.
+ *
+ * Entries are dispatched in order through the same method table as individual
+ * calls, so argument count/size checks are identical. Asynchronous methods are
+ * not supported in batches: they see no wake port. */
+struct djt_iouc_batch_header
+{
+	uint32_t count;
+	uint32_t flags;
+};
+
+// Stop processing at the first entry which does not return kIOReturnSuccess.
+#define DJT_IOUC_BATCH_STOP_ON_ERROR 0x1u
+
+struct djt_iouc_batch_entry
+{
+	uint32_t selector;
+	uint16_t scalar_input_count;
+	uint16_t scalar_output_count;
+	uint32_t struct_input_size;
+	uint32_t struct_output_size;
+};
+
+struct djt_iouc_batch_result
+{
+	int32_t result; // IOReturn
+	uint16_t scalar_output_count;
+	uint16_t reserved;
+	uint32_t struct_output_size;
+	uint32_t reserved2;
+};
+
+// Matches the IOUserClient limit on scalar arguments per call.
+#define DJT_IOUC_BATCH_MAX_SCALARS 16u
+
+// 64-bit so sizes near UINT32_MAX don't wrap round to a small padded size.
+static inline uint64_t djt_iouc_batch_pad(uint64_t size)
+{
+	return (size + 7u) & ~(uint64_t)7u;
+}
+
+static inline uint64_t djt_iouc_batch_entry_size(const struct djt_iouc_batch_entry* entry)
+{
+	return sizeof(*entry) + sizeof(uint64_t) * (uint64_t)entry->scalar_input_count
+		+ djt_iouc_batch_pad(entry->struct_input_size);
+}
+
+static inline uint64_t djt_iouc_batch_result_size(const struct djt_iouc_batch_entry* entry)
+{
+	return sizeof(struct djt_iouc_batch_result) + sizeof(uint64_t) * (uint64_t)entry->scalar_output_count
+		+ djt_iouc_batch_pad(entry->struct_output_size);
+}
+
+/* User space helper: appends an entry to the batch in 'buffer', whose first
+ * *used bytes are already occupied (start with *used = 0, which writes the
+ * header). *result_size accumulates the struct output size the batch needs.
+ * Returns 0 on success, -1 if the buffer is too small or counts too large. */
+static inline int djt_iouc_batch_append(
+	void* buffer, size_t buffer_size, size_t* used, size_t* result_size,
+	uint32_t selector, const uint64_t* scalars, uint32_t scalar_input_count, const void* struct_input, uint32_t struct_input_size,
+	uint32_t scalar_output_count, uint32_t struct_output_size)
+{
+	struct djt_iouc_batch_header* header = (struct djt_iouc_batch_header*)buffer;
+	struct djt_iouc_batch_entry entry;
+	uint64_t size;
+	char* pos;
+	
+	if (scalar_input_count > DJT_IOUC_BATCH_MAX_SCALARS || scalar_output_count > DJT_IOUC_BATCH_MAX_SCALARS)
+		return -1;
+	if (*used == 0)
+	{
+		if (buffer_size < sizeof(*header))
+			return -1;
+		header->count = 0;
+		header->flags = 0;
+		*used = sizeof(*header);
+		*result_size = sizeof(*header);
+	}
+	
+	entry.selector = selector;
+	entry.scalar_input_count = (uint16_t)scalar_input_count;
+	entry.scalar_output_count = (uint16_t)scalar_output_count;
+	entry.struct_input_size = struct_input_size;
+	entry.struct_output_size = struct_output_size;
+	size = djt_iouc_batch_entry_size(&entry);
+	if (size > buffer_size - *used)
+		return -1;
+	
+	pos = (char*)buffer + *used;
+	memcpy(pos, &entry, sizeof(entry));
+	pos += sizeof(entry);
+	if (scalar_input_count > 0)
+		memcpy(pos, scalars, sizeof(uint64_t) * scalar_input_count);
+	pos += sizeof(uint64_t) * scalar_input_count;
+	if (struct_input_size > 0)
+		memcpy(pos, struct_input, struct_input_size);
+	memset(pos + struct_input_size, 0, djt_iouc_batch_pad(struct_input_size) - struct_input_size);
+	
+	*used += (size_t)size;
+	*result_size += (size_t)djt_iouc_batch_result_size(&entry);
+	++header->count;
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,383 @@
+/*
+kextgizmos' user space proxies for calling userclient_method external methods,
+deriving the IOConnectCallMethod argument shape from the method's signature.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#ifdef KERNEL
+#error djt_iouc_client.hpp is for user space; see userclient.hpp for the kext side
+#endif
+
+#include <IOKit/IOKitLib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "djt_iouc_sg.h"
+
+/* The kext's userclient_method derives the scalar counts and struct sizes of
+ * each external method from the method's parameter types. This header applies
+ * the same rules to the same parameter types in user space, so callers can't
+ * get the call shape wrong:
+ *
+ *   // Shared header: the method signature, minus the class
+ *   typedef IOReturn MyUserClient_readStatus_signature(uint32_t channel, struct status* out_status);
+ *
+ *   // Kext: checks the method really has this signature
+ *   DJT_IOUC_CHECK_SIGNATURE(MyUserClient::readStatus, MyUserClient_readStatus_signature);
+ *
+ *   // User space
+ *   typedef djt_iouc_proxy<MyUserClient_readStatus_signature, kMyUserClient_readStatus> read_status;
+ *   IOReturn result = read_status::call(connection, 3, &status);
+ *
+ * call_with_output_size() additionally returns the struct output size the
+ * kext reported, i.e. how much of a (void*, size_t) output it filled:
+ *   size_t length;
+ *   result = read_log::call_with_output_size(connection, &length, buffer, sizeof(buffer));
+ *
+ * Parameters are classified as in userclient.hpp: uint64_t* is a scalar
+ * output, (const void*, size_t) a variable sized struct input, (void*, size_t)
+ * a variable sized struct output, other const T* a fixed size struct input,
+ * djt_iouc_wired_input a variable sized struct input which the kext receives
+ * wired rather than mapped, djt_iouc_sg_input a scatter-gather table, other T* a fixed size struct output, (mach_port_t,
+ * io_user_reference_t*, uint32_t) the async triple, which selects
+ * IOConnectCallAsyncMethod, and anything else a scalar input. Note that mach_port_t is a 32 bit integer in
+ * user space, so signatures containing a (uint32_t, uint64_t*, uint32_t)
+ * parameter run are read as async here but not in the kext; avoid them.
+ *
+ * All calls go through IOConnectCallMethod/IOConnectCallAsyncMethod with the
+ * exact struct sizes, so struct arguments larger than the inline limit
+ * (DJT_IOUC_INLINE_STRUCT_LIMIT) always travel out of line, and arrive in the
+ * kext as a memory descriptor which map_struct_arguments() maps once. The
+ * *_out_of_line constants tell callers at compile time whether that applies
+ * to a fixed size struct. */
+
+/* User space side of the kext's djt_iouc_wired_input parameter type: the
+ * buffer is passed as the struct input, which the kext receives as a wired
+ * memory descriptor instead of a kernel mapping. Buffers above the inline
+ * limit are thus DMA'd directly from the caller's pages. */
+struct djt_iouc_wired_input
+{
+	const void* data;
+	size_t length;
+};
+
+/* User space side of the kext's djt_iouc_sg_input parameter type: a segment
+ * table encoded with djt_iouc_sg_encode(), passed as the struct input. Only
+ * the table (and any inline data) is copied; the ranges it refers to are
+ * mapped by the kext. */
+struct djt_iouc_sg_input
+{
+	const void* table;
+	size_t table_size;
+};
+
+#define DJT_IOUC_INLINE_STRUCT_LIMIT 4096u
+#define DJT_IOUC_MAX_SCALARS 16u
+
+struct djt_iouc_call_state
+{
+	uint64_t scalar_input[DJT_IOUC_MAX_SCALARS];
+	uint32_t scalar_input_count;
+	uint64_t scalar_output[DJT_IOUC_MAX_SCALARS];
+	uint64_t* scalar_output_dest[DJT_IOUC_MAX_SCALARS];
+	uint32_t scalar_output_count;
+	const void* struct_input;
+	size_t struct_input_size;
+	void* struct_output;
+	size_t struct_output_size;
+	bool async;
+	mach_port_t wake_port;
+	uint64_t* reference;
+	uint32_t reference_count;
+};
+
+/* Each specialisation consumes the leading parameter(s) it recognises and
+ * records them in the call state, and also computes the static call shape.
+ * Mirrors the arg_seq_accum specialisations in userclient.hpp. */
+template <typename... Args> struct djt_iouc_collect;
+
+template <> struct djt_iouc_collect<>
+{
+	static const uint32_t scalar_inputs = 0;
+	static const uint32_t scalar_outputs = 0;
+	static const size_t struct_input_size = 0;
+	static const size_t struct_output_size = 0;
+	static const bool is_async = false;
+	static void apply(djt_iouc_call_state&)
+	{}
+};
+
+// Scalar input
+template <typename T, typename... Rest> struct djt_iouc_collect<T, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static const uint32_t scalar_inputs = 1 + rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = rest::struct_input_size;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, T value, Rest... args)
+	{
+		state.scalar_input[state.scalar_input_count++] = static_cast<uint64_t>(value);
+		rest::apply(state, args...);
+	}
+};
+
+// Scalar output
+template <typename... Rest> struct djt_iouc_collect<uint64_t*, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = 1 + rest::scalar_outputs;
+	static const size_t struct_input_size = rest::struct_input_size;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, uint64_t* value, Rest... args)
+	{
+		state.scalar_output_dest[state.scalar_output_count++] = value;
+		rest::apply(state, args...);
+	}
+};
+
+// Fixed size struct input
+template <typename T, typename... Rest> struct djt_iouc_collect<const T*, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_input_size == 0, "Only one struct input allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = sizeof(T);
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, const T* value, Rest... args)
+	{
+		state.struct_input = value;
+		state.struct_input_size = sizeof(T);
+		rest::apply(state, args...);
+	}
+};
+
+// Variable size struct input
+template <typename... Rest> struct djt_iouc_collect<const void*, size_t, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_input_size == 0, "Only one struct input allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = SIZE_MAX;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, const void* value, size_t size, Rest... args)
+	{
+		state.struct_input = value;
+		state.struct_input_size = size;
+		rest::apply(state, args...);
+	}
+};
+
+// Wired struct input
+template <typename... Rest> struct djt_iouc_collect<djt_iouc_wired_input, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_input_size == 0, "Only one struct input allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = SIZE_MAX;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, djt_iouc_wired_input value, Rest... args)
+	{
+		state.struct_input = value.data;
+		state.struct_input_size = value.length;
+		rest::apply(state, args...);
+	}
+};
+
+// Scatter-gather struct input
+template <typename... Rest> struct djt_iouc_collect<djt_iouc_sg_input, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_input_size == 0, "Only one struct input allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = SIZE_MAX;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, djt_iouc_sg_input value, Rest... args)
+	{
+		state.struct_input = value.table;
+		state.struct_input_size = value.table_size;
+		rest::apply(state, args...);
+	}
+};
+
+// Fixed size struct output
+template <typename T, typename... Rest> struct djt_iouc_collect<T*, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_output_size == 0, "Only one struct output allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = rest::struct_input_size;
+	static const size_t struct_output_size = sizeof(T);
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, T* value, Rest... args)
+	{
+		state.struct_output = value;
+		state.struct_output_size = sizeof(T);
+		rest::apply(state, args...);
+	}
+};
+
+// Variable size struct output
+template <typename... Rest> struct djt_iouc_collect<void*, size_t, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static_assert(rest::struct_output_size == 0, "Only one struct output allowed.");
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = rest::struct_input_size;
+	static const size_t struct_output_size = SIZE_MAX;
+	static const bool is_async = rest::is_async;
+	static void apply(djt_iouc_call_state& state, void* value, size_t size, Rest... args)
+	{
+		state.struct_output = value;
+		state.struct_output_size = size;
+		rest::apply(state, args...);
+	}
+};
+
+// Async triple
+template <typename... Rest> struct djt_iouc_collect<mach_port_t, io_user_reference_t*, uint32_t, Rest...>
+{
+	typedef djt_iouc_collect<Rest...> rest;
+	static const uint32_t scalar_inputs = rest::scalar_inputs;
+	static const uint32_t scalar_outputs = rest::scalar_outputs;
+	static const size_t struct_input_size = rest::struct_input_size;
+	static const size_t struct_output_size = rest::struct_output_size;
+	static const bool is_async = true;
+	static void apply(djt_iouc_call_state& state, mach_port_t wake_port, io_user_reference_t* reference, uint32_t reference_count, Rest... args)
+	{
+		state.async = true;
+		state.wake_port = wake_port;
+		state.reference = reference;
+		state.reference_count = reference_count;
+		rest::apply(state, args...);
+	}
+};
+
+template <typename Signature> struct djt_iouc_client_method;
+
+template <typename... Args> struct djt_iouc_client_method<IOReturn(Args...)>
+{
+	typedef djt_iouc_collect<Args...> shape;
+	static_assert(shape::scalar_inputs <= DJT_IOUC_MAX_SCALARS, "Too many scalar inputs");
+	static_assert(shape::scalar_outputs <= DJT_IOUC_MAX_SCALARS, "Too many scalar outputs");
+	
+	static const uint32_t scalar_inputs = shape::scalar_inputs;
+	static const uint32_t scalar_outputs = shape::scalar_outputs;
+	// SIZE_MAX for variable sized structs
+	static const size_t struct_input_size = shape::struct_input_size;
+	static const size_t struct_output_size = shape::struct_output_size;
+	static const bool is_async = shape::is_async;
+	static const bool struct_input_out_of_line = struct_input_size != SIZE_MAX && struct_input_size > DJT_IOUC_INLINE_STRUCT_LIMIT;
+	static const bool struct_output_out_of_line = struct_output_size != SIZE_MAX && struct_output_size > DJT_IOUC_INLINE_STRUCT_LIMIT;
+	
+	static IOReturn call(io_connect_t connection, uint32_t selector, Args... args)
+	{
+		return call_with_output_size(connection, selector, nullptr, args...);
+	}
+	
+	/* As call(), also storing the struct output size the kext reported in
+	 * *out_struct_output_size (if not null). For a (void*, size_t) output that
+	 * is the number of bytes actually written, which may be less than the
+	 * buffer size passed in. */
+	static IOReturn call_with_output_size(io_connect_t connection, uint32_t selector, size_t* out_struct_output_size, Args... args)
+	{
+		djt_iouc_call_state state = {};
+		shape::apply(state, args...);
+		
+		uint32_t scalar_output_count = state.scalar_output_count;
+		size_t struct_output_size = state.struct_output_size;
+		IOReturn result;
+		if (state.async)
+		{
+			result = IOConnectCallAsyncMethod(
+				connection, selector, state.wake_port, state.reference, state.reference_count,
+				state.scalar_input, state.scalar_input_count, state.struct_input, state.struct_input_size,
+				state.scalar_output, &scalar_output_count, state.struct_output, &struct_output_size);
+		}
+		else
+		{
+			result = IOConnectCallMethod(
+				connection, selector,
+				state.scalar_input, state.scalar_input_count, state.struct_input, state.struct_input_size,
+				state.scalar_output, &scalar_output_count, state.struct_output, &struct_output_size);
+		}
+		for (uint32_t i = 0; i < state.scalar_output_count && i < scalar_output_count; ++i)
+			*state.scalar_output_dest[i] = state.scalar_output[i];
+		if (out_struct_output_size != nullptr)
+			*out_struct_output_size = struct_output_size;
+		return result;
+	}
+};
+
+// Binds a signature to its selector, e.g. from DJT_IOUC_SELECTOR_ENUM.
+template <typename Signature, uint32_t SELECTOR> struct djt_iouc_proxy : djt_iouc_client_method<Signature>
+{
+	template <typename... Args> static IOReturn call(io_connect_t connection, Args&&... args)
+	{
+		return djt_iouc_client_method<Signature>::call(connection, SELECTOR, static_cast<Args&&>(args)...);
+	}
+	template <typename... Args> static IOReturn call_with_output_size(io_connect_t connection, size_t* out_struct_output_size, Args&&... args)
+	{
+		return djt_iouc_client_method<Signature>::call_with_output_size(connection, SELECTOR, out_struct_output_size, static_cast<Args&&>(args)...);
+	}
+};
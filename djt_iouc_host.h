@@ -0,0 +1,389 @@
+/*
+Host stand-ins for the kernel types used by userclient.hpp, so user client
+dispatch code can be compiled, tested and benchmarked outside the kernel, e.g.
+on Linux. Define DJT_IOUC_HOST before including userclient.hpp to use them.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+/* Only what userclient.hpp needs, with the kernel's names and values. Memory
+ * descriptors describe (and "map" to) plain host memory, and
+ * IOUserClient::externalMethod() applies the same dispatch entry checks as the
+ * kernel's. */
+
+typedef int kern_return_t;
+typedef kern_return_t IOReturn;
+typedef uint32_t IOOptionBits;
+typedef uint64_t IOByteCount;
+typedef uint32_t IODirection;
+typedef uint64_t mach_vm_address_t;
+typedef uint64_t mach_vm_size_t;
+typedef unsigned int mach_port_t;
+typedef uint64_t io_user_reference_t;
+typedef struct djt_iouc_host_task* task_t;
+
+#define kIOReturnSuccess        0
+#define kIOReturnError          ((IOReturn)0xe00002bc)
+#define kIOReturnNoMemory       ((IOReturn)0xe00002bd)
+#define kIOReturnIPCError       ((IOReturn)0xe00002bf)
+#define kIOReturnBadArgument    ((IOReturn)0xe00002c2)
+#define kIOReturnUnsupported    ((IOReturn)0xe00002c7)
+#define kIOReturnNoSpace        ((IOReturn)0xe00002db)
+#define kIOReturnNotPermitted   ((IOReturn)0xe00002e2)
+#define kIOReturnOverrun        ((IOReturn)0xe00002e8)
+#define kIOReturnNoCompletion   ((IOReturn)0xe00002ea)
+
+#define MACH_PORT_NULL 0
+
+static task_t const kernel_task = nullptr;
+
+// Calls are made from a (single, simulated) client task sharing the host's address space
+inline task_t current_task()
+{
+	static char client_task;
+	return reinterpret_cast<task_t>(&client_task);
+}
+
+enum
+{
+	kIODirectionNone  = 0x0,
+	kIODirectionIn    = 0x1,
+	kIODirectionOut   = 0x2,
+	kIODirectionInOut = kIODirectionIn | kIODirectionOut,
+};
+
+enum
+{
+	kIOMapAnywhere = 0x00000001,
+	kIOMapReadOnly = 0x00001000,
+};
+
+enum
+{
+	kIOUCVariableStructureSize = 0xffffffff,
+	kIOExternalMethodArgumentsCurrentVersion = 2,
+	kOSAsyncRef64Count = 8,
+	kMaxAsyncArgs = 16,
+	// Struct arguments larger than this are passed by memory descriptor
+	kDJTIOUCHostInbandStructMax = 4096,
+};
+
+typedef io_user_reference_t OSAsyncReference64[kOSAsyncRef64Count];
+
+/* Reference counted, freed by free() when the last reference is dropped. As
+ * in the kernel, instances start out zero filled. */
+class OSObject
+{
+	mutable int retain_count;
+public:
+	static void* operator new(size_t size) { return calloc(1, size); }
+	static void operator delete(void* memory) { ::free(memory); }
+	OSObject() : retain_count(1) {}
+	virtual ~OSObject() {}
+	virtual bool init() { return true; }
+	virtual void free() { delete this; }
+	void retain() const { __atomic_add_fetch(&this->retain_count, 1, __ATOMIC_RELAXED); }
+	void release() const
+	{
+		if (__atomic_sub_fetch(&this->retain_count, 1, __ATOMIC_ACQ_REL) == 0)
+			const_cast<OSObject*>(this)->free();
+	}
+	int getRetainCount() const { return __atomic_load_n(&this->retain_count, __ATOMIC_RELAXED); }
+};
+
+#define OSDynamicCast(type, inst) (dynamic_cast<type*>(inst))
+#define OSSafeReleaseNULL(inst) do { if (inst) (inst)->release(); (inst) = nullptr; } while (0)
+
+class IOMemoryDescriptor;
+
+class IOMemoryMap : public OSObject
+{
+	friend class IOMemoryDescriptor;
+	IOMemoryDescriptor* descriptor;
+	mach_vm_address_t address;
+	mach_vm_size_t length;
+public:
+	virtual void free() override;
+	mach_vm_address_t getAddress() { return this->address; }
+	mach_vm_size_t getLength() { return this->length; }
+	IOMemoryDescriptor* getMemoryDescriptor() { return this->descriptor; }
+};
+
+/* A single range of host memory. Mappings alias the memory rather than copying
+ * it, and prepare()/complete() only count, so tests can check they're
+ * balanced. */
+class IOMemoryDescriptor : public OSObject
+{
+	void* address;
+	IOByteCount length;
+	IODirection direction;
+	int prepare_count;
+	IOReturn prepare_error;
+public:
+	static IOMemoryDescriptor* withAddress(void* address, IOByteCount length, IODirection direction)
+	{
+		IOMemoryDescriptor* md = new IOMemoryDescriptor();
+		md->address = address;
+		md->length = length;
+		md->direction = direction;
+		md->prepare_count = 0;
+		md->prepare_error = kIOReturnSuccess;
+		return md;
+	}
+	// Addresses in any task are host addresses
+	static IOMemoryDescriptor* withAddressRange(mach_vm_address_t address, mach_vm_size_t length, IOOptionBits options, task_t)
+	{
+		return withAddress(reinterpret_cast<void*>(address), length, options & kIODirectionInOut);
+	}
+	IOByteCount getLength() const { return this->length; }
+	IODirection getDirection() const { return this->direction; }
+	IOReturn prepare(IODirection = kIODirectionNone)
+	{
+		if (this->prepare_error != kIOReturnSuccess)
+			return this->prepare_error;
+		++this->prepare_count;
+		return kIOReturnSuccess;
+	}
+	IOReturn complete(IODirection = kIODirectionNone)
+	{
+		assert(this->prepare_count > 0);
+		--this->prepare_count;
+		return kIOReturnSuccess;
+	}
+	int getPrepareCount() const { return this->prepare_count; }
+	// Makes prepare() fail with 'error' from now on, for testing failure paths
+	void setPrepareError(IOReturn error) { this->prepare_error = error; }
+	IOByteCount readBytes(IOByteCount offset, void* bytes, IOByteCount length)
+	{
+		if (offset >= this->length)
+			return 0;
+		if (length > this->length - offset)
+			length = this->length - offset;
+		memcpy(bytes, static_cast<char*>(this->address) + offset, length);
+		return length;
+	}
+	IOByteCount writeBytes(IOByteCount offset, const void* bytes, IOByteCount length)
+	{
+		if (offset >= this->length)
+			return 0;
+		if (length > this->length - offset)
+			length = this->length - offset;
+		memcpy(static_cast<char*>(this->address) + offset, bytes, length);
+		return length;
+	}
+	IOMemoryMap* createMappingInTask(task_t, mach_vm_address_t, IOOptionBits, mach_vm_size_t offset = 0, mach_vm_size_t length = 0)
+	{
+		if (offset > this->length || length > this->length - offset)
+			return nullptr;
+		IOMemoryMap* map = new IOMemoryMap();
+		this->retain();
+		map->descriptor = this;
+		map->address = reinterpret_cast<mach_vm_address_t>(this->address) + offset;
+		map->length = length != 0 ? length : this->length - offset;
+		return map;
+	}
+};
+
+inline void IOMemoryMap::free()
+{
+	OSSafeReleaseNULL(this->descriptor);
+	OSObject::free();
+}
+
+struct IOExternalMethodArguments
+{
+	uint32_t version;
+	uint32_t selector;
+
+	mach_port_t asyncWakePort;
+	io_user_reference_t* asyncReference;
+	uint32_t asyncReferenceCount;
+
+	const uint64_t* scalarInput;
+	uint32_t scalarInputCount;
+
+	const void* structureInput;
+	uint32_t structureInputSize;
+
+	IOMemoryDescriptor* structureInputDescriptor;
+
+	uint64_t* scalarOutput;
+	uint32_t scalarOutputCount;
+
+	void* structureOutput;
+	uint32_t structureOutputSize;
+
+	IOMemoryDescriptor* structureOutputDescriptor;
+	uint32_t structureOutputDescriptorSize;
+
+	uint32_t __reservedA;
+
+	OSObject** structureVariableOutputData;
+
+	uint32_t __reserved[30];
+};
+
+typedef IOReturn (*IOExternalMethodAction)(OSObject* target, void* reference, IOExternalMethodArguments* arguments);
+
+struct IOExternalMethodDispatch
+{
+	IOExternalMethodAction function;
+	uint32_t checkScalarInputCount;
+	uint32_t checkStructureInputSize;
+	uint32_t checkScalarOutputCount;
+	uint32_t checkStructureOutputSize;
+};
+
+class IOService : public OSObject
+{
+};
+
+class IOUserClient : public IOService
+{
+public:
+	virtual IOReturn clientClose() { return kIOReturnSuccess; }
+	virtual IOReturn clientDied() { return this->clientClose(); }
+	virtual IOReturn externalMethod(uint32_t, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch = nullptr, OSObject* target = nullptr, void* reference = nullptr)
+	{
+		// The legacy (getTargetAndMethodForIndex) path is not emulated
+		if (dispatch == nullptr)
+			return kIOReturnUnsupported;
+		uint32_t count = dispatch->checkScalarInputCount;
+		if (count != kIOUCVariableStructureSize && count != arguments->scalarInputCount)
+			return kIOReturnBadArgument;
+		count = dispatch->checkStructureInputSize;
+		if (count != kIOUCVariableStructureSize
+			&& count != (arguments->structureInputDescriptor != nullptr
+				? arguments->structureInputDescriptor->getLength() : arguments->structureInputSize))
+			return kIOReturnBadArgument;
+		count = dispatch->checkScalarOutputCount;
+		if (count != kIOUCVariableStructureSize && count != arguments->scalarOutputCount)
+			return kIOReturnBadArgument;
+		count = dispatch->checkStructureOutputSize;
+		if (count != kIOUCVariableStructureSize
+			&& count != (arguments->structureOutputDescriptor != nullptr
+				? arguments->structureOutputDescriptor->getLength() : arguments->structureOutputSize))
+			return kIOReturnBadArgument;
+		if (dispatch->function == nullptr)
+			return kIOReturnNoCompletion;
+		return dispatch->function(target, reference, arguments);
+	}
+};
+
+/* Counterpart of IOConnectCallMethod(): packs the arguments the way the kernel
+ * does before calling the user client's externalMethod(), including passing
+ * struct inputs and outputs larger than kDJTIOUCHostInbandStructMax by memory
+ * descriptor. On return, *scalar_output_count and *struct_output_size are
+ * updated as they would be for the user space caller. */
+inline IOReturn djt_iouc_host_call_method(
+	IOUserClient* client, uint32_t selector,
+	const uint64_t* scalar_input, uint32_t scalar_input_count,
+	const void* struct_input, size_t struct_input_size,
+	uint64_t* scalar_output, uint32_t* scalar_output_count,
+	void* struct_output, size_t* struct_output_size)
+{
+	IOExternalMethodArguments arguments = {};
+	arguments.version = kIOExternalMethodArgumentsCurrentVersion;
+	arguments.selector = selector;
+	arguments.scalarInput = scalar_input;
+	arguments.scalarInputCount = scalar_input_count;
+	if (struct_input_size > kDJTIOUCHostInbandStructMax)
+	{
+		arguments.structureInputDescriptor = IOMemoryDescriptor::withAddress(const_cast<void*>(struct_input), struct_input_size, kIODirectionOut);
+	}
+	else
+	{
+		arguments.structureInput = struct_input;
+		arguments.structureInputSize = static_cast<uint32_t>(struct_input_size);
+	}
+	
+	uint64_t scalar_output_buffer[16] = {};
+	uint32_t output_count = scalar_output_count != nullptr ? *scalar_output_count : 0;
+	if (output_count > 16)
+		return kIOReturnBadArgument;
+	arguments.scalarOutput = scalar_output_buffer;
+	arguments.scalarOutputCount = output_count;
+	
+	size_t output_size = struct_output_size != nullptr ? *struct_output_size : 0;
+	bool ool_output = output_size > kDJTIOUCHostInbandStructMax;
+	if (ool_output)
+	{
+		arguments.structureOutputDescriptor = IOMemoryDescriptor::withAddress(struct_output, output_size, kIODirectionIn);
+		arguments.structureOutputDescriptorSize = static_cast<uint32_t>(output_size);
+	}
+	else
+	{
+		arguments.structureOutput = struct_output;
+		arguments.structureOutputSize = static_cast<uint32_t>(output_size);
+	}
+	
+	IOReturn result = client->externalMethod(selector, &arguments);
+	
+	if (scalar_output_count != nullptr)
+	{
+		if (arguments.scalarOutputCount > output_count)
+			arguments.scalarOutputCount = output_count;
+		if (arguments.scalarOutputCount > 0)
+			memcpy(scalar_output, scalar_output_buffer, arguments.scalarOutputCount * sizeof(scalar_output[0]));
+		*scalar_output_count = arguments.scalarOutputCount;
+	}
+	if (struct_output_size != nullptr)
+		*struct_output_size = ool_output ? arguments.structureOutputDescriptorSize : arguments.structureOutputSize;
+	OSSafeReleaseNULL(arguments.structureInputDescriptor);
+	OSSafeReleaseNULL(arguments.structureOutputDescriptor);
+	return result;
+}
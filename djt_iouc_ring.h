@@ -0,0 +1,296 @@
+/*
+kextgizmos' submission/completion ring protocol for issuing external method
+calls to a user client through shared memory, io_uring style.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_spsc_ring.h"
+#include "djt_iouc_batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Two djt_spsc_rings: user space produces into the submission ring and the
+ * kernel consumes, the kernel produces into the completion ring and user space
+ * consumes.
+ *
+ * A submission record is a djt_iouc_ring_submission followed by the entry's
+ * scalars and struct input exactly as in a batch (see djt_iouc_batch.h). Its
+ * completion record is a djt_iouc_ring_completion with the same user_data,
+ * followed by the result's scalars and struct output as in a batch result.
+ * Completions are posted in submission order.
+ *
+ * Doorbell: when djt_iouc_ring_submit() reports that the kernel side has gone
+ * idle, user space must ring the doorbell (an external method on the user
+ * client, see DJTUserClientRings). Otherwise no trap is needed at all. The
+ * kernel notifies user space of completions via the completion ring's usual
+ * DJTSPSCRing notification when user space has gone idle waiting for them.
+ *
+ * The completion ring should be sized for the maximum number of commands in
+ * flight. If it fills up, the kernel stops consuming submissions without going
+ * idle, so after draining completions in that state, user space must ring the
+ * doorbell again. */
+struct djt_iouc_ring_submission
+{
+	uint64_t user_data;
+	struct djt_iouc_batch_entry entry;
+};
+
+struct djt_iouc_ring_completion
+{
+	uint64_t user_data;
+	struct djt_iouc_batch_result result;
+};
+
+// Result reported for malformed submission records; same value as kIOReturnBadArgument.
+#define DJT_IOUC_RING_RESULT_BAD_ARGUMENT ((int32_t)0xe00002c2)
+
+// 64-bit: entries come from user space and may describe sizes near UINT32_MAX.
+static inline uint64_t djt_iouc_ring_submission_size(const struct djt_iouc_batch_entry* entry)
+{
+	return sizeof(uint64_t) + djt_iouc_batch_entry_size(entry);
+}
+
+static inline uint64_t djt_iouc_ring_completion_size(const struct djt_iouc_batch_entry* entry)
+{
+	return sizeof(uint64_t) + djt_iouc_batch_result_size(entry);
+}
+
+/* User space: packs a submission into 'scratch' and enqueues it. On success,
+ * *ring_doorbell says whether the kernel side needs waking. Returns
+ * DJT_SPSC_RING_TOO_LARGE if the record doesn't fit in 'scratch' or the counts
+ * exceed DJT_IOUC_BATCH_MAX_SCALARS. */
+static inline enum djt_spsc_ring_status djt_iouc_ring_submit(
+	djt_spsc_ring_producer_t* submissions, void* scratch, uint32_t scratch_size, uint64_t user_data,
+	uint32_t selector, const uint64_t* scalars, uint32_t scalar_input_count, const void* struct_input, uint32_t struct_input_size,
+	uint32_t scalar_output_count, uint32_t struct_output_size, bool* ring_doorbell)
+{
+	struct djt_iouc_ring_submission submission;
+	uint8_t* pos = (uint8_t*)scratch;
+	uint64_t size;
+	
+	*ring_doorbell = false;
+	if (scalar_input_count > DJT_IOUC_BATCH_MAX_SCALARS || scalar_output_count > DJT_IOUC_BATCH_MAX_SCALARS)
+		return DJT_SPSC_RING_TOO_LARGE;
+	submission.user_data = user_data;
+	submission.entry.selector = selector;
+	submission.entry.scalar_input_count = (uint16_t)scalar_input_count;
+	submission.entry.scalar_output_count = (uint16_t)scalar_output_count;
+	submission.entry.struct_input_size = struct_input_size;
+	submission.entry.struct_output_size = struct_output_size;
+	size = djt_iouc_ring_submission_size(&submission.entry);
+	if (size > scratch_size)
+		return DJT_SPSC_RING_TOO_LARGE;
+	
+	memcpy(pos, &submission, sizeof(submission));
+	pos += sizeof(submission);
+	if (scalar_input_count > 0)
+		memcpy(pos, scalars, sizeof(uint64_t) * scalar_input_count);
+	pos += sizeof(uint64_t) * scalar_input_count;
+	if (struct_input_size > 0)
+		memcpy(pos, struct_input, struct_input_size);
+	memset(pos + struct_input_size, 0, djt_iouc_batch_pad(struct_input_size) - struct_input_size);
+	
+	return djt_spsc_ring_enqueue(submissions, scratch, (uint32_t)size, ring_doorbell);
+}
+
+
+/* Executes one command: 'payload' holds the entry's scalars and struct input,
+ * copied out of the shared submission ring, so user space can't change them
+ * during the call. The function must write a djt_iouc_batch_result and the
+ * outputs to 'result', which has room for djt_iouc_batch_result_size(entry)
+ * bytes. */
+typedef void (*djt_iouc_ring_dispatch_fn)(
+	void* context, const struct djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result);
+
+// Kernel side (or its stand-in) state
+struct djt_iouc_ring_server
+{
+	djt_spsc_ring_consumer_t submissions;
+	djt_spsc_ring_producer_t completions;
+	/* Holds one completion record, followed by a copy of the payload of the
+	 * submission being dispatched; see djt_iouc_ring_server_scratch_size(). */
+	uint8_t* scratch;
+	uint32_t scratch_size;
+	// Largest completion record the completion ring accepts
+	uint32_t max_completion_length;
+	// Length of a completion in scratch still waiting for completion ring space
+	uint32_t pending_length;
+};
+typedef struct djt_iouc_ring_server djt_iouc_ring_server_t;
+
+// Largest completion record a ring of the given capacity always accepts.
+static inline uint32_t djt_iouc_ring_max_completion_size(uint32_t completion_capacity)
+{
+	return (uint32_t)(completion_capacity / 2 - sizeof(struct djt_spsc_ring_record));
+}
+
+/* Server scratch buffer size for which any command fitting both rings can be
+ * dispatched: the largest completion record plus the largest submission
+ * record. A smaller scratch buffer works, but commands which don't fit in it
+ * fail with DJT_IOUC_RING_RESULT_BAD_ARGUMENT. */
+static inline uint32_t djt_iouc_ring_server_scratch_size(uint32_t submission_capacity, uint32_t completion_capacity)
+{
+	// Both rings have the same record size limit
+	return djt_iouc_ring_max_completion_size(completion_capacity) + djt_iouc_ring_max_completion_size(submission_capacity);
+}
+
+// Attaches to both rings, which must already have been initialised with djt_spsc_ring_init().
+static inline bool djt_iouc_ring_server_init(
+	djt_iouc_ring_server_t* server, void* submission_memory, size_t submission_memory_size,
+	void* completion_memory, uint32_t completion_capacity, uint8_t* scratch, uint32_t scratch_size)
+{
+	if (scratch_size < sizeof(struct djt_iouc_ring_completion))
+		return false;
+	if (!djt_spsc_ring_consumer_init(&server->submissions, submission_memory, submission_memory_size))
+		return false;
+	djt_spsc_ring_producer_init(&server->completions, completion_memory, completion_capacity);
+	server->scratch = scratch;
+	server->scratch_size = scratch_size;
+	server->max_completion_length = djt_iouc_ring_max_completion_size(completion_capacity);
+	server->pending_length = 0;
+	return true;
+}
+
+/* Processes up to max_commands submissions. Returns DJT_SPSC_RING_EMPTY if the
+ * submission ring ran dry and the server went idle (the next submission will
+ * ask for the doorbell), DJT_SPSC_RING_OK if max_commands was reached, in which
+ * case call again soon, DJT_SPSC_RING_FULL if the completion ring is full, and
+ * DJT_SPSC_RING_CORRUPT if either ring's shared state is corrupt.
+ * *wake_client is set if the completion consumer needs notifying. */
+static inline enum djt_spsc_ring_status djt_iouc_ring_drain(
+	djt_iouc_ring_server_t* server, djt_iouc_ring_dispatch_fn dispatch, void* context, uint32_t max_commands, bool* wake_client)
+{
+	enum djt_spsc_ring_status status;
+	bool wake = false;
+	uint32_t done;
+	
+	*wake_client = false;
+	if (server->pending_length != 0)
+	{
+		status = djt_spsc_ring_enqueue(&server->completions, server->scratch, server->pending_length, &wake);
+		*wake_client = wake;
+		if (status != DJT_SPSC_RING_OK)
+			return status;
+		server->pending_length = 0;
+	}
+	
+	done = 0;
+	while (done < max_commands)
+	{
+		const void* record;
+		uint32_t length;
+		struct djt_iouc_ring_submission submission;
+		struct djt_iouc_ring_completion* completion = (struct djt_iouc_ring_completion*)server->scratch;
+		uint32_t completion_length;
+		uint64_t submission_size, completion_size;
+		
+		status = djt_spsc_ring_peek(&server->submissions, &record, &length);
+		if (status == DJT_SPSC_RING_EMPTY)
+		{
+			if (djt_spsc_ring_consumer_prepare_wait(&server->submissions))
+				return DJT_SPSC_RING_EMPTY;
+			continue;
+		}
+		if (status != DJT_SPSC_RING_OK)
+			return status;
+		
+		memset(completion, 0, sizeof(*completion));
+		completion_length = sizeof(*completion);
+		if (length < sizeof(submission))
+		{
+			completion->result.result = DJT_IOUC_RING_RESULT_BAD_ARGUMENT;
+		}
+		else
+		{
+			// The record is in shared memory: read the header once.
+			memcpy(&submission, record, sizeof(submission));
+			completion->user_data = submission.user_data;
+			submission_size = djt_iouc_ring_submission_size(&submission.entry);
+			completion_size = djt_iouc_ring_completion_size(&submission.entry);
+			if (submission.entry.scalar_input_count > DJT_IOUC_BATCH_MAX_SCALARS
+				|| submission.entry.scalar_output_count > DJT_IOUC_BATCH_MAX_SCALARS
+				|| submission_size > length
+				|| completion_size > server->max_completion_length
+				|| completion_size + (submission_size - sizeof(submission)) > server->scratch_size)
+			{
+				completion->result.result = DJT_IOUC_RING_RESULT_BAD_ARGUMENT;
+			}
+			else
+			{
+				/* Likewise the payload: the method sees a private copy, placed
+				 * after the completion record it writes. */
+				uint8_t* payload = server->scratch + completion_size;
+				memcpy(payload, (const uint8_t*)record + sizeof(submission), (size_t)(submission_size - sizeof(submission)));
+				dispatch(context, &submission.entry, payload, server->scratch + sizeof(uint64_t));
+				completion_length = (uint32_t)completion_size;
+			}
+		}
+		djt_spsc_ring_consume(&server->submissions);
+		
+		status = djt_spsc_ring_enqueue(&server->completions, server->scratch, completion_length, &wake);
+		*wake_client = *wake_client || wake;
+		if (status == DJT_SPSC_RING_FULL)
+		{
+			server->pending_length = completion_length;
+			return status;
+		}
+		if (status != DJT_SPSC_RING_OK)
+			return status;
+		++done;
+	}
+	return DJT_SPSC_RING_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,139 @@
+/*
+Portable stand-in for the kextgizmos submission/completion rings, using
+anonymous shared memory and pipes, for testing clients and command handlers
+outside the kernel.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_iouc_ring.h"
+#include "djt_spsc_ring_posix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The submission ring's wake pipe stands in for the doorbell external method,
+ * the completion ring's for the async completion notification. */
+struct djt_iouc_ring_posix
+{
+	djt_spsc_ring_posix_t submissions;
+	djt_spsc_ring_posix_t completions;
+};
+typedef struct djt_iouc_ring_posix djt_iouc_ring_posix_t;
+
+static inline bool djt_iouc_ring_posix_create(djt_iouc_ring_posix_t* ring, uint32_t submission_capacity, uint32_t completion_capacity)
+{
+	if (!djt_spsc_ring_posix_create(&ring->submissions, submission_capacity))
+		return false;
+	if (!djt_spsc_ring_posix_create(&ring->completions, completion_capacity))
+	{
+		djt_spsc_ring_posix_destroy(&ring->submissions);
+		return false;
+	}
+	return true;
+}
+
+static inline void djt_iouc_ring_posix_destroy(djt_iouc_ring_posix_t* ring)
+{
+	djt_spsc_ring_posix_destroy(&ring->completions);
+	djt_spsc_ring_posix_destroy(&ring->submissions);
+}
+
+static inline void djt_iouc_ring_posix_signal(djt_spsc_ring_posix_t* ring)
+{
+	char token = 0;
+	while (write(ring->wake_pipe[1], &token, 1) < 0 && errno == EINTR)
+		;
+}
+
+// Client side: the doorbell is rung (via the pipe) only when needed.
+static inline enum djt_spsc_ring_status djt_iouc_ring_posix_submit(
+	djt_iouc_ring_posix_t* ring, djt_spsc_ring_producer_t* submissions, void* scratch, uint32_t scratch_size, uint64_t user_data,
+	uint32_t selector, const uint64_t* scalars, uint32_t scalar_input_count, const void* struct_input, uint32_t struct_input_size,
+	uint32_t scalar_output_count, uint32_t struct_output_size)
+{
+	bool doorbell = false;
+	enum djt_spsc_ring_status status = djt_iouc_ring_submit(
+		submissions, scratch, scratch_size, user_data, selector, scalars, scalar_input_count, struct_input, struct_input_size,
+		scalar_output_count, struct_output_size, &doorbell);
+	if (doorbell)
+		djt_iouc_ring_posix_signal(&ring->submissions);
+	return status;
+}
+
+// Client side: explicit doorbell, for use after draining a full completion ring.
+static inline void djt_iouc_ring_posix_ring_doorbell(djt_iouc_ring_posix_t* ring)
+{
+	djt_iouc_ring_posix_signal(&ring->submissions);
+}
+
+/* Server side, standing in for DJTUserClientRings' work loop handler: drains
+ * submissions, notifies the client if necessary, and blocks on the doorbell
+ * if there is nothing left to do. Returns false if the rings are corrupt. */
+static inline bool djt_iouc_ring_posix_serve_once(
+	djt_iouc_ring_posix_t* ring, djt_iouc_ring_server_t* server, djt_iouc_ring_dispatch_fn dispatch, void* context, uint32_t max_commands)
+{
+	bool wake_client = false;
+	enum djt_spsc_ring_status status = djt_iouc_ring_drain(server, dispatch, context, max_commands, &wake_client);
+	if (wake_client)
+		djt_iouc_ring_posix_signal(&ring->completions);
+	if (status == DJT_SPSC_RING_EMPTY || status == DJT_SPSC_RING_FULL)
+	{
+		char token;
+		while (read(ring->submissions.wake_pipe[0], &token, 1) < 0 && errno == EINTR)
+			;
+	}
+	return status != DJT_SPSC_RING_CORRUPT && status != DJT_SPSC_RING_TOO_LARGE;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,70 @@
+/*
+kextgizmos' selector enum generation from a single user client method list,
+shared between the kext and user space.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+/* A user client's methods are listed once, as an X-macro in a header shared
+ * between the kext and user space:
+ *
+ *   #define MY_USER_CLIENT_METHODS(METHOD) \
+ *       METHOD(MyUserClient, open) \
+ *       METHOD(MyUserClient, readStatus)
+ *
+ *   DJT_IOUC_SELECTOR_ENUM(MyUserClientSelector, MY_USER_CLIENT_METHODS)
+ *
+ * declares enum MyUserClientSelector { kMyUserClient_open,
+ * kMyUserClient_readStatus, kMyUserClientSelectorCount }. In the kext,
+ * DJT_IOUC_METHOD_TABLE(MY_USER_CLIENT_METHODS) from userclient.hpp (C++17)
+ * is the method table with the same selector numbering. */
+#define DJT_IOUC_SELECTOR_ENUMERATOR(CLASS, METHOD) k##CLASS##_##METHOD,
+#define DJT_IOUC_SELECTOR_ENUM(ENUM_NAME, LIST) \
+	enum ENUM_NAME { LIST(DJT_IOUC_SELECTOR_ENUMERATOR) k##ENUM_NAME##Count }
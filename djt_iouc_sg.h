@@ -0,0 +1,118 @@
+/*
+Kextgizmo IOUserClient helpers: wire format of scatter-gather struct inputs,
+shared between kext and user space.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A scatter-gather struct input (djt_iouc_sg_input method parameter in
+ * userclient.hpp) is a djt_iouc_sg_header followed by 'range_count'
+ * djt_iouc_sg_range entries, then 'inline_size' bytes of inline data.
+ *
+ * The kext hands the method the inline data (if any) as the first segment,
+ * followed by one segment per range, each mapped read-only from the calling
+ * task, so user space can pass e.g. a small header inline and a large payload
+ * by reference without concatenating them. Ranges must be non-empty. */
+struct djt_iouc_sg_header
+{
+	uint32_t range_count;
+	uint32_t inline_size;
+};
+
+struct djt_iouc_sg_range
+{
+	uint64_t address; // in the calling task
+	uint64_t length;
+};
+
+// Maximum number of ranges per struct input
+#define DJT_IOUC_SG_MAX_RANGES 8u
+
+static inline uint64_t djt_iouc_sg_size(uint32_t range_count, uint32_t inline_size)
+{
+	return sizeof(struct djt_iouc_sg_header) + sizeof(struct djt_iouc_sg_range) * (uint64_t)range_count + inline_size;
+}
+
+/* User space helper: encodes a scatter-gather struct input into 'buffer'.
+ * Returns the encoded size, to pass as the struct input size, or 0 if the
+ * buffer is too small or there are too many ranges. */
+static inline size_t djt_iouc_sg_encode(
+	void* buffer, size_t buffer_size, const void* inline_data, uint32_t inline_size,
+	const struct djt_iouc_sg_range* ranges, uint32_t range_count)
+{
+	struct djt_iouc_sg_header header;
+	uint64_t size = djt_iouc_sg_size(range_count, inline_size);
+	char* pos = (char*)buffer;
+	
+	if (range_count > DJT_IOUC_SG_MAX_RANGES || size > buffer_size)
+		return 0;
+	header.range_count = range_count;
+	header.inline_size = inline_size;
+	memcpy(pos, &header, sizeof(header));
+	pos += sizeof(header);
+	if (range_count > 0)
+		memcpy(pos, ranges, sizeof(ranges[0]) * range_count);
+	pos += sizeof(ranges[0]) * range_count;
+	if (inline_size > 0)
+		memcpy(pos, inline_data, inline_size);
+	return (size_t)size;
+}
+
+#ifdef __cplusplus
+}
+#endif
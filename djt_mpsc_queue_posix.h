@@ -0,0 +1,119 @@
+/*
+kextgizmos POSIX stand-in for the consumer wakeup which normally goes with
+DJTMPSCQueue (an interrupt event source or work loop command gate signal).
+Producers that find the queue empty write to a pipe, which the consumer
+blocks on once it has drained the queue, so producers and a consumer thread
+can run in Linux or macOS user space, e.g. for stress tests.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "DJTMPSCQueue.hpp"
+#include <unistd.h>
+#include <errno.h>
+
+/* The signalling protocol is the one push() documents: only the producer
+ * which makes the queue non-empty signals, so the consumer must drain until
+ * it observes the queue empty before waiting. Stale signals (for items
+ * already drained) only cause a spurious wakeup. */
+template <typename T> class DJTMPSCQueuePosix
+{
+	DJTMPSCQueuePosix(const DJTMPSCQueuePosix&) = delete;
+	DJTMPSCQueuePosix& operator=(const DJTMPSCQueuePosix&) = delete;
+	
+	DJTMPSCQueue<T> queue;
+	int wake_pipe[2]; // [0] read end for the consumer, [1] write end for producers
+
+public:
+	DJTMPSCQueuePosix()
+	{
+		this->wake_pipe[0] = this->wake_pipe[1] = -1;
+	}
+	
+	bool create()
+	{
+		return pipe(this->wake_pipe) == 0;
+	}
+	
+	void destroy()
+	{
+		close(this->wake_pipe[0]);
+		close(this->wake_pipe[1]);
+		this->wake_pipe[0] = this->wake_pipe[1] = -1;
+	}
+	
+	// Counterpart of push() followed by signalling the event source if needed
+	bool push(T* item)
+	{
+		bool signal = this->queue.push(item);
+		if (signal)
+		{
+			char token = 0;
+			while (write(this->wake_pipe[1], &token, 1) < 0 && errno == EINTR)
+				;
+		}
+		return signal;
+	}
+	
+	// Consumer only, see DJTMPSCQueue::drainAll()
+	template <typename FN> unsigned drainAll(FN fn)
+	{
+		return this->queue.drainAll(fn);
+	}
+	
+	/* Consumer only; blocks until a producer signals. Call after drainAll()
+	 * has emptied the queue. Counterpart of the event source firing. */
+	void wait()
+	{
+		char token;
+		while (read(this->wake_pipe[0], &token, 1) < 0 && errno == EINTR)
+			;
+	}
+};
@@ -0,0 +1,291 @@
+/*
+kextgizmos single-producer/single-consumer ring buffer of variable-length
+records in shared memory. This is the layout and the lock-free producer and
+consumer logic. It has no OS dependencies, so the same code runs in a kext,
+a dext, a user-space client, or a test on another OS.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_cpu_hints.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shared memory layout: this header, followed immediately by the data area of
+ * 'capacity' bytes (a power of two). head and tail are free-running byte
+ * counters, each written by only one side and on its own cache line.
+ *
+ * Records start with a djt_spsc_ring_record header and are padded to 8 bytes.
+ * A record never wraps around the end of the data area; the producer instead
+ * fills the remainder with a padding record.
+ *
+ * Neither side trusts the other: the producer and consumer each keep their own
+ * copy of the capacity and of their index, and validate the other side's index
+ * before using it. The kernel is typically the producer, and a corrupted
+ * shared header only results in DJT_SPSC_RING_CORRUPT. */
+#define DJT_SPSC_RING_MAGIC 0x444a5452u /* 'DJTR' */
+
+struct djt_spsc_ring_header
+{
+	// Written by the consumer
+	uint32_t head __attribute__((aligned(DJT_CACHE_LINE_SIZE)));
+	// Set by the consumer before waiting, cleared by whoever wakes it
+	uint32_t consumer_idle;
+	// Written by the producer
+	uint32_t tail __attribute__((aligned(DJT_CACHE_LINE_SIZE)));
+	// Constant after initialisation
+	uint32_t magic __attribute__((aligned(DJT_CACHE_LINE_SIZE)));
+	uint32_t capacity;
+};
+typedef struct djt_spsc_ring_header djt_spsc_ring_header_t;
+
+struct djt_spsc_ring_record
+{
+	uint32_t length; // payload bytes, or DJT_SPSC_RING_PADDING
+	uint32_t reserved;
+};
+#define DJT_SPSC_RING_PADDING 0xffffffffu
+#define DJT_SPSC_RING_RECORD_ALIGN 8u
+
+enum djt_spsc_ring_status
+{
+	DJT_SPSC_RING_OK = 0,
+	DJT_SPSC_RING_FULL,       // not enough space right now
+	DJT_SPSC_RING_EMPTY,
+	DJT_SPSC_RING_TOO_LARGE,  // record can never fit
+	DJT_SPSC_RING_CORRUPT,    // the other side broke the protocol
+};
+
+static inline size_t djt_spsc_ring_total_size(uint32_t capacity)
+{
+	return sizeof(djt_spsc_ring_header_t) + capacity;
+}
+
+static inline uint32_t djt_spsc_ring_record_size(uint32_t payload_length)
+{
+	return (uint32_t)sizeof(struct djt_spsc_ring_record)
+		+ ((payload_length + DJT_SPSC_RING_RECORD_ALIGN - 1) & ~(DJT_SPSC_RING_RECORD_ALIGN - 1));
+}
+
+// Initialises the shared header. memory must be djt_spsc_ring_total_size(capacity) bytes.
+static inline bool djt_spsc_ring_init(void* memory, uint32_t capacity)
+{
+	if (capacity < 2 * DJT_SPSC_RING_RECORD_ALIGN || (capacity & (capacity - 1)) != 0)
+		return false;
+	djt_spsc_ring_header_t* header = (djt_spsc_ring_header_t*)memory;
+	memset(header, 0, sizeof(*header));
+	header->capacity = capacity;
+	__atomic_store_n(&header->magic, DJT_SPSC_RING_MAGIC, __ATOMIC_RELEASE);
+	return true;
+}
+
+
+struct djt_spsc_ring_producer
+{
+	djt_spsc_ring_header_t* header;
+	uint8_t* data;
+	uint32_t capacity;
+	uint32_t tail;
+};
+typedef struct djt_spsc_ring_producer djt_spsc_ring_producer_t;
+
+// memory must have been initialised with djt_spsc_ring_init(memory, capacity).
+static inline void djt_spsc_ring_producer_init(djt_spsc_ring_producer_t* producer, void* memory, uint32_t capacity)
+{
+	producer->header = (djt_spsc_ring_header_t*)memory;
+	producer->data = (uint8_t*)memory + sizeof(djt_spsc_ring_header_t);
+	producer->capacity = capacity;
+	producer->tail = __atomic_load_n(&producer->header->tail, __ATOMIC_RELAXED);
+}
+
+/* Appends a record. On success, *wake_consumer is set to true if the consumer
+ * had gone idle and must be notified by whatever means the two sides agreed on;
+ * the flag is only handed out once per idle period. */
+static inline enum djt_spsc_ring_status djt_spsc_ring_enqueue(
+	djt_spsc_ring_producer_t* producer, const void* payload, uint32_t length, bool* wake_consumer)
+{
+	uint32_t capacity = producer->capacity;
+	*wake_consumer = false;
+	if (length > capacity - sizeof(struct djt_spsc_ring_record))
+		return DJT_SPSC_RING_TOO_LARGE;
+	uint32_t record_size = djt_spsc_ring_record_size(length);
+	if (record_size > capacity / 2)
+		return DJT_SPSC_RING_TOO_LARGE; // might never fit due to padding
+	
+	uint32_t tail = producer->tail;
+	uint32_t head = __atomic_load_n(&producer->header->head, __ATOMIC_ACQUIRE);
+	uint32_t used = tail - head;
+	if (used > capacity || (head & (DJT_SPSC_RING_RECORD_ALIGN - 1)) != 0)
+		return DJT_SPSC_RING_CORRUPT;
+	
+	uint32_t offset = tail & (capacity - 1);
+	uint32_t contiguous = capacity - offset;
+	uint32_t padding = (contiguous < record_size) ? contiguous : 0;
+	if (capacity - used < padding + record_size)
+		return DJT_SPSC_RING_FULL;
+	
+	struct djt_spsc_ring_record record = { 0, 0 };
+	if (padding != 0)
+	{
+		record.length = DJT_SPSC_RING_PADDING;
+		memcpy(producer->data + offset, &record, sizeof(record));
+		tail += padding;
+		offset = 0;
+	}
+	record.length = length;
+	memcpy(producer->data + offset, &record, sizeof(record));
+	memcpy(producer->data + offset + sizeof(record), payload, length);
+	tail += record_size;
+	producer->tail = tail;
+	__atomic_store_n(&producer->header->tail, tail, __ATOMIC_RELEASE);
+	
+	// Pairs with the fence in djt_spsc_ring_consumer_prepare_wait()
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&producer->header->consumer_idle, __ATOMIC_RELAXED) != 0)
+		*wake_consumer = __atomic_exchange_n(&producer->header->consumer_idle, 0, __ATOMIC_RELAXED) != 0;
+	return DJT_SPSC_RING_OK;
+}
+
+
+struct djt_spsc_ring_consumer
+{
+	djt_spsc_ring_header_t* header;
+	const uint8_t* data;
+	uint32_t capacity;
+	uint32_t head;
+	uint32_t current_record_size;
+};
+typedef struct djt_spsc_ring_consumer djt_spsc_ring_consumer_t;
+
+// Fails if the memory doesn't contain an initialised ring of the expected total size.
+static inline bool djt_spsc_ring_consumer_init(djt_spsc_ring_consumer_t* consumer, void* memory, size_t memory_size)
+{
+	djt_spsc_ring_header_t* header = (djt_spsc_ring_header_t*)memory;
+	if (memory_size < sizeof(*header) || __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != DJT_SPSC_RING_MAGIC)
+		return false;
+	uint32_t capacity = header->capacity;
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0 || djt_spsc_ring_total_size(capacity) > memory_size)
+		return false;
+	consumer->header = header;
+	consumer->data = (const uint8_t*)memory + sizeof(*header);
+	consumer->capacity = capacity;
+	consumer->head = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+	consumer->current_record_size = 0;
+	return true;
+}
+
+/* Returns the oldest record's payload in place, without consuming it. The
+ * pointer remains valid until djt_spsc_ring_consume(). */
+static inline enum djt_spsc_ring_status djt_spsc_ring_peek(
+	djt_spsc_ring_consumer_t* consumer, const void** out_payload, uint32_t* out_length)
+{
+	uint32_t capacity = consumer->capacity;
+	while (true)
+	{
+		uint32_t head = consumer->head;
+		uint32_t tail = __atomic_load_n(&consumer->header->tail, __ATOMIC_ACQUIRE);
+		if (tail == head)
+			return DJT_SPSC_RING_EMPTY;
+		if (tail - head > capacity)
+			return DJT_SPSC_RING_CORRUPT;
+		
+		uint32_t offset = head & (capacity - 1);
+		struct djt_spsc_ring_record record;
+		memcpy(&record, consumer->data + offset, sizeof(record));
+		if (record.length == DJT_SPSC_RING_PADDING)
+		{
+			consumer->head = head + (capacity - offset);
+			__atomic_store_n(&consumer->header->head, consumer->head, __ATOMIC_RELEASE);
+			continue;
+		}
+		if (record.length > capacity - offset - sizeof(record) || djt_spsc_ring_record_size(record.length) > tail - head)
+			return DJT_SPSC_RING_CORRUPT;
+		
+		consumer->current_record_size = djt_spsc_ring_record_size(record.length);
+		*out_payload = consumer->data + offset + sizeof(record);
+		*out_length = record.length;
+		return DJT_SPSC_RING_OK;
+	}
+}
+
+// Releases the record returned by the last successful djt_spsc_ring_peek() to the producer.
+static inline void djt_spsc_ring_consume(djt_spsc_ring_consumer_t* consumer)
+{
+	consumer->head += consumer->current_record_size;
+	consumer->current_record_size = 0;
+	__atomic_store_n(&consumer->header->head, consumer->head, __ATOMIC_RELEASE);
+}
+
+/* Call when the ring is empty, before blocking on the wakeup notification.
+ * Returns false if records arrived in the meantime, in which case don't block.
+ * If it returns true, the producer will send exactly one notification for the
+ * next record. */
+static inline bool djt_spsc_ring_consumer_prepare_wait(djt_spsc_ring_consumer_t* consumer)
+{
+	__atomic_store_n(&consumer->header->consumer_idle, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&consumer->header->tail, __ATOMIC_ACQUIRE) != consumer->head)
+	{
+		// Don't block. If the producer raced us and cleared the flag, a spurious notification is harmless.
+		__atomic_store_n(&consumer->header->consumer_idle, 0, __ATOMIC_RELAXED);
+		return false;
+	}
+	return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
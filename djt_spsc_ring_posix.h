@@ -0,0 +1,123 @@
+/*
+kextgizmos POSIX stand-in for the djt_spsc_ring shared memory and wakeup
+transport. Uses an anonymous shared mmap() and a pipe, so a producer and
+consumer, such as a test harness or benchmark, can run on Linux or macOS user space, in
+separate threads or in a fork()ed process.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_spsc_ring.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct djt_spsc_ring_posix
+{
+	void* memory;
+	size_t size;
+	int wake_pipe[2]; // [0] read end for the consumer, [1] write end for the producer
+};
+typedef struct djt_spsc_ring_posix djt_spsc_ring_posix_t;
+
+static inline bool djt_spsc_ring_posix_create(djt_spsc_ring_posix_t* ring, uint32_t capacity)
+{
+	ring->size = djt_spsc_ring_total_size(capacity);
+	ring->memory = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (ring->memory == MAP_FAILED)
+		return false;
+	if (!djt_spsc_ring_init(ring->memory, capacity) || pipe(ring->wake_pipe) != 0)
+	{
+		munmap(ring->memory, ring->size);
+		return false;
+	}
+	return true;
+}
+
+static inline void djt_spsc_ring_posix_destroy(djt_spsc_ring_posix_t* ring)
+{
+	close(ring->wake_pipe[0]);
+	close(ring->wake_pipe[1]);
+	munmap(ring->memory, ring->size);
+}
+
+// Counterpart of DJTSPSCRing::enqueue()
+static inline enum djt_spsc_ring_status djt_spsc_ring_posix_enqueue(
+	djt_spsc_ring_posix_t* ring, djt_spsc_ring_producer_t* producer, const void* payload, uint32_t length)
+{
+	bool wake = false;
+	enum djt_spsc_ring_status status = djt_spsc_ring_enqueue(producer, payload, length, &wake);
+	if (wake)
+	{
+		char token = 0;
+		while (write(ring->wake_pipe[1], &token, 1) < 0 && errno == EINTR)
+			;
+	}
+	return status;
+}
+
+/* Blocks until records are available. Counterpart of waiting for the
+ * DJTSPSCRing async notification. */
+static inline void djt_spsc_ring_posix_wait(djt_spsc_ring_posix_t* ring, djt_spsc_ring_consumer_t* consumer)
+{
+	if (!djt_spsc_ring_consumer_prepare_wait(consumer))
+		return;
+	char token;
+	while (read(ring->wake_pipe[0], &token, 1) < 0 && errno == EINTR)
+		;
+}
+
+#ifdef __cplusplus
+}
+#endif
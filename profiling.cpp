@@ -52,8 +52,17 @@ misrepresented as being the original software.
 
 #ifdef DJ_PROFILE_ENABLE
 
+#ifdef DJT_IOUC_HOST
+#include <time.h>
+
+uint64_t dj_absolute_nanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+#else
 #include <kern/clock.h>
-#include <libkern/OSAtomic.h>
 #include <IOKit/IOUserClient.h>
 
 uint64_t dj_absolute_nanoseconds()
@@ -62,39 +71,56 @@ uint64_t dj_absolute_nanoseconds()
 	absolutetime_to_nanoseconds(mach_absolute_time(), &ns);
 	return ns;
 }
+#endif
 
 void dj_profile_sample(dj_profile_probe_t* probe, uint64_t start_ns, uint64_t end_ns)
 {
-	OSIncrementAtomic64(&probe->num_samples_1);
+	__atomic_fetch_add(&probe->num_samples_1, 1, __ATOMIC_SEQ_CST);
 	uint64_t delta = end_ns - start_ns;
 	
-	OSAddAtomic64(delta, &probe->sum_ns);
+	__atomic_fetch_add(&probe->sum_ns, delta, __ATOMIC_SEQ_CST);
 	
-	uint64_t min = probe->min_ns;
+	uint64_t min = __atomic_load_n(&probe->min_ns, __ATOMIC_RELAXED);
 	while (min > delta)
 	{
-		if (OSCompareAndSwap64(min, delta, &probe->min_ns))
+		if (__atomic_compare_exchange_n(&probe->min_ns, &min, delta, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
 			break;
-		min = probe->min_ns;
 	}
-	uint64_t max = probe->max_ns;
+	uint64_t max = __atomic_load_n(&probe->max_ns, __ATOMIC_RELAXED);
 	while (max < delta)
 	{
-		if (OSCompareAndSwap64(max, delta, &probe->max_ns))
+		if (__atomic_compare_exchange_n(&probe->max_ns, &max, delta, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
 			break;
-		max = probe->max_ns;
 	}
 	
 	__uint128_t delta_sq = static_cast<__uint128_t>(delta) * delta;
 	uint64_t delta_sq_lo = delta_sq;
 	uint64_t delta_sq_hi = delta_sq >> 64;
-	uint64_t prev_lo = OSAddAtomic64(delta_sq_lo, &probe->sum_sq_ns_lo);
-	uint64_t carry = 0;
-	__builtin_addcll(delta_sq_lo, prev_lo, carry, &carry);
-	delta_sq_hi += carry;
-	OSAddAtomic64(delta_sq_hi, &probe->sum_sq_ns_hi);
+	uint64_t prev_lo = __atomic_fetch_add(&probe->sum_sq_ns_lo, delta_sq_lo, __ATOMIC_SEQ_CST);
+	// Carry out of the low half
+	if (prev_lo + delta_sq_lo < prev_lo)
+		++delta_sq_hi;
+	__atomic_fetch_add(&probe->sum_sq_ns_hi, delta_sq_hi, __ATOMIC_SEQ_CST);
 	
-	OSIncrementAtomic64(&probe->num_samples_2);
+	__atomic_fetch_add(&probe->num_samples_2, 1, __ATOMIC_SEQ_CST);
+}
+
+void dj_profile_probe_snapshot(const volatile dj_profile_probe_t* probe, dj_profile_probe_t* snapshot)
+{
+	unsigned tries = 0;
+	do
+	{
+		snapshot->num_samples_1 = probe->num_samples_1;
+		
+		snapshot->sum_ns = probe->sum_ns;
+		snapshot->sum_sq_ns = probe->sum_sq_ns;
+		snapshot->min_ns = probe->min_ns;
+		snapshot->max_ns = probe->max_ns;
+
+		snapshot->num_samples_2 = probe->num_samples_2;
+
+		++tries;
+	} while (snapshot->num_samples_1 != snapshot->num_samples_2 && tries < 100);
 }
 
 IOReturn dj_profile_iouc_export(const volatile dj_profile_probe_t probes[], unsigned num_probes, IOExternalMethodArguments* arguments)
@@ -111,29 +137,15 @@ IOReturn dj_profile_iouc_export(const volatile dj_profile_probe_t probes[], unsi
 		num_probes = arguments->structureOutputSize / sizeof(dj_profile_probe_t);
 	for (unsigned i = 0; i < num_probes; ++i)
 	{
-		unsigned tries = 0;
 		dj_profile_probe_t probe_copy = {};
-		do
-		{
-			probe_copy.num_samples_1 = probes[i].num_samples_1;
-			
-			probe_copy.sum_ns = probes[i].sum_ns;
-			probe_copy.sum_sq_ns = probes[i].sum_sq_ns;
-			probe_copy.min_ns = probes[i].min_ns;
-			probe_copy.max_ns = probes[i].max_ns;
-
-			probe_copy.num_samples_2 = probes[i].num_samples_2;
-
-			++tries;
-		} while (probe_copy.num_samples_1 != probe_copy.num_samples_2 && tries < 100);
-		
+		dj_profile_probe_snapshot(&probes[i], &probe_copy);
 		export_probes[i] = probe_copy;
 	}
 	
 	return kIOReturnSuccess;
 }
 #else
-IOReturn dj_profile_iouc_export(const volatile dj_profile_probe_t probes[], unsigned num_probes, IOExternalMethodArguments* arguments)
+IOReturn dj_profile_iouc_export(const volatile dj_profile_probe_t[], unsigned, IOExternalMethodArguments*)
 {
 	return kIOReturnUnsupported;
 }
@@ -51,7 +51,11 @@ misrepresented as being the original software.
 #pragma once
 
 #include <stdint.h>
+#ifdef DJT_IOUC_HOST
+#include "djt_iouc_host.h"
+#else
 #include <IOKit/IOReturn.h>
+#endif
 
 struct dj_profile_probe
 {
@@ -70,7 +74,8 @@ typedef struct dj_profile_probe dj_profile_probe_t;
 
 #define DJ_PROFILE_PROBE_INIT (struct dj_profile_probe){ .num_samples_1 = 0, .num_samples_2 = 0, .sum_ns = 0, .sum_sq_ns = 0, .min_ns = UINT64_MAX, .max_ns = 0 }
 
-#ifdef KERNEL
+// The host build (DJT_IOUC_HOST) lets the user client metrics run in tests.
+#if defined(KERNEL) || defined(DJT_IOUC_HOST)
 
 #ifdef __cplusplus
 extern "C" {
@@ -90,6 +95,10 @@ uint64_t dj_absolute_nanoseconds(void);
 
 void dj_profile_sample(dj_profile_probe_t* probe, uint64_t start_ns, uint64_t end_ns);
 
+/* Copies a probe which dj_profile_sample() may be updating concurrently,
+ * retrying a few times to get a consistent snapshot. */
+void dj_profile_probe_snapshot(const volatile dj_profile_probe_t* probe, dj_profile_probe_t* snapshot);
+
 #define DJ_PROFILE_TIME(name) uint64_t name = dj_absolute_nanoseconds()
 #define DJ_PROFILE_VAR(name) uint64_t name = 0
 #define DJ_PROFILE_TAKE_TIME(name) name = dj_absolute_nanoseconds()
@@ -108,6 +117,6 @@ void dj_profile_sample(dj_profile_probe_t* probe, uint64_t start_ns, uint64_t en
 }
 #endif
 
-#else //!KERNEL
+#else //!KERNEL && !DJT_IOUC_HOST
 
 #endif
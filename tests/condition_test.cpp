@@ -0,0 +1,190 @@
+/*
+Tests for DJTCondition: waiter counts are kept per key (and conservatively
+once more keys are in use than are tracked), keyed notification wakes the
+right waiters, and timed waits time out.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTCondition.hpp"
+#include "djt_test.h"
+#include <pthread.h>
+
+namespace
+{
+	struct waiter
+	{
+		DJTCondition* condition;
+		const void* key;
+		volatile bool* ready;
+		bool woken;
+		
+		static void* run(void* arg)
+		{
+			waiter* w = static_cast<waiter*>(arg);
+			DJTUnretainedLockGuard guard(w->condition->getLock());
+			w->condition->wait(w->key, [w]() { return *w->ready; });
+			w->woken = true;
+			return nullptr;
+		}
+	};
+	
+	/* Exact number of threads waiting on any of the keys. Call with the lock
+	 * held. Nobody waits on the condition itself, so its count is the
+	 * untracked waiters, which every key's count includes. */
+	uint32_t total_waiters(DJTCondition* condition, const char* keys, unsigned key_count)
+	{
+		uint32_t untracked = condition->getWaiterCount(nullptr);
+		uint32_t total = untracked;
+		for (unsigned k = 0; k < key_count; ++k)
+			total += condition->getWaiterCount(&keys[k]) - untracked;
+		return total;
+	}
+	
+	// Waits (polling) until exactly count threads are asleep on the keys.
+	void await_waiters(DJTCondition* condition, const char* keys, unsigned key_count, uint32_t count)
+	{
+		while (true)
+		{
+			DJTUnretainedLockGuard guard(condition->getLock());
+			if (total_waiters(condition, keys, key_count) == count)
+				return;
+			guard.unlock();
+			IOSleep(1);
+		}
+	}
+	
+	void test_keyed_waiters(unsigned key_count)
+	{
+		DJTLock* lock = OSTypeAlloc(DJTLock);
+		DJT_CHECK(lock->init());
+		DJTCondition* condition = new DJTCondition(lock);
+		
+		// Two waiters per key, each key with its own predicate
+		char keys[16];
+		volatile bool ready[16] = {};
+		waiter waiters[32];
+		pthread_t threads[32];
+		for (unsigned i = 0; i < 2 * key_count; ++i)
+		{
+			waiters[i] = { condition, &keys[i / 2], &ready[i / 2], false };
+			pthread_create(&threads[i], nullptr, waiter::run, &waiters[i]);
+		}
+		await_waiters(condition, keys, key_count, 2 * key_count);
+		
+		lock->lock();
+		uint32_t untracked = key_count > DJT_CONDITION_TRACKED_KEYS ? 2 * (key_count - DJT_CONDITION_TRACKED_KEYS) : 0;
+		DJT_CHECK_EQ(condition->getWaiterCount(nullptr), untracked);
+		DJT_CHECK_EQ(condition->getWaiterCount(&keys[15]), untracked);
+		for (unsigned k = 0; k < key_count; ++k)
+		{
+			uint32_t count = condition->getWaiterCount(&keys[k]);
+			DJT_CHECK(count >= 2);
+			DJT_CHECK(count <= 2 + untracked);
+		}
+		// Notifying a key nobody waits on is harmless
+		condition->notifyAll(&keys[15]);
+		// Release the waiters on key 0 only
+		ready[0] = true;
+		condition->notifyN(&keys[0], 2);
+		lock->unlock();
+		pthread_join(threads[0], nullptr);
+		pthread_join(threads[1], nullptr);
+		DJT_CHECK(waiters[0].woken && waiters[1].woken);
+		// The others may have been woken spuriously too; let them go back to sleep
+		await_waiters(condition, keys, key_count, 2 * key_count - 2);
+		
+		lock->lock();
+		// Nobody tracked on key 0 any more (waiters may have moved between tracked and untracked)
+		DJT_CHECK_EQ(condition->getWaiterCount(&keys[0]), condition->getWaiterCount(nullptr));
+		for (unsigned i = 2; i < 2 * key_count; ++i)
+			DJT_CHECK(!waiters[i].woken);
+		for (unsigned k = 1; k < key_count; ++k)
+		{
+			ready[k] = true;
+			condition->notifyAll(&keys[k]);
+		}
+		lock->unlock();
+		for (unsigned i = 2; i < 2 * key_count; ++i)
+		{
+			pthread_join(threads[i], nullptr);
+			DJT_CHECK(waiters[i].woken);
+		}
+		
+		lock->lock();
+		for (unsigned k = 0; k < key_count; ++k)
+			DJT_CHECK_EQ(condition->getWaiterCount(&keys[k]), 0);
+		lock->unlock();
+		delete condition;
+		lock->release();
+	}
+	
+	void test_timeout()
+	{
+		DJTLock* lock = OSTypeAlloc(DJTLock);
+		DJT_CHECK(lock->init());
+		DJTCondition* condition = new DJTCondition(lock);
+		lock->lock();
+		uint64_t start = mach_absolute_time();
+		bool result = condition->waitUntil(nullptr, DJTLock::deadlineAfterNanoseconds(5000000), []() { return false; });
+		DJT_CHECK(!result);
+		DJT_CHECK(mach_absolute_time() - start >= 5000000);
+		DJT_CHECK_EQ(condition->getWaiterCount(), 0);
+		lock->unlock();
+		delete condition;
+		lock->release();
+	}
+}
+
+int main()
+{
+	test_keyed_waiters(2);
+	test_keyed_waiters(DJT_CONDITION_TRACKED_KEYS + 3);
+	test_timeout();
+	return djt_test_report("condition_test");
+}
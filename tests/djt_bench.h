@@ -0,0 +1,150 @@
+/*
+Microbenchmark harness for the host benchmarks: times a loop, or the same
+loop on several threads started together, and reports nanoseconds per
+operation.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline uint64_t djt_bench_now_ns()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Iteration count from the command line (first argument), or the default.
+static inline uint64_t djt_bench_iterations(int argc, char** argv, uint64_t default_iterations)
+{
+	if (argc > 1)
+	{
+		unsigned long long iterations = strtoull(argv[1], nullptr, 0);
+		if (iterations > 0)
+			return iterations;
+	}
+	return default_iterations;
+}
+
+static inline void djt_bench_print(const char* name, uint64_t operations, uint64_t elapsed_ns)
+{
+	printf("%-72s %10.1f ns/op (%llu ops)\n", name,
+		operations > 0 ? (double)elapsed_ns / (double)operations : 0.0, (unsigned long long)operations);
+	fflush(stdout);
+}
+
+/* Runs body(i) for i in [0, iterations) after an untimed warm-up of a tenth as
+ * many, prints and returns the mean nanoseconds per operation, where each
+ * iteration performs operations_per_iteration operations. */
+template <typename BODY> double djt_bench_run(const char* name, uint64_t iterations, BODY body, uint64_t operations_per_iteration = 1)
+{
+	for (uint64_t i = 0; i < iterations / 10; ++i)
+		body(i);
+	uint64_t start = djt_bench_now_ns();
+	for (uint64_t i = 0; i < iterations; ++i)
+		body(i);
+	uint64_t elapsed = djt_bench_now_ns() - start;
+	uint64_t operations = iterations * operations_per_iteration;
+	djt_bench_print(name, operations, elapsed);
+	return (double)elapsed / (double)operations;
+}
+
+template <typename BODY> struct djt_bench_thread
+{
+	BODY* body;
+	unsigned index;
+	uint64_t iterations;
+	volatile bool* go;
+	
+	static void* run(void* arg)
+	{
+		djt_bench_thread* thread = static_cast<djt_bench_thread*>(arg);
+		while (!__atomic_load_n(thread->go, __ATOMIC_ACQUIRE))
+			;
+		for (uint64_t i = 0; i < thread->iterations; ++i)
+			(*thread->body)(thread->index, i);
+		return nullptr;
+	}
+};
+
+/* Runs body(thread_index, i) for i in [0, iterations) on each of thread_count
+ * threads, released together. Prints and returns nanoseconds per operation
+ * across all threads, i.e. wall time / (thread_count * iterations), so lower
+ * is better throughput. */
+template <typename BODY> double djt_bench_run_threads(const char* name, unsigned thread_count, uint64_t iterations, BODY body)
+{
+	djt_bench_thread<BODY>* threads = new djt_bench_thread<BODY>[thread_count];
+	pthread_t* handles = new pthread_t[thread_count];
+	volatile bool go = false;
+	for (unsigned t = 0; t < thread_count; ++t)
+	{
+		threads[t].body = &body;
+		threads[t].index = t;
+		threads[t].iterations = iterations;
+		threads[t].go = &go;
+		pthread_create(&handles[t], nullptr, djt_bench_thread<BODY>::run, &threads[t]);
+	}
+	uint64_t start = djt_bench_now_ns();
+	__atomic_store_n(&go, true, __ATOMIC_RELEASE);
+	for (unsigned t = 0; t < thread_count; ++t)
+		pthread_join(handles[t], nullptr);
+	uint64_t elapsed = djt_bench_now_ns() - start;
+	delete[] handles;
+	delete[] threads;
+	
+	uint64_t operations = (uint64_t)thread_count * iterations;
+	djt_bench_print(name, operations, elapsed);
+	return (double)elapsed / (double)operations;
+}
@@ -0,0 +1,235 @@
+/*
+kextgizmos POSIX stand-ins for the kernel locking, timing and allocation
+primitives used by the lock-based gizmos (IOLock, mach_absolute_time(),
+IOMalloc(), ...), so their sources can be built and exercised by the host
+tests and benchmarks. The headers in tests/kernel_shims/ map the kernel
+include paths onto this file.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include "djt_iouc_host.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Only the semantics the gizmos rely on: absolute time is in nanoseconds, so
+ * the conversion functions are identities, and IOLockWakeup() wakes every
+ * sleeper on the lock regardless of event, which callers tolerate because
+ * they re-check their condition after waking, as they must in the kernel. */
+
+#define kIOReturnNoResources    ((IOReturn)0xe00002be)
+#define kIOReturnVMError        ((IOReturn)0xe00002c8)
+#define kIOReturnNotOpen        ((IOReturn)0xe00002cd)
+#define kIOReturnBusy           ((IOReturn)0xe00002d5)
+#define kIOReturnTimeout        ((IOReturn)0xe00002d6)
+#define kIOReturnNotReady       ((IOReturn)0xe00002d8)
+#define kIOReturnNotFound       ((IOReturn)0xe00002f0)
+
+typedef uint64_t AbsoluteTime;
+typedef int boolean_t;
+
+enum
+{
+	THREAD_UNINT = 0,
+	THREAD_INTERRUPTIBLE = 1,
+	THREAD_ABORTSAFE = 2,
+};
+enum
+{
+	THREAD_AWAKENED = 0,
+	THREAD_TIMED_OUT = 1,
+	THREAD_INTERRUPTED = 2,
+};
+
+#define OSDeclareDefaultStructors(className) \
+	public: \
+		className(); \
+		virtual ~className(); \
+	private:
+#define OSDefineMetaClassAndStructors(className, superclassName) \
+	className::className() {} \
+	className::~className() {}
+#define OSTypeAlloc(type) (new type())
+
+// kern/clock.h
+
+static inline uint64_t mach_absolute_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+static inline void clock_get_uptime(uint64_t* result)
+{
+	*result = mach_absolute_time();
+}
+static inline void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t* result)
+{
+	*result = nanoseconds;
+}
+static inline void absolutetime_to_nanoseconds(uint64_t abstime, uint64_t* result)
+{
+	*result = abstime;
+}
+static inline void clock_absolutetime_interval_to_deadline(uint64_t abstime, uint64_t* result)
+{
+	*result = mach_absolute_time() + abstime;
+}
+
+// IOKit/IOLib.h
+
+static inline void* IOMalloc(size_t size)
+{
+	return malloc(size);
+}
+static inline void IOFree(void* address, size_t)
+{
+	free(address);
+}
+static inline void* IOMallocZero(size_t size)
+{
+	return calloc(1, size);
+}
+static inline void* IOMallocAligned(size_t size, size_t alignment)
+{
+	void* address = nullptr;
+	if (alignment < sizeof(void*))
+		alignment = sizeof(void*);
+	if (posix_memalign(&address, alignment, size) != 0)
+		return nullptr;
+	return address;
+}
+static inline void IOFreeAligned(void* address, size_t)
+{
+	free(address);
+}
+static inline void IOSleep(unsigned milliseconds)
+{
+	usleep(milliseconds * 1000u);
+}
+static inline void IODelay(unsigned microseconds)
+{
+	uint64_t deadline = mach_absolute_time() + microseconds * 1000ull;
+	while (mach_absolute_time() < deadline)
+		;
+}
+static inline void IOLog(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static inline void IOLog(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+}
+
+// IOKit/IOLocks.h
+
+struct IOLock
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t sleepers;
+};
+
+static inline IOLock* IOLockAlloc()
+{
+	IOLock* lock = static_cast<IOLock*>(malloc(sizeof(IOLock)));
+	if (lock == nullptr)
+		return nullptr;
+	pthread_mutex_init(&lock->mutex, nullptr);
+	pthread_cond_init(&lock->sleepers, nullptr);
+	return lock;
+}
+static inline void IOLockFree(IOLock* lock)
+{
+	pthread_cond_destroy(&lock->sleepers);
+	pthread_mutex_destroy(&lock->mutex);
+	free(lock);
+}
+static inline void IOLockLock(IOLock* lock)
+{
+	pthread_mutex_lock(&lock->mutex);
+}
+static inline void IOLockUnlock(IOLock* lock)
+{
+	pthread_mutex_unlock(&lock->mutex);
+}
+static inline bool IOLockTryLock(IOLock* lock)
+{
+	return pthread_mutex_trylock(&lock->mutex) == 0;
+}
+static inline int IOLockSleep(IOLock* lock, void*, uint32_t)
+{
+	pthread_cond_wait(&lock->sleepers, &lock->mutex);
+	return THREAD_AWAKENED;
+}
+static inline int IOLockSleepDeadline(IOLock* lock, void*, AbsoluteTime deadline, uint32_t)
+{
+	uint64_t now = mach_absolute_time();
+	if (now >= deadline)
+		return THREAD_TIMED_OUT;
+	// Condition variables time out against the realtime clock
+	uint64_t remaining = deadline - now;
+	struct timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	uint64_t nanoseconds = (uint64_t)until.tv_nsec + remaining % 1000000000ull;
+	until.tv_sec += (time_t)(remaining / 1000000000ull + nanoseconds / 1000000000ull);
+	until.tv_nsec = (long)(nanoseconds % 1000000000ull);
+	if (pthread_cond_timedwait(&lock->sleepers, &lock->mutex, &until) != 0)
+		return THREAD_TIMED_OUT;
+	return THREAD_AWAKENED;
+}
+static inline void IOLockWakeup(IOLock* lock, void*, bool)
+{
+	pthread_cond_broadcast(&lock->sleepers);
+}
@@ -0,0 +1,92 @@
+/*
+Minimal check macros for the host tests: failures are counted and reported,
+and the test's exit status reflects them.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+static int djt_test_failures;
+
+#define DJT_CHECK(cond) \
+	do { \
+		if (!(cond)) \
+		{ \
+			++djt_test_failures; \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+// For IOReturn and other integer values, printing both sides on failure
+#define DJT_CHECK_EQ(actual, expected) \
+	do { \
+		unsigned long long djt_actual_ = (unsigned long long)(actual); \
+		unsigned long long djt_expected_ = (unsigned long long)(expected); \
+		if (djt_actual_ != djt_expected_) \
+		{ \
+			++djt_test_failures; \
+			fprintf(stderr, "%s:%d: %s == 0x%llx, expected %s == 0x%llx\n", \
+				__FILE__, __LINE__, #actual, djt_actual_, #expected, djt_expected_); \
+		} \
+	} while (0)
+
+// Return value for main()
+static inline int djt_test_report(const char* name)
+{
+	if (djt_test_failures == 0)
+	{
+		printf("%s: all checks passed\n", name);
+		return 0;
+	}
+	printf("%s: %d check(s) failed\n", name, djt_test_failures);
+	return 1;
+}
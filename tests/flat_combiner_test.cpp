@@ -0,0 +1,123 @@
+/*
+Tests for DJTFlatCombiner: every operation runs exactly once and returns its
+own result, from many threads, including with fewer request slots than
+threads, where callers fall back to running their operation under the lock.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTFlatCombiner.hpp"
+#include "djt_bench.h"
+#include "djt_test.h"
+
+namespace
+{
+	struct counter
+	{
+		uint64_t value;
+		uint64_t operations;
+	};
+	
+	// Adds the context's value; returns an error for odd values so results can be checked.
+	IOReturn add(counter* data, void* context)
+	{
+		uint64_t amount = reinterpret_cast<uintptr_t>(context);
+		data->value += amount;
+		++data->operations;
+		return (amount & 1) ? kIOReturnBadArgument : kIOReturnSuccess;
+	}
+	
+	template <unsigned NUM_SLOTS> void test_threads(const char* name, unsigned thread_count, uint64_t iterations)
+	{
+		DJTLock* lock = OSTypeAlloc(DJTLock);
+		DJT_CHECK(lock->init());
+		counter data = {};
+		DJTFlatCombiner<counter, NUM_SLOTS> combiner(&data, lock);
+		uint64_t wrong_results = 0;
+		
+		djt_bench_run_threads(name, thread_count, iterations, [&](unsigned thread, uint64_t i) {
+			uint64_t amount = thread + i;
+			IOReturn result = combiner.execute(add, reinterpret_cast<void*>(static_cast<uintptr_t>(amount)));
+			if (result != ((amount & 1) ? kIOReturnBadArgument : kIOReturnSuccess))
+				__atomic_add_fetch(&wrong_results, 1, __ATOMIC_RELAXED);
+		});
+		
+		uint64_t expected = 0;
+		for (unsigned thread = 0; thread < thread_count; ++thread)
+			expected += thread * iterations + iterations * (iterations - 1) / 2;
+		DJT_CHECK_EQ(data.operations, thread_count * iterations);
+		DJT_CHECK_EQ(data.value, expected);
+		DJT_CHECK_EQ(wrong_results, 0);
+		lock->release();
+	}
+	
+	void test_direct_access()
+	{
+		DJTLock* lock = OSTypeAlloc(DJTLock);
+		DJT_CHECK(lock->init());
+		counter data = {};
+		DJTFlatCombiner<counter> combiner(&data, lock);
+		DJT_CHECK_EQ(combiner.execute(add, reinterpret_cast<void*>(2)), kIOReturnSuccess);
+		DJT_CHECK_EQ(combiner.execute(add, reinterpret_cast<void*>(3)), kIOReturnBadArgument);
+		DJT_CHECK(combiner.getLock() == lock);
+		lock->lock();
+		DJT_CHECK_EQ(data.value, 5);
+		lock->unlock();
+		lock->release();
+	}
+}
+
+// Optional argument: operations per thread.
+int main(int argc, char** argv)
+{
+	uint64_t iterations = djt_bench_iterations(argc, argv, 100000);
+	test_direct_access();
+	test_threads<64>("flat combiner, 64 slots, 8 threads", 8, iterations);
+	test_threads<2>("flat combiner, 2 slots, 8 threads (slot fallback)", 8, iterations);
+	return djt_test_report("flat_combiner_test");
+}
@@ -0,0 +1,302 @@
+/*
+Test of djt_iouc_ring through the djt_iouc_ring_posix.h stand-in: a client
+thread submits commands with varying scalar and struct arguments, some of
+them malformed, while a server thread dispatches them with
+djt_iouc_ring_posix_serve_once(). The completion ring is kept small so the
+server often finds it full, holds the completion back and re-posts it on its
+next drain, relying on the client ringing the doorbell after draining
+completions; a lost doorbell or notification hangs the test.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+#include "djt_iouc_ring_posix.h"
+#include "djt_bench.h"
+#include "djt_test.h"
+#include <pthread.h>
+
+namespace
+{
+	enum test_selector
+	{
+		// Returns the sum of the scalars, and the struct input reversed.
+		SELECTOR_SUM_REVERSE = 0,
+		SELECTOR_UNKNOWN,
+	};
+	// kIOReturnUnsupported
+	const int32_t RESULT_UNSUPPORTED = (int32_t)0xe00002c7;
+	
+	const uint32_t MAX_STRUCT_INPUT = 48;
+	
+	void dispatch(void* context, const djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result)
+	{
+		++*static_cast<uint64_t*>(context);
+		djt_iouc_batch_result header = {};
+		if (entry->selector != SELECTOR_SUM_REVERSE || entry->scalar_output_count != 1
+			|| entry->struct_output_size != entry->struct_input_size)
+		{
+			header.result = RESULT_UNSUPPORTED;
+			memcpy(result, &header, sizeof(header));
+			return;
+		}
+		uint64_t sum = 0;
+		for (uint32_t i = 0; i < entry->scalar_input_count; ++i)
+		{
+			uint64_t scalar;
+			memcpy(&scalar, payload + i * sizeof(uint64_t), sizeof(scalar));
+			sum += scalar;
+		}
+		const uint8_t* struct_input = payload + entry->scalar_input_count * sizeof(uint64_t);
+		uint8_t* struct_output = result + sizeof(header) + sizeof(uint64_t);
+		for (uint32_t i = 0; i < entry->struct_input_size; ++i)
+			struct_output[i] = struct_input[entry->struct_input_size - 1 - i];
+		header.scalar_output_count = 1;
+		header.struct_output_size = entry->struct_input_size;
+		memcpy(result, &header, sizeof(header));
+		memcpy(result + sizeof(header), &sum, sizeof(sum));
+	}
+	
+	// Command i's arguments and expected outcome
+	struct test_command
+	{
+		uint64_t user_data;
+		uint32_t selector;
+		uint64_t scalars[4];
+		uint32_t scalar_count;
+		uint8_t struct_input[MAX_STRUCT_INPUT];
+		uint32_t struct_input_size;
+		uint32_t struct_output_size;
+		// Rejected by the server with DJT_IOUC_RING_RESULT_BAD_ARGUMENT
+		bool malformed;
+		uint64_t sum;
+	};
+	
+	void make_command(test_command* command, uint64_t i)
+	{
+		command->user_data = i * 7 + 1;
+		command->selector = (i % 11 == 5) ? SELECTOR_UNKNOWN : SELECTOR_SUM_REVERSE;
+		command->scalar_count = (uint32_t)(i % 5);
+		command->sum = 0;
+		for (uint32_t s = 0; s < command->scalar_count; ++s)
+		{
+			command->scalars[s] = i * 1000 + s;
+			command->sum += command->scalars[s];
+		}
+		command->struct_input_size = (uint32_t)((i * 13) % (MAX_STRUCT_INPUT + 1));
+		for (uint32_t b = 0; b < command->struct_input_size; ++b)
+			command->struct_input[b] = (uint8_t)(i + b);
+		// Every so often, ask for more output than a completion record can hold
+		command->malformed = (i % 17 == 3);
+		command->struct_output_size = command->malformed ? 4096 : command->struct_input_size;
+	}
+	
+	struct server_thread
+	{
+		djt_iouc_ring_posix_t* ring;
+		djt_iouc_ring_server_t server;
+		uint64_t dispatched;
+		uint64_t completion_stalls;
+		bool stop;
+		bool failed;
+		
+		static void* run(void* arg)
+		{
+			server_thread* thread = static_cast<server_thread*>(arg);
+			while (!__atomic_load_n(&thread->stop, __ATOMIC_ACQUIRE))
+			{
+				if (!djt_iouc_ring_posix_serve_once(thread->ring, &thread->server, dispatch, &thread->dispatched, 8))
+				{
+					thread->failed = true;
+					break;
+				}
+				// A completion is waiting for space in the completion ring
+				if (thread->server.pending_length != 0)
+					++thread->completion_stalls;
+			}
+			return nullptr;
+		}
+	};
+	
+	// Returns 1 if the completion doesn't match the command, else 0.
+	uint64_t check_completion(const void* record, uint32_t length, const test_command* command)
+	{
+		djt_iouc_ring_completion completion;
+		if (length < sizeof(completion))
+			return 1;
+		memcpy(&completion, record, sizeof(completion));
+		if (completion.user_data != command->user_data)
+			return 1;
+		if (command->malformed)
+			return (length == sizeof(completion) && completion.result.result == DJT_IOUC_RING_RESULT_BAD_ARGUMENT) ? 0 : 1;
+		
+		djt_iouc_batch_entry entry = {};
+		entry.scalar_output_count = 1;
+		entry.struct_output_size = command->struct_output_size;
+		if (length != djt_iouc_ring_completion_size(&entry))
+			return 1;
+		if (command->selector != SELECTOR_SUM_REVERSE)
+			return (completion.result.result == RESULT_UNSUPPORTED) ? 0 : 1;
+		if (completion.result.result != 0 || completion.result.scalar_output_count != 1
+			|| completion.result.struct_output_size != command->struct_input_size)
+			return 1;
+		const uint8_t* outputs = static_cast<const uint8_t*>(record) + sizeof(completion);
+		uint64_t sum;
+		memcpy(&sum, outputs, sizeof(sum));
+		if (sum != command->sum)
+			return 1;
+		for (uint32_t b = 0; b < command->struct_input_size; ++b)
+			if (outputs[sizeof(sum) + b] != command->struct_input[command->struct_input_size - 1 - b])
+				return 1;
+		return 0;
+	}
+	
+	void test_client_server(uint32_t submission_capacity, uint32_t completion_capacity, uint64_t count)
+	{
+		djt_iouc_ring_posix_t ring;
+		DJT_CHECK(djt_iouc_ring_posix_create(&ring, submission_capacity, completion_capacity));
+		
+		server_thread server = {};
+		server.ring = &ring;
+		uint32_t server_scratch_size = djt_iouc_ring_server_scratch_size(submission_capacity, completion_capacity);
+		uint8_t* server_scratch = new uint8_t[server_scratch_size];
+		DJT_CHECK(djt_iouc_ring_server_init(
+			&server.server, ring.submissions.memory, ring.submissions.size,
+			ring.completions.memory, completion_capacity, server_scratch, server_scratch_size));
+		
+		djt_spsc_ring_producer_t submissions;
+		djt_spsc_ring_producer_init(&submissions, ring.submissions.memory, submission_capacity);
+		djt_spsc_ring_consumer_t completions;
+		DJT_CHECK(djt_spsc_ring_consumer_init(&completions, ring.completions.memory, ring.completions.size));
+		uint8_t client_scratch[256];
+		
+		uint64_t start = djt_bench_now_ns();
+		pthread_t thread;
+		pthread_create(&thread, nullptr, server_thread::run, &server);
+		
+		uint64_t submitted = 0;
+		uint64_t received = 0;
+		uint64_t bad_completions = 0;
+		uint64_t doorbells = 0;
+		uint64_t waits = 0;
+		test_command command;
+		while (received < count)
+		{
+			while (submitted < count)
+			{
+				make_command(&command, submitted);
+				enum djt_spsc_ring_status status = djt_iouc_ring_posix_submit(
+					&ring, &submissions, client_scratch, sizeof(client_scratch), command.user_data,
+					command.selector, command.scalars, command.scalar_count, command.struct_input, command.struct_input_size,
+					1, command.struct_output_size);
+				if (status == DJT_SPSC_RING_FULL)
+					break;
+				DJT_CHECK_EQ(status, DJT_SPSC_RING_OK);
+				++submitted;
+			}
+			
+			uint64_t drained = 0;
+			const void* record;
+			uint32_t length;
+			while (djt_spsc_ring_peek(&completions, &record, &length) == DJT_SPSC_RING_OK)
+			{
+				make_command(&command, received);
+				bad_completions += check_completion(record, length, &command);
+				djt_spsc_ring_consume(&completions);
+				++received;
+				++drained;
+			}
+			if (drained > 0)
+			{
+				/* The server may have stopped on a full completion ring, without
+				 * going idle: submitting alone won't wake it. */
+				if (received < submitted)
+				{
+					djt_iouc_ring_posix_ring_doorbell(&ring);
+					++doorbells;
+				}
+			}
+			else if (received < count)
+			{
+				djt_spsc_ring_posix_wait(&ring.completions, &completions);
+				++waits;
+			}
+		}
+		
+		__atomic_store_n(&server.stop, true, __ATOMIC_RELEASE);
+		djt_iouc_ring_posix_ring_doorbell(&ring);
+		pthread_join(thread, nullptr);
+		uint64_t elapsed = djt_bench_now_ns() - start;
+		
+		DJT_CHECK(!server.failed);
+		DJT_CHECK_EQ(received, count);
+		DJT_CHECK_EQ(bad_completions, 0);
+		// Malformed commands never reach the dispatch function
+		DJT_CHECK_EQ(server.dispatched, count - (count + 13) / 17);
+		const void* record;
+		uint32_t length;
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_EMPTY);
+		if (completion_capacity <= 256)
+			DJT_CHECK(server.completion_stalls > 0);
+		printf("completion ring %u bytes: %llu commands in %.1f ms, server stalled on a full completion ring %llu times, "
+			"client rang %llu doorbells after draining and slept %llu times\n",
+			completion_capacity, (unsigned long long)count, elapsed / 1e6, (unsigned long long)server.completion_stalls,
+			(unsigned long long)doorbells, (unsigned long long)waits);
+		
+		delete[] server_scratch;
+		djt_iouc_ring_posix_destroy(&ring);
+	}
+}
+
+// Optional argument: commands per run.
+int main(int argc, char** argv)
+{
+	uint64_t count = djt_bench_iterations(argc, argv, 100000);
+	// Room for a couple of the largest completions only
+	test_client_server(4096, 256, count);
+	test_client_server(4096, 4096, count);
+	return djt_test_report("iouc_ring_test");
+}
@@ -0,0 +1,3 @@
+// Host build stand-in for <IOKit/IOLocks.h>, see djt_kernel_posix.h
+#pragma once
+#include "djt_kernel_posix.h"
@@ -0,0 +1,197 @@
+/*
+Tests for DJTUserClientMapCache on the host stand-ins: hits within cached
+ranges, LRU eviction to stay within the wired byte limit, oversized ranges,
+racing misses on the same range sharing one entry, and invalidation.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTUserClientMapCache.hpp"
+#include "djt_test.h"
+#include <pthread.h>
+
+namespace
+{
+	const mach_vm_size_t page = 4096;
+	alignas(4096) uint8_t client_memory[16 * 4096];
+	
+	mach_vm_address_t client_address(unsigned page_index)
+	{
+		return reinterpret_cast<mach_vm_address_t>(&client_memory[page_index * page]);
+	}
+	
+	int prepare_count(IOMemoryMap* map)
+	{
+		return map->getMemoryDescriptor()->getPrepareCount();
+	}
+	
+	void test_hits()
+	{
+		DJTUserClientMapCache* cache = DJTUserClientMapCache::withTask(current_task());
+		DJT_CHECK(cache != nullptr);
+		IOMemoryMap* map = nullptr;
+		void* kernel_address = nullptr;
+		DJT_CHECK_EQ(cache->mapRange(client_address(0), 4 * page, kIODirectionInOut, &map, &kernel_address), kIOReturnSuccess);
+		DJT_CHECK(kernel_address == &client_memory[0]);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 4 * page);
+		DJT_CHECK_EQ(prepare_count(map), 1);
+		
+		// Within the cached range, and a subset of its direction
+		IOMemoryMap* sub_map = nullptr;
+		DJT_CHECK_EQ(cache->mapRange(client_address(1) + 16, 100, kIODirectionOut, &sub_map, &kernel_address), kIOReturnSuccess);
+		DJT_CHECK(sub_map == map);
+		DJT_CHECK(kernel_address == &client_memory[page + 16]);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 4 * page);
+		OSSafeReleaseNULL(sub_map);
+		
+		DJT_CHECK_EQ(cache->mapRange(client_address(0), 0, kIODirectionOut, &sub_map, &kernel_address), kIOReturnBadArgument);
+		
+		cache->invalidateRange(client_address(3), 1);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 0);
+		DJT_CHECK_EQ(prepare_count(map), 0);
+		OSSafeReleaseNULL(map);
+		cache->release();
+	}
+	
+	void test_wired_limit()
+	{
+		DJTUserClientMapCache* cache = DJTUserClientMapCache::withTask(current_task(), 8, 3 * page);
+		IOMemoryMap* maps[4] = {};
+		void* kernel_address;
+		for (unsigned i = 0; i < 3; ++i)
+			DJT_CHECK_EQ(cache->mapRange(client_address(i), page, kIODirectionOut, &maps[i], &kernel_address), kIOReturnSuccess);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 3 * page);
+		
+		// Use page 0 again, so page 1 is the least recently used
+		IOMemoryMap* map;
+		DJT_CHECK_EQ(cache->mapRange(client_address(0), page, kIODirectionOut, &map, &kernel_address), kIOReturnSuccess);
+		DJT_CHECK(map == maps[0]);
+		OSSafeReleaseNULL(map);
+		DJT_CHECK_EQ(cache->mapRange(client_address(3), page, kIODirectionOut, &maps[3], &kernel_address), kIOReturnSuccess);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 3 * page);
+		DJT_CHECK_EQ(prepare_count(maps[0]), 1);
+		DJT_CHECK_EQ(prepare_count(maps[1]), 0);
+		DJT_CHECK_EQ(prepare_count(maps[2]), 1);
+		DJT_CHECK_EQ(prepare_count(maps[3]), 1);
+		
+		// Larger than the limit: refused without evicting anything
+		DJT_CHECK_EQ(cache->mapRange(client_address(8), 4 * page, kIODirectionOut, &map, &kernel_address), kIOReturnNoResources);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 3 * page);
+		// Two pages need two evictions, of pages 2 and 0
+		DJT_CHECK_EQ(cache->mapRange(client_address(8), 2 * page, kIODirectionOut, &map, &kernel_address), kIOReturnSuccess);
+		DJT_CHECK_EQ(cache->getWiredBytes(), 3 * page);
+		DJT_CHECK_EQ(prepare_count(maps[0]), 0);
+		DJT_CHECK_EQ(prepare_count(maps[2]), 0);
+		DJT_CHECK_EQ(prepare_count(maps[3]), 1);
+		OSSafeReleaseNULL(map);
+		
+		cache->flush();
+		DJT_CHECK_EQ(cache->getWiredBytes(), 0);
+		DJT_CHECK_EQ(prepare_count(maps[3]), 0);
+		for (unsigned i = 0; i < 4; ++i)
+			OSSafeReleaseNULL(maps[i]);
+		cache->release();
+	}
+	
+	struct racer
+	{
+		DJTUserClientMapCache* cache;
+		volatile bool* go;
+		IOMemoryMap* map;
+		IOReturn result;
+		
+		static void* run(void* arg)
+		{
+			racer* r = static_cast<racer*>(arg);
+			while (!__atomic_load_n(r->go, __ATOMIC_ACQUIRE))
+				;
+			void* kernel_address;
+			r->result = r->cache->mapRange(client_address(4), 2 * page, kIODirectionIn, &r->map, &kernel_address);
+			return nullptr;
+		}
+	};
+	
+	void test_racing_misses()
+	{
+		for (unsigned round = 0; round < 50; ++round)
+		{
+			DJTUserClientMapCache* cache = DJTUserClientMapCache::withTask(current_task());
+			racer racers[8];
+			pthread_t threads[8];
+			volatile bool go = false;
+			for (unsigned i = 0; i < 8; ++i)
+			{
+				racers[i] = { cache, &go, nullptr, kIOReturnError };
+				pthread_create(&threads[i], nullptr, racer::run, &racers[i]);
+			}
+			__atomic_store_n(&go, true, __ATOMIC_RELEASE);
+			for (unsigned i = 0; i < 8; ++i)
+				pthread_join(threads[i], nullptr);
+			
+			// Everyone shares the one cached mapping; losers' mappings were dropped
+			DJT_CHECK_EQ(cache->getWiredBytes(), 2 * page);
+			for (unsigned i = 0; i < 8; ++i)
+			{
+				DJT_CHECK_EQ(racers[i].result, kIOReturnSuccess);
+				DJT_CHECK(racers[i].map == racers[0].map);
+			}
+			DJT_CHECK_EQ(prepare_count(racers[0].map), 1);
+			for (unsigned i = 0; i < 8; ++i)
+				OSSafeReleaseNULL(racers[i].map);
+			cache->release();
+		}
+	}
+}
+
+int main()
+{
+	test_hits();
+	test_wired_limit();
+	test_racing_misses();
+	return djt_test_report("map_cache_test");
+}
@@ -0,0 +1,198 @@
+/*
+Tests for DJTMPSCQueue: FIFO order and the empty->non-empty signal in a
+single thread, then a multi-producer stress test which checks that every item
+arrives exactly once, in per-producer order, with the consumer sleeping on
+the djt_mpsc_queue_posix.h wakeup between drains (a lost wakeup hangs it).
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "djt_mpsc_queue_posix.h"
+#include "djt_bench.h"
+#include "djt_test.h"
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+	struct test_item : DJTMPSCQueueLink
+	{
+		unsigned producer;
+		uint64_t sequence;
+	};
+	
+	void test_single_thread()
+	{
+		DJTMPSCQueue<test_item> queue;
+		test_item items[4] = {};
+		DJT_CHECK(queue.isEmpty());
+		DJT_CHECK(queue.takeAll() == nullptr);
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			items[i].sequence = i;
+			// Only the first push finds the queue empty
+			DJT_CHECK_EQ(queue.push(&items[i]), i == 0);
+		}
+		DJT_CHECK(!queue.isEmpty());
+		
+		uint64_t expected = 0;
+		for (test_item* item = queue.takeAll(); item != nullptr; item = DJTMPSCQueue<test_item>::next(item))
+			DJT_CHECK_EQ(item->sequence, expected++);
+		DJT_CHECK_EQ(expected, 4);
+		DJT_CHECK(queue.isEmpty());
+		
+		// Items may be re-pushed from within drainAll(); they're seen on the next pass
+		DJT_CHECK(queue.push(&items[0]));
+		DJT_CHECK(!queue.push(&items[1]));
+		bool repushed = false;
+		unsigned count = queue.drainAll([&](test_item* item) {
+			if (item == &items[1] && !repushed)
+			{
+				repushed = true;
+				queue.push(item);
+			}
+		});
+		DJT_CHECK_EQ(count, 3);
+		DJT_CHECK(queue.isEmpty());
+	}
+	
+	struct stress_producer
+	{
+		DJTMPSCQueuePosix<test_item>* queue;
+		test_item* items;
+		unsigned index;
+		uint64_t count;
+		volatile bool* go;
+		
+		static void* run(void* arg)
+		{
+			stress_producer* producer = static_cast<stress_producer*>(arg);
+			while (!__atomic_load_n(producer->go, __ATOMIC_ACQUIRE))
+				sched_yield();
+			for (uint64_t i = 0; i < producer->count; ++i)
+			{
+				test_item* item = &producer->items[i];
+				item->producer = producer->index;
+				item->sequence = i;
+				producer->queue->push(item);
+				// Vary the interleaving, and let the consumer catch up to an empty queue
+				if ((i & 1023) == producer->index)
+					sched_yield();
+			}
+			return nullptr;
+		}
+	};
+	
+	void test_stress(unsigned producer_count, uint64_t items_per_producer)
+	{
+		DJTMPSCQueuePosix<test_item> queue;
+		DJT_CHECK(queue.create());
+		stress_producer* producers = new stress_producer[producer_count];
+		pthread_t* threads = new pthread_t[producer_count];
+		uint64_t* next_sequence = new uint64_t[producer_count]();
+		volatile bool go = false;
+		for (unsigned p = 0; p < producer_count; ++p)
+		{
+			producers[p].queue = &queue;
+			producers[p].items = new test_item[items_per_producer]();
+			producers[p].index = p;
+			producers[p].count = items_per_producer;
+			producers[p].go = &go;
+			pthread_create(&threads[p], nullptr, stress_producer::run, &producers[p]);
+		}
+		
+		uint64_t start = djt_bench_now_ns();
+		__atomic_store_n(&go, true, __ATOMIC_RELEASE);
+		const uint64_t total = producer_count * items_per_producer;
+		uint64_t received = 0;
+		unsigned order_errors = 0;
+		uint64_t waits = 0;
+		while (true)
+		{
+			received += queue.drainAll([&](test_item* item) {
+				if (item->producer >= producer_count || item->sequence != next_sequence[item->producer])
+					++order_errors;
+				else
+					++next_sequence[item->producer];
+			});
+			if (received >= total)
+				break;
+			queue.wait();
+			++waits;
+		}
+		uint64_t elapsed = djt_bench_now_ns() - start;
+		
+		for (unsigned p = 0; p < producer_count; ++p)
+			pthread_join(threads[p], nullptr);
+		DJT_CHECK_EQ(received, total);
+		DJT_CHECK_EQ(order_errors, 0);
+		for (unsigned p = 0; p < producer_count; ++p)
+			DJT_CHECK_EQ(next_sequence[p], items_per_producer);
+		DJT_CHECK(queue.drainAll([](test_item*) {}) == 0);
+		printf("%u producers: %llu items in %.1f ms, consumer slept %llu times\n",
+			producer_count, (unsigned long long)total, elapsed / 1e6, (unsigned long long)waits);
+		
+		for (unsigned p = 0; p < producer_count; ++p)
+			delete[] producers[p].items;
+		delete[] next_sequence;
+		delete[] threads;
+		delete[] producers;
+		queue.destroy();
+	}
+}
+
+// Optional argument: items per producer for the stress test.
+int main(int argc, char** argv)
+{
+	uint64_t items_per_producer = djt_bench_iterations(argc, argv, 200000);
+	test_single_thread();
+	test_stress(1, items_per_producer);
+	test_stress(4, items_per_producer);
+	test_stress(16, items_per_producer / 4);
+	return djt_test_report("mpsc_queue_test");
+}
@@ -0,0 +1,164 @@
+/*
+Tests for DJTPerCPU and DJTEpochPointer: per-CPU counters summed with
+fold() from many threads, and readers checking that the object they see
+stays alive for their whole read section while a writer keeps replacing it.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTPerCPU.hpp"
+#include "DJTEpochPointer.hpp"
+#include "djt_bench.h"
+#include "djt_test.h"
+
+namespace
+{
+	void test_percpu_counters(unsigned thread_count, uint64_t iterations)
+	{
+		DJTPerCPU<uint64_t>* counters = new DJTPerCPU<uint64_t>();
+		djt_bench_run_threads("DJTPerCPU counter increment", thread_count, iterations, [&](unsigned, uint64_t) {
+			counters->withLocal([](uint64_t& value) { ++value; });
+		});
+		uint64_t total = counters->fold(uint64_t(0), [](uint64_t sum, const uint64_t& value) { return sum + value; });
+		DJT_CHECK_EQ(total, thread_count * iterations);
+		
+		counters->forEach([](uint64_t& value) { value = 0; });
+		DJT_CHECK_EQ(counters->fold(uint64_t(0), [](uint64_t sum, const uint64_t& value) { return sum + value; }), 0);
+		delete counters;
+	}
+	
+	void test_percpu_array()
+	{
+		DJTPerCPUArray<uint32_t, 8>* array = new DJTPerCPUArray<uint32_t, 8>();
+		DJT_CHECK_EQ(array->slotCount(), 8);
+		DJT_CHECK(array->currentSlotHint() < 8);
+		// Same thread, same slot
+		DJT_CHECK_EQ(array->currentSlotHint(), array->currentSlotHint());
+		for (unsigned i = 0; i < 8; ++i)
+		{
+			DJT_CHECK_EQ((*array)[i], 0);
+			DJT_CHECK_EQ(reinterpret_cast<uintptr_t>(&(*array)[i]) % DJT_CACHE_LINE_SIZE, 0);
+		}
+		delete array;
+	}
+	
+	const uint32_t live_magic = 0x4c495645;
+	
+	// Marks itself dead rather than going away, so late readers are detected.
+	class TestObject : public OSObject
+	{
+	public:
+		volatile uint32_t magic;
+		static uint32_t freed;
+		virtual void free() override
+		{
+			this->magic = 0;
+			__atomic_add_fetch(&freed, 1, __ATOMIC_RELAXED);
+		}
+	};
+	uint32_t TestObject::freed;
+	
+	TestObject* make_object()
+	{
+		TestObject* object = new TestObject();
+		object->magic = live_magic;
+		return object;
+	}
+	
+	void test_epoch_pointer(unsigned reader_count, uint64_t reads, unsigned replacements)
+	{
+		TestObject* first = make_object();
+		DJTEpochPointer* pointer = DJTEpochPointer::withObject(first);
+		DJT_CHECK(pointer != nullptr);
+		first->release();
+		
+		TestObject** objects = new TestObject*[replacements];
+		uint64_t dead_reads = 0;
+		djt_bench_run_threads("DJTEpochPointer read sections, writer replacing", reader_count + 1, reads, [&](unsigned thread, uint64_t i) {
+			if (thread == reader_count)
+			{
+				// Writer: one replacement per call until done
+				if (i < replacements)
+				{
+					objects[i] = make_object();
+					pointer->replace(objects[i]);
+					objects[i]->release();
+				}
+				return;
+			}
+			DJTEpochReadGuard guard(pointer);
+			TestObject* object = guard.getObjectAs<TestObject>();
+			if (object == nullptr || object->magic != live_magic)
+				__atomic_add_fetch(&dead_reads, 1, __ATOMIC_RELAXED);
+		});
+		DJT_CHECK_EQ(dead_reads, 0);
+		// All but the current object have been released
+		DJT_CHECK_EQ(TestObject::freed, replacements);
+		
+		OSObject* current = pointer->copyObject();
+		DJT_CHECK(current == objects[replacements - 1]);
+		OSSafeReleaseNULL(current);
+		pointer->release();
+		DJT_CHECK_EQ(TestObject::freed, replacements + 1);
+		
+		delete first;
+		for (unsigned i = 0; i < replacements; ++i)
+			delete objects[i];
+		delete[] objects;
+	}
+}
+
+// Optional argument: iterations per thread.
+int main(int argc, char** argv)
+{
+	uint64_t iterations = djt_bench_iterations(argc, argv, 200000);
+	test_percpu_array();
+	test_percpu_counters(8, iterations);
+	test_epoch_pointer(4, iterations, iterations < 1000 ? iterations : 1000);
+	return djt_test_report("percpu_test");
+}
@@ -0,0 +1,398 @@
+/*
+Tests for djt_spsc_ring through the djt_spsc_ring_posix.h transport: record
+framing and wraparound padding, FULL/EMPTY/TOO_LARGE, DJT_SPSC_RING_CORRUPT
+for a tampered head, tail or record length, the consumer_idle wakeup
+handshake, and a two-thread stress test which pushes variable-length records
+through a small ring many times over, the consumer blocking on the pipe when
+it runs dry (a lost wakeup hangs it).
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+#include "djt_spsc_ring_posix.h"
+#include "djt_bench.h"
+#include "djt_test.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+	// Deterministic record contents, so the consumer can check them.
+	uint32_t record_length(uint64_t sequence, uint32_t max_length)
+	{
+		uint64_t hash = (sequence + 1) * 0x9e3779b97f4a7c15ull;
+		return (uint32_t)((hash >> 32) % (max_length + 1));
+	}
+	void fill_record(uint8_t* payload, uint64_t sequence, uint32_t length)
+	{
+		for (uint32_t i = 0; i < length; ++i)
+			payload[i] = (uint8_t)(sequence * 31 + i);
+	}
+	bool check_record(const void* payload, uint64_t sequence, uint32_t length)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+		for (uint32_t i = 0; i < length; ++i)
+			if (bytes[i] != (uint8_t)(sequence * 31 + i))
+				return false;
+		return true;
+	}
+	
+	// Would enqueueing length bytes next write a padding record first?
+	bool needs_padding(const djt_spsc_ring_producer_t* producer, uint32_t length)
+	{
+		uint32_t contiguous = producer->capacity - (producer->tail & (producer->capacity - 1));
+		return contiguous < djt_spsc_ring_record_size(length);
+	}
+	
+	struct test_ring
+	{
+		djt_spsc_ring_posix_t ring;
+		djt_spsc_ring_producer_t producer;
+		djt_spsc_ring_consumer_t consumer;
+		
+		bool create(uint32_t capacity)
+		{
+			if (!djt_spsc_ring_posix_create(&this->ring, capacity))
+				return false;
+			djt_spsc_ring_producer_init(&this->producer, this->ring.memory, capacity);
+			return djt_spsc_ring_consumer_init(&this->consumer, this->ring.memory, this->ring.size);
+		}
+		djt_spsc_ring_header_t* header()
+		{
+			return static_cast<djt_spsc_ring_header_t*>(this->ring.memory);
+		}
+		uint8_t* data()
+		{
+			return static_cast<uint8_t*>(this->ring.memory) + sizeof(djt_spsc_ring_header_t);
+		}
+	};
+	
+	void test_init()
+	{
+		uint8_t memory[sizeof(djt_spsc_ring_header_t) + 64] = {};
+		DJT_CHECK(!djt_spsc_ring_init(memory, 8));
+		DJT_CHECK(!djt_spsc_ring_init(memory, 48));
+		djt_spsc_ring_consumer_t consumer;
+		// No magic yet
+		DJT_CHECK(!djt_spsc_ring_consumer_init(&consumer, memory, sizeof(memory)));
+		DJT_CHECK(djt_spsc_ring_init(memory, 64));
+		DJT_CHECK(djt_spsc_ring_consumer_init(&consumer, memory, sizeof(memory)));
+		// The shared capacity claims more memory than was mapped
+		DJT_CHECK(!djt_spsc_ring_consumer_init(&consumer, memory, sizeof(memory) - 1));
+		reinterpret_cast<djt_spsc_ring_header_t*>(memory)->capacity = 128;
+		DJT_CHECK(!djt_spsc_ring_consumer_init(&consumer, memory, sizeof(memory)));
+	}
+	
+	void test_framing_and_padding()
+	{
+		const uint32_t capacity = 64;
+		test_ring ring;
+		DJT_CHECK(ring.create(capacity));
+		const void* payload = nullptr;
+		uint32_t length = 0;
+		uint8_t buffer[64] = {};
+		
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_EMPTY);
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, capacity), DJT_SPSC_RING_TOO_LARGE);
+		// Records over half the capacity might never fit after padding
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 25), DJT_SPSC_RING_TOO_LARGE);
+		
+		// 3 bytes of payload occupy a 16 byte record; three fill 48 of 64 bytes
+		for (uint64_t sequence = 0; sequence < 3; ++sequence)
+		{
+			fill_record(buffer, sequence, 3);
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 3), DJT_SPSC_RING_OK);
+		}
+		DJT_CHECK_EQ(ring.header()->tail, 48);
+		// 24 byte records need 32 bytes: doesn't fit, even though the 16 bytes at the end are free
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 24), DJT_SPSC_RING_FULL);
+		
+		for (uint64_t sequence = 0; sequence < 2; ++sequence)
+		{
+			DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_OK);
+			DJT_CHECK_EQ(length, 3);
+			DJT_CHECK(check_record(payload, sequence, length));
+			djt_spsc_ring_consume(&ring.consumer);
+		}
+		DJT_CHECK_EQ(ring.header()->head, 32);
+		
+		// Now the 32 byte record goes at offset 0, after a padding record at 48
+		DJT_CHECK(needs_padding(&ring.producer, 24));
+		fill_record(buffer, 3, 24);
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 24), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(ring.header()->tail, 96);
+		djt_spsc_ring_record padding;
+		memcpy(&padding, ring.data() + 48, sizeof(padding));
+		DJT_CHECK_EQ(padding.length, DJT_SPSC_RING_PADDING);
+		
+		// The consumer skips the padding and sees the record at the start
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_OK);
+		DJT_CHECK(check_record(payload, 2, length));
+		djt_spsc_ring_consume(&ring.consumer);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_OK);
+		DJT_CHECK(payload == ring.data() + sizeof(djt_spsc_ring_record));
+		DJT_CHECK_EQ(length, 24);
+		DJT_CHECK(check_record(payload, 3, length));
+		djt_spsc_ring_consume(&ring.consumer);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_EMPTY);
+		DJT_CHECK_EQ(ring.header()->head, 96);
+		
+		// Zero-length records are allowed
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, nullptr, 0), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(length, 0);
+		djt_spsc_ring_consume(&ring.consumer);
+		djt_spsc_ring_posix_destroy(&ring.ring);
+	}
+	
+	// Each side treats the other's shared index, and the record headers, as untrusted.
+	void test_corruption()
+	{
+		const uint32_t capacity = 64;
+		uint8_t buffer[16] = {};
+		const void* payload = nullptr;
+		uint32_t length = 0;
+		{
+			test_ring ring;
+			DJT_CHECK(ring.create(capacity));
+			// head ahead of the producer's tail
+			__atomic_store_n(&ring.header()->head, 8, __ATOMIC_RELEASE);
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 4), DJT_SPSC_RING_CORRUPT);
+			// head not record-aligned
+			__atomic_store_n(&ring.header()->head, (uint32_t)-4, __ATOMIC_RELEASE);
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 4), DJT_SPSC_RING_CORRUPT);
+			// The producer keeps its own tail, so restoring head recovers
+			__atomic_store_n(&ring.header()->head, 0, __ATOMIC_RELEASE);
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 4), DJT_SPSC_RING_OK);
+			djt_spsc_ring_posix_destroy(&ring.ring);
+		}
+		{
+			test_ring ring;
+			DJT_CHECK(ring.create(capacity));
+			// tail more than a ring's worth ahead of the consumer's head
+			__atomic_store_n(&ring.header()->tail, capacity + 8, __ATOMIC_RELEASE);
+			DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_CORRUPT);
+			djt_spsc_ring_posix_destroy(&ring.ring);
+		}
+		{
+			test_ring ring;
+			DJT_CHECK(ring.create(capacity));
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 4), DJT_SPSC_RING_OK);
+			djt_spsc_ring_record record;
+			// A length running past the data published so far
+			memcpy(&record, ring.data(), sizeof(record));
+			record.length = 12;
+			memcpy(ring.data(), &record, sizeof(record));
+			DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_CORRUPT);
+			// A length running past the end of the data area
+			DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 16), DJT_SPSC_RING_OK);
+			record.length = capacity;
+			memcpy(ring.data(), &record, sizeof(record));
+			DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_CORRUPT);
+			// The consumer hasn't moved
+			DJT_CHECK_EQ(ring.header()->head, 0);
+			djt_spsc_ring_posix_destroy(&ring.ring);
+		}
+	}
+	
+	// Bytes waiting in the wakeup pipe, without blocking.
+	unsigned drain_wake_pipe(test_ring* ring)
+	{
+		int flags = fcntl(ring->ring.wake_pipe[0], F_GETFL);
+		fcntl(ring->ring.wake_pipe[0], F_SETFL, flags | O_NONBLOCK);
+		unsigned tokens = 0;
+		char token;
+		while (read(ring->ring.wake_pipe[0], &token, 1) == 1)
+			++tokens;
+		fcntl(ring->ring.wake_pipe[0], F_SETFL, flags);
+		return tokens;
+	}
+	
+	void test_idle_handshake()
+	{
+		test_ring ring;
+		DJT_CHECK(ring.create(64));
+		uint8_t buffer[8] = {};
+		const void* payload = nullptr;
+		uint32_t length = 0;
+		bool wake = true;
+		
+		// A busy consumer is never notified
+		DJT_CHECK_EQ(djt_spsc_ring_enqueue(&ring.producer, buffer, 8, &wake), DJT_SPSC_RING_OK);
+		DJT_CHECK(!wake);
+		// Records are waiting, so don't block
+		DJT_CHECK(!djt_spsc_ring_consumer_prepare_wait(&ring.consumer));
+		DJT_CHECK_EQ(ring.header()->consumer_idle, 0);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_OK);
+		djt_spsc_ring_consume(&ring.consumer);
+		
+		// Idle: exactly one notification for the next record, none for the ones after
+		DJT_CHECK(djt_spsc_ring_consumer_prepare_wait(&ring.consumer));
+		DJT_CHECK_EQ(ring.header()->consumer_idle, 1);
+		DJT_CHECK_EQ(djt_spsc_ring_enqueue(&ring.producer, buffer, 8, &wake), DJT_SPSC_RING_OK);
+		DJT_CHECK(wake);
+		DJT_CHECK_EQ(ring.header()->consumer_idle, 0);
+		DJT_CHECK_EQ(djt_spsc_ring_enqueue(&ring.producer, buffer, 8, &wake), DJT_SPSC_RING_OK);
+		DJT_CHECK(!wake);
+		
+		// The posix transport turns the notification into one byte on the pipe
+		while (djt_spsc_ring_peek(&ring.consumer, &payload, &length) == DJT_SPSC_RING_OK)
+			djt_spsc_ring_consume(&ring.consumer);
+		DJT_CHECK(djt_spsc_ring_consumer_prepare_wait(&ring.consumer));
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 8), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(djt_spsc_ring_posix_enqueue(&ring.ring, &ring.producer, buffer, 8), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(drain_wake_pipe(&ring), 1);
+		// Records are waiting, so this returns without reading the (empty) pipe
+		djt_spsc_ring_posix_wait(&ring.ring, &ring.consumer);
+		DJT_CHECK_EQ(ring.header()->consumer_idle, 0);
+		djt_spsc_ring_posix_destroy(&ring.ring);
+	}
+	
+	struct stress_producer
+	{
+		test_ring* ring;
+		uint64_t count;
+		uint32_t max_length;
+		uint64_t full_count;
+		uint64_t padding_count;
+		
+		static void* run(void* arg)
+		{
+			stress_producer* producer = static_cast<stress_producer*>(arg);
+			uint8_t* buffer = new uint8_t[producer->max_length];
+			for (uint64_t sequence = 0; sequence < producer->count; ++sequence)
+			{
+				uint32_t length = record_length(sequence, producer->max_length);
+				fill_record(buffer, sequence, length);
+				bool padded = needs_padding(&producer->ring->producer, length);
+				enum djt_spsc_ring_status status;
+				while ((status = djt_spsc_ring_posix_enqueue(
+					&producer->ring->ring, &producer->ring->producer, buffer, length)) == DJT_SPSC_RING_FULL)
+				{
+					++producer->full_count;
+					sched_yield();
+				}
+				DJT_CHECK_EQ(status, DJT_SPSC_RING_OK);
+				if (padded)
+					++producer->padding_count;
+				// Vary the interleaving, and let the consumer run dry and sleep
+				if ((sequence & 255) == 0)
+					sched_yield();
+			}
+			delete[] buffer;
+			return nullptr;
+		}
+	};
+	
+	void test_stress(uint32_t capacity, uint64_t count)
+	{
+		test_ring ring;
+		DJT_CHECK(ring.create(capacity));
+		stress_producer producer = {};
+		producer.ring = &ring;
+		producer.count = count;
+		// The largest record that always fits
+		producer.max_length = capacity / 2 - (uint32_t)sizeof(djt_spsc_ring_record);
+		
+		uint64_t start = djt_bench_now_ns();
+		pthread_t thread;
+		pthread_create(&thread, nullptr, stress_producer::run, &producer);
+		uint64_t received = 0;
+		uint64_t bad_records = 0;
+		uint64_t waits = 0;
+		while (received < count)
+		{
+			const void* payload = nullptr;
+			uint32_t length = 0;
+			enum djt_spsc_ring_status status = djt_spsc_ring_peek(&ring.consumer, &payload, &length);
+			if (status == DJT_SPSC_RING_EMPTY)
+			{
+				djt_spsc_ring_posix_wait(&ring.ring, &ring.consumer);
+				++waits;
+				continue;
+			}
+			if (status != DJT_SPSC_RING_OK)
+			{
+				DJT_CHECK_EQ(status, DJT_SPSC_RING_OK);
+				break;
+			}
+			if (length != record_length(received, producer.max_length) || !check_record(payload, received, length))
+				++bad_records;
+			djt_spsc_ring_consume(&ring.consumer);
+			++received;
+		}
+		pthread_join(thread, nullptr);
+		uint64_t elapsed = djt_bench_now_ns() - start;
+		
+		DJT_CHECK_EQ(received, count);
+		DJT_CHECK_EQ(bad_records, 0);
+		const void* payload = nullptr;
+		uint32_t length = 0;
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&ring.consumer, &payload, &length), DJT_SPSC_RING_EMPTY);
+		// Many times round the ring, with padding at the end some of the time
+		DJT_CHECK(ring.header()->tail / capacity > 100);
+		DJT_CHECK(producer.padding_count > 0);
+		printf("capacity %u: %llu records, %u wraps (%llu padded) in %.1f ms, producer full %llu times, consumer slept %llu times\n",
+			capacity, (unsigned long long)count, ring.header()->tail / capacity, (unsigned long long)producer.padding_count,
+			elapsed / 1e6, (unsigned long long)producer.full_count, (unsigned long long)waits);
+		djt_spsc_ring_posix_destroy(&ring.ring);
+	}
+}
+
+// Optional argument: records for the stress test.
+int main(int argc, char** argv)
+{
+	uint64_t count = djt_bench_iterations(argc, argv, 200000);
+	test_init();
+	test_framing_and_padding();
+	test_corruption();
+	test_idle_handshake();
+	test_stress(256, count);
+	test_stress(4096, count);
+	return djt_test_report("spsc_ring_test");
+}
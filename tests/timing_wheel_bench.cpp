@@ -0,0 +1,257 @@
+/*
+Benchmark of DJTTimingWheel against per-object timers, modelled as a sorted
+timer queue (std::multimap, as a kernel timer call queue is ordered by
+deadline): cost per arm/cancel with many timeouts outstanding, cost per
+expiry, and how many timer wakeups each needs for a sparse workload, with the
+wheel ticking every tick versus programmed for nextEventTick().
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTTimingWheel.hpp"
+#include "djt_bench.h"
+#include <map>
+
+namespace
+{
+	struct bench_timeout : DJTTimingWheelEntry
+	{
+		std::multimap<uint64_t, bench_timeout*>::iterator queue_position;
+		bool queued;
+	};
+	
+	uint64_t expired_count;
+	void on_expiry(DJTTimingWheelEntry*, void*)
+	{
+		++expired_count;
+	}
+	
+	// The per-object timer model: one deadline-ordered queue entry per timer.
+	class timer_queue
+	{
+		std::multimap<uint64_t, bench_timeout*> queue;
+	public:
+		void arm(bench_timeout* timeout, uint64_t deadline)
+		{
+			if (timeout->queued)
+				this->queue.erase(timeout->queue_position);
+			timeout->queue_position = this->queue.emplace(deadline, timeout);
+			timeout->queued = true;
+		}
+		bool cancel(bench_timeout* timeout)
+		{
+			if (!timeout->queued)
+				return false;
+			this->queue.erase(timeout->queue_position);
+			timeout->queued = false;
+			return true;
+		}
+		void advance(uint64_t now)
+		{
+			while (!this->queue.empty() && this->queue.begin()->first <= now)
+			{
+				bench_timeout* timeout = this->queue.begin()->second;
+				this->queue.erase(this->queue.begin());
+				timeout->queued = false;
+				timeout->function(timeout, timeout->context);
+			}
+		}
+		uint64_t earliest() const
+		{
+			return this->queue.empty() ? UINT64_MAX : this->queue.begin()->first;
+		}
+	};
+	
+	uint64_t random_state = 0x2545f4914f6cdd1dull;
+	uint64_t next_random()
+	{
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 7;
+		random_state ^= random_state << 17;
+		return random_state;
+	}
+	
+	bench_timeout* make_timeouts(unsigned count)
+	{
+		bench_timeout* timeouts = new bench_timeout[count]();
+		for (unsigned i = 0; i < count; ++i)
+			timeouts[i].init(on_expiry, nullptr);
+		return timeouts;
+	}
+	
+	/* Commands complete long before their timeout: each operation cancels the
+	 * oldest outstanding timeout and arms a new one, one tick later each time. */
+	void bench_arm_cancel(unsigned outstanding, uint64_t iterations)
+	{
+		const uint64_t timeout_ticks = 5000;
+		char name[80];
+		{
+			bench_timeout* timeouts = make_timeouts(outstanding);
+			DJTTimingWheel wheel;
+			for (unsigned i = 0; i < outstanding; ++i)
+				wheel.arm(&timeouts[i], timeout_ticks);
+			snprintf(name, sizeof(name), "wheel: cancel + arm, %u outstanding", outstanding);
+			djt_bench_run(name, iterations, [&](uint64_t i) {
+				bench_timeout* timeout = &timeouts[i % outstanding];
+				wheel.cancel(timeout);
+				wheel.advance(wheel.currentTick() + 1);
+				wheel.arm(timeout, wheel.currentTick() + timeout_ticks);
+			});
+			for (unsigned i = 0; i < outstanding; ++i)
+				wheel.cancel(&timeouts[i]);
+			delete[] timeouts;
+		}
+		{
+			bench_timeout* timeouts = make_timeouts(outstanding);
+			timer_queue queue;
+			uint64_t now = 0;
+			for (unsigned i = 0; i < outstanding; ++i)
+				queue.arm(&timeouts[i], timeout_ticks);
+			snprintf(name, sizeof(name), "per-object timers: cancel + arm, %u outstanding", outstanding);
+			djt_bench_run(name, iterations, [&](uint64_t i) {
+				bench_timeout* timeout = &timeouts[i % outstanding];
+				queue.cancel(timeout);
+				queue.advance(++now);
+				queue.arm(timeout, now + timeout_ticks);
+			});
+			delete[] timeouts;
+		}
+	}
+	
+	// Timeouts that do expire, with random delays of up to 'spread' ticks.
+	void bench_expiry(unsigned count, uint64_t spread, uint64_t iterations)
+	{
+		bench_timeout* timeouts = make_timeouts(count);
+		uint64_t* delays = new uint64_t[count];
+		for (unsigned i = 0; i < count; ++i)
+			delays[i] = 1 + next_random() % spread;
+		uint64_t rounds = iterations / count > 0 ? iterations / count : 1;
+		char name[80];
+		
+		snprintf(name, sizeof(name), "wheel: arm + expire, %u timeouts over %llu ticks", count, (unsigned long long)spread);
+		djt_bench_run(name, rounds, [&](uint64_t) {
+			DJTTimingWheel wheel;
+			for (unsigned i = 0; i < count; ++i)
+				wheel.arm(&timeouts[i], delays[i]);
+			while (wheel.armedCount() > 0)
+				wheel.advance(wheel.nextEventTick());
+		}, count);
+		
+		snprintf(name, sizeof(name), "per-object timers: arm + expire, %u timeouts over %llu ticks", count, (unsigned long long)spread);
+		djt_bench_run(name, rounds, [&](uint64_t) {
+			timer_queue queue;
+			for (unsigned i = 0; i < count; ++i)
+				queue.arm(&timeouts[i], delays[i]);
+			while (queue.earliest() != UINT64_MAX)
+				queue.advance(queue.earliest());
+		}, count);
+		delete[] delays;
+		delete[] timeouts;
+	}
+	
+	/* Timer wakeups for 'count' timeouts spread over 'spread' ticks: the wheel
+	 * ticking every tick while armed (as DJTTimingWheelTimer used to), the
+	 * wheel programmed for nextEventTick(), and per-object timers (one wakeup
+	 * per distinct deadline). */
+	void count_wakeups(unsigned count, uint64_t spread)
+	{
+		bench_timeout* timeouts = make_timeouts(count);
+		uint64_t* delays = new uint64_t[count];
+		for (unsigned i = 0; i < count; ++i)
+			delays[i] = 1 + next_random() % spread;
+		
+		uint64_t per_tick = 0, next_event = 0, per_object = 0;
+		{
+			DJTTimingWheel wheel;
+			for (unsigned i = 0; i < count; ++i)
+				wheel.arm(&timeouts[i], delays[i]);
+			while (wheel.armedCount() > 0)
+			{
+				wheel.advance(wheel.currentTick() + 1);
+				++per_tick;
+			}
+		}
+		{
+			DJTTimingWheel wheel;
+			for (unsigned i = 0; i < count; ++i)
+				wheel.arm(&timeouts[i], delays[i]);
+			while (wheel.armedCount() > 0)
+			{
+				wheel.advance(wheel.nextEventTick());
+				++next_event;
+			}
+		}
+		{
+			timer_queue queue;
+			for (unsigned i = 0; i < count; ++i)
+				queue.arm(&timeouts[i], delays[i]);
+			while (queue.earliest() != UINT64_MAX)
+			{
+				queue.advance(queue.earliest());
+				++per_object;
+			}
+		}
+		printf("timer wakeups, %u timeouts over %llu ticks: wheel every tick %llu, wheel next event %llu, per-object %llu\n",
+			count, (unsigned long long)spread, (unsigned long long)per_tick,
+			(unsigned long long)next_event, (unsigned long long)per_object);
+		delete[] delays;
+		delete[] timeouts;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t iterations = djt_bench_iterations(argc, argv, 2000000);
+	bench_arm_cancel(1024, iterations);
+	bench_arm_cancel(65536, iterations);
+	bench_expiry(1024, 100, iterations);
+	bench_expiry(65536, 100000, iterations);
+	count_wakeups(100, 100000);
+	count_wakeups(10000, 100000);
+	return 0;
+}
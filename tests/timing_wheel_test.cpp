@@ -0,0 +1,259 @@
+/*
+Tests for DJTTimingWheel: against a simple model, with random arming,
+re-arming and cancelling, entries fire exactly once on their expiry tick,
+both when advancing in arbitrary steps and when driven by nextEventTick() the
+way DJTTimingWheelTimer drives it; nested advance() from a callback is a
+no-op.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "DJTTimingWheel.hpp"
+#include "djt_test.h"
+
+namespace
+{
+	struct test_timeout : DJTTimingWheelEntry
+	{
+		DJTTimingWheel* wheel;
+		uint64_t expected_tick; // 0 if not armed in the model
+		uint64_t fired;
+		uint64_t wrong_tick;
+	};
+	
+	void on_expiry(DJTTimingWheelEntry* entry, void*)
+	{
+		test_timeout* timeout = static_cast<test_timeout*>(entry);
+		++timeout->fired;
+		if (timeout->wheel->currentTick() != timeout->expected_tick)
+			++timeout->wrong_tick;
+		timeout->expected_tick = 0;
+	}
+	
+	// xorshift, for reproducible sequences
+	uint64_t random_state = 0x9e3779b97f4a7c15ull;
+	uint64_t next_random()
+	{
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 7;
+		random_state ^= random_state << 17;
+		return random_state;
+	}
+	
+	uint64_t random_delay()
+	{
+		switch (next_random() % 8)
+		{
+		case 0:
+			return 0; // already due: fires on the next tick
+		case 1:
+			return next_random() % 64;
+		case 2:
+			return next_random() % 4096;
+		case 3:
+			return next_random() % (1ull << 24);
+		case 4:
+			return (1ull << 24) + next_random() % (1ull << 26); // beyond the wheel's range
+		default:
+			return next_random() % 300;
+		}
+	}
+	
+	void test_random(bool timer_driven)
+	{
+		const unsigned count = 1000;
+		DJTTimingWheel* wheel = new DJTTimingWheel(12345);
+		test_timeout* timeouts = new test_timeout[count]();
+		for (unsigned i = 0; i < count; ++i)
+		{
+			timeouts[i].init(on_expiry, nullptr);
+			timeouts[i].wheel = wheel;
+		}
+		
+		uint64_t fired_expected = 0;
+		uint64_t early_events = 0;
+		uint64_t advances = 0;
+		for (unsigned round = 0; round < 20000; ++round)
+		{
+			test_timeout* timeout = &timeouts[next_random() % count];
+			if (next_random() % 4 == 0)
+			{
+				DJT_CHECK_EQ(wheel->cancel(timeout), timeout->expected_tick != 0);
+				timeout->expected_tick = 0;
+			}
+			else
+			{
+				uint64_t now = wheel->currentTick();
+				uint64_t expiry = now + random_delay();
+				wheel->arm(timeout, expiry);
+				timeout->expected_tick = expiry > now ? expiry : now + 1;
+			}
+			
+			uint64_t earliest = UINT64_MAX;
+			for (unsigned i = 0; i < count; ++i)
+				if (timeouts[i].expected_tick != 0 && timeouts[i].expected_tick < earliest)
+					earliest = timeouts[i].expected_tick;
+			uint64_t next_event = wheel->nextEventTick();
+			// Never later than the earliest expiry, may be earlier for cascades
+			DJT_CHECK(next_event <= earliest);
+			if (next_event < earliest)
+				++early_events;
+			
+			uint64_t target;
+			if (timer_driven)
+				target = next_event != UINT64_MAX ? next_event : wheel->currentTick() + 1;
+			else
+				target = wheel->currentTick() + (next_random() % 3 == 0 ? next_random() % (1ull << 20) : next_random() % 500);
+			for (unsigned i = 0; i < count; ++i)
+				if (timeouts[i].expected_tick != 0 && timeouts[i].expected_tick <= target)
+					++fired_expected;
+			wheel->advance(target);
+			++advances;
+			DJT_CHECK_EQ(wheel->currentTick(), target);
+		}
+		
+		uint64_t fired = 0, wrong_tick = 0;
+		unsigned armed = 0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			fired += timeouts[i].fired;
+			wrong_tick += timeouts[i].wrong_tick;
+			if (timeouts[i].expected_tick != 0)
+			{
+				++armed;
+				DJT_CHECK(timeouts[i].isArmed());
+				wheel->cancel(&timeouts[i]);
+			}
+		}
+		DJT_CHECK_EQ(fired, fired_expected);
+		DJT_CHECK_EQ(wrong_tick, 0);
+		DJT_CHECK_EQ(wheel->armedCount(), 0);
+		DJT_CHECK(fired > 1000);
+		printf("%s: %llu fired, %u still armed, %llu of %llu next events were cascades\n",
+			timer_driven ? "timer driven" : "random steps", (unsigned long long)fired, armed,
+			(unsigned long long)early_events, (unsigned long long)advances);
+		delete[] timeouts;
+		delete wheel;
+	}
+	
+	struct nesting_timeout : DJTTimingWheelEntry
+	{
+		DJTTimingWheel* wheel;
+		DJTTimingWheelEntry* other;
+		unsigned fired;
+	};
+	
+	void on_nesting_expiry(DJTTimingWheelEntry* entry, void*)
+	{
+		nesting_timeout* timeout = static_cast<nesting_timeout*>(entry);
+		++timeout->fired;
+		uint64_t tick = timeout->wheel->currentTick();
+		// Ignored: the outer advance() is running
+		timeout->wheel->advance(tick + 1000);
+		if (timeout->wheel->currentTick() != tick)
+			timeout->fired += 100;
+		// Re-arming from a callback works, including for due entries
+		if (timeout->fired == 1)
+			timeout->wheel->arm(timeout, tick);
+	}
+	
+	void test_nested_advance()
+	{
+		DJTTimingWheel wheel;
+		nesting_timeout timeout;
+		timeout.init(on_nesting_expiry, nullptr);
+		timeout.wheel = &wheel;
+		wheel.arm(&timeout, 10);
+		DJT_CHECK_EQ(wheel.nextEventTick(), 10);
+		wheel.advance(10);
+		DJT_CHECK_EQ(timeout.fired, 1);
+		DJT_CHECK_EQ(wheel.currentTick(), 10);
+		DJT_CHECK_EQ(wheel.nextEventTick(), 11);
+		wheel.advance(20);
+		DJT_CHECK_EQ(timeout.fired, 2);
+		DJT_CHECK_EQ(wheel.armedCount(), 0);
+		DJT_CHECK_EQ(wheel.nextEventTick(), UINT64_MAX);
+	}
+	
+	void test_sparse_events()
+	{
+		// 100 timeouts 10000 ticks apart need about 100 timer wakeups, not 10^6
+		DJTTimingWheel wheel;
+		test_timeout timeouts[100] = {};
+		for (unsigned i = 0; i < 100; ++i)
+		{
+			timeouts[i].init(on_expiry, nullptr);
+			timeouts[i].wheel = &wheel;
+			timeouts[i].expected_tick = 10000 * (i + 1);
+			wheel.arm(&timeouts[i], timeouts[i].expected_tick);
+		}
+		unsigned wakeups = 0;
+		while (wheel.armedCount() > 0)
+		{
+			wheel.advance(wheel.nextEventTick());
+			++wakeups;
+		}
+		for (unsigned i = 0; i < 100; ++i)
+		{
+			DJT_CHECK_EQ(timeouts[i].fired, 1);
+			DJT_CHECK_EQ(timeouts[i].wrong_tick, 0);
+		}
+		// Each expiry, plus a level 1 and level 2 cascade for most of them
+		DJT_CHECK(wakeups <= 400);
+		printf("sparse: 100 timeouts over %llu ticks took %u wakeups\n", (unsigned long long)wheel.currentTick(), wakeups);
+	}
+}
+
+int main()
+{
+	test_nested_advance();
+	test_sparse_events();
+	test_random(false);
+	test_random(true);
+	return djt_test_report("timing_wheel_test");
+}
@@ -0,0 +1,303 @@
+/*
+Dispatch overhead microbenchmark for userclient.hpp: nanoseconds per call
+for trivial methods of several shapes, from the kernel-style argument packing
+in djt_iouc_host_call_method() down to the method, versus calling the method
+directly. Optional argument: iteration count.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "userclient.hpp"
+#include "djt_iouc_ring.h"
+#include "djt_bench.h"
+
+namespace
+{
+	struct bench_point
+	{
+		uint32_t x;
+		uint32_t y;
+	};
+	
+	class BenchUserClient : public IOUserClient
+	{
+	public:
+		IOReturn nop()
+		{
+			return kIOReturnSuccess;
+		}
+		IOReturn add(uint64_t a, uint64_t b, uint64_t* sum)
+		{
+			*sum = a + b;
+			return kIOReturnSuccess;
+		}
+		IOReturn swap(const bench_point* in, bench_point* out)
+		{
+			out->x = in->y;
+			out->y = in->x;
+			return kIOReturnSuccess;
+		}
+		IOReturn length(const void* data, size_t size, uint64_t* out)
+		{
+			*out = size + (data != nullptr ? 1 : 0);
+			return kIOReturnSuccess;
+		}
+	};
+	
+#define BENCH_USER_CLIENT_METHODS(METHOD) \
+	METHOD(BenchUserClient, nop) \
+	METHOD(BenchUserClient, add) \
+	METHOD(BenchUserClient, swap) \
+	METHOD(BenchUserClient, length)
+	
+	DJT_IOUC_SELECTOR_ENUM(BenchSelector, BENCH_USER_CLIENT_METHODS);
+	typedef DJT_IOUC_METHOD_TABLE(BENCH_USER_CLIENT_METHODS) bench_method_table;
+	
+	const IOExternalMethodDispatch checked_methods[] = {
+		DJT_IOUC_METHOD(BenchUserClient::nop),
+		DJT_IOUC_METHOD(BenchUserClient::add),
+		DJT_IOUC_METHOD(BenchUserClient::swap),
+		DJT_IOUC_METHOD(BenchUserClient::length),
+	};
+	
+	const IOExternalMethodDispatch fast_methods[] = {
+		DJT_IOUC_FAST_METHOD(BenchUserClient, BenchUserClient::nop),
+		DJT_IOUC_FAST_METHOD(BenchUserClient, BenchUserClient::add),
+		DJT_IOUC_FAST_METHOD(BenchUserClient, BenchUserClient::swap),
+		DJT_IOUC_FAST_METHOD(BenchUserClient, BenchUserClient::length),
+	};
+	
+	// Each table is measured through its own externalMethod() override
+	class CheckedUserClient : public BenchUserClient
+	{
+	public:
+		IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override
+		{
+			return djt_dispatch_methods(checked_methods, this, selector, arguments, dispatch, target, reference);
+		}
+	};
+	
+	class FastUserClient : public BenchUserClient
+	{
+	public:
+		IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override
+		{
+			return djt_dispatch_methods(fast_methods, this, selector, arguments, dispatch, target, reference);
+		}
+	};
+	
+	class TableUserClient : public BenchUserClient
+	{
+	public:
+		IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override
+		{
+			return bench_method_table::dispatch_method(this, selector, arguments, dispatch, target, reference);
+		}
+	};
+	
+	// Keeps the compiler from optimising the direct calls away
+	volatile uint64_t sink;
+	
+	void bench_shapes(const char* label, IOUserClient* client, uint64_t iterations)
+	{
+		char name[128];
+		uint64_t in[2] = { 1, 2 };
+		uint64_t out[1];
+		uint32_t out_count;
+		
+		snprintf(name, sizeof(name), "%s: nop", label);
+		djt_bench_run(name, iterations, [&](uint64_t) {
+			djt_iouc_host_call_method(client, kBenchUserClient_nop, nullptr, 0, nullptr, 0, nullptr, nullptr, nullptr, nullptr);
+		});
+		snprintf(name, sizeof(name), "%s: 2 scalars in, 1 out", label);
+		djt_bench_run(name, iterations, [&](uint64_t i) {
+			in[0] = i;
+			out_count = 1;
+			djt_iouc_host_call_method(client, kBenchUserClient_add, in, 2, nullptr, 0, out, &out_count, nullptr, nullptr);
+			sink = out[0];
+		});
+		snprintf(name, sizeof(name), "%s: fixed struct in and out", label);
+		bench_point point = { 1, 2 }, swapped;
+		djt_bench_run(name, iterations, [&](uint64_t i) {
+			point.x = static_cast<uint32_t>(i);
+			size_t size = sizeof(swapped);
+			djt_iouc_host_call_method(client, kBenchUserClient_swap, nullptr, 0, &point, sizeof(point), nullptr, nullptr, &swapped, &size);
+			sink = swapped.y;
+		});
+		static uint8_t data[2 * kDJTIOUCHostInbandStructMax];
+		snprintf(name, sizeof(name), "%s: variable struct in, 64 bytes", label);
+		djt_bench_run(name, iterations, [&](uint64_t) {
+			out_count = 1;
+			djt_iouc_host_call_method(client, kBenchUserClient_length, nullptr, 0, data, 64, out, &out_count, nullptr, nullptr);
+			sink = out[0];
+		});
+		snprintf(name, sizeof(name), "%s: variable struct in, mapped", label);
+		djt_bench_run(name, iterations, [&](uint64_t) {
+			out_count = 1;
+			djt_iouc_host_call_method(client, kBenchUserClient_length, nullptr, 0, data, sizeof(data), out, &out_count, nullptr, nullptr);
+			sink = out[0];
+		});
+	}
+	
+	void bench_direct(BenchUserClient* client, uint64_t iterations)
+	{
+		uint64_t out;
+		djt_bench_run("direct call: 2 scalars in, 1 out", iterations, [&](uint64_t i) {
+			IOReturn (BenchUserClient::* volatile method)(uint64_t, uint64_t, uint64_t*) = &BenchUserClient::add;
+			(client->*method)(i, 2, &out);
+			sink = out;
+		});
+	}
+	
+	/* DJT_IOUC_METHOD entries downcast the target with OSDynamicCast on every
+	 * call (dynamic_cast here, a metaclass chain walk in the kernel);
+	 * DJT_IOUC_FAST_METHOD entries call unchecked_external_method(), which
+	 * downcasts statically. Same calls through both tables, so the difference
+	 * is that check. */
+	void bench_fast_method(IOUserClient* checked, IOUserClient* fast, uint64_t iterations)
+	{
+		uint64_t in[2] = { 1, 2 };
+		uint64_t out[1];
+		uint32_t out_count;
+		double before = djt_bench_run("before: DJT_IOUC_METHOD, 2 scalars in, 1 out", iterations, [&](uint64_t i) {
+			in[0] = i;
+			out_count = 1;
+			djt_iouc_host_call_method(checked, kBenchUserClient_add, in, 2, nullptr, 0, out, &out_count, nullptr, nullptr);
+			sink = out[0];
+		});
+		double after = djt_bench_run("after: DJT_IOUC_FAST_METHOD, 2 scalars in, 1 out", iterations, [&](uint64_t i) {
+			in[0] = i;
+			out_count = 1;
+			djt_iouc_host_call_method(fast, kBenchUserClient_add, in, 2, nullptr, 0, out, &out_count, nullptr, nullptr);
+			sink = out[0];
+		});
+		printf("%-72s %10.1f ns/op\n", "saved by unchecked_external_method", before - after);
+	}
+	
+	void bench_batch(IOUserClient* client, uint64_t iterations)
+	{
+		const uint32_t entries = 32;
+		static uint8_t batch[entries * 64];
+		static uint8_t results[entries * 64];
+		size_t used = 0, result_size = 0;
+		uint64_t in[2] = { 1, 2 };
+		for (uint32_t i = 0; i < entries; ++i)
+			djt_iouc_batch_append(batch, sizeof(batch), &used, &result_size, kBenchUserClient_add, in, 2, nullptr, 0, 1, 0);
+		
+		IOExternalMethodArguments arguments = {};
+		djt_bench_run("batch of 32: 2 scalars in, 1 out, per entry", iterations / entries, [&](uint64_t) {
+			arguments.version = kIOExternalMethodArgumentsCurrentVersion;
+			arguments.structureInput = batch;
+			arguments.structureInputSize = static_cast<uint32_t>(used);
+			arguments.structureOutput = results;
+			arguments.structureOutputSize = static_cast<uint32_t>(result_size);
+			djt_dispatch_batch(checked_methods, client, &arguments, nullptr);
+		}, entries);
+	}
+	
+	void ring_dispatch(void* context, const djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result)
+	{
+		djt_dispatch_packed_call(checked_methods, array_length(checked_methods), static_cast<IOUserClient*>(context), nullptr, *entry, payload, result);
+	}
+	
+	void bench_ring(IOUserClient* client, uint64_t iterations)
+	{
+		const uint32_t capacity = 64 * 1024;
+		void* submission_memory = calloc(1, djt_spsc_ring_total_size(capacity));
+		void* completion_memory = calloc(1, djt_spsc_ring_total_size(capacity));
+		djt_spsc_ring_init(submission_memory, capacity);
+		djt_spsc_ring_init(completion_memory, capacity);
+		static uint8_t server_scratch[2 * capacity];
+		djt_iouc_ring_server_t server;
+		djt_iouc_ring_server_init(
+			&server, submission_memory, djt_spsc_ring_total_size(capacity), completion_memory, capacity,
+			server_scratch, djt_iouc_ring_server_scratch_size(capacity, capacity));
+		djt_spsc_ring_producer_t submissions;
+		djt_spsc_ring_producer_init(&submissions, submission_memory, capacity);
+		djt_spsc_ring_consumer_t completions;
+		djt_spsc_ring_consumer_init(&completions, completion_memory, djt_spsc_ring_total_size(capacity));
+		
+		// Submit 32, drain them on the "kernel" side, reap the completions.
+		const uint32_t burst = 32;
+		uint8_t scratch[128];
+		uint64_t in[2] = { 1, 2 };
+		djt_bench_run("ring, bursts of 32: 2 scalars in, 1 out, per call", iterations / burst, [&](uint64_t i) {
+			bool doorbell, wake;
+			for (uint32_t j = 0; j < burst; ++j)
+				djt_iouc_ring_submit(&submissions, scratch, sizeof(scratch), i * burst + j, kBenchUserClient_add, in, 2, nullptr, 0, 1, 0, &doorbell);
+			djt_iouc_ring_drain(&server, ring_dispatch, client, burst + 1, &wake);
+			const void* record;
+			uint32_t length;
+			while (djt_spsc_ring_peek(&completions, &record, &length) == DJT_SPSC_RING_OK)
+				djt_spsc_ring_consume(&completions);
+		}, burst);
+		free(completion_memory);
+		free(submission_memory);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t iterations = djt_bench_iterations(argc, argv, 2000000);
+	CheckedUserClient* checked = new CheckedUserClient();
+	FastUserClient* fast = new FastUserClient();
+	TableUserClient* table = new TableUserClient();
+	
+	bench_direct(checked, iterations);
+	bench_shapes("DJT_IOUC_METHOD table", checked, iterations);
+	bench_shapes("DJT_IOUC_FAST_METHOD table", fast, iterations);
+	bench_shapes("DJT_IOUC_METHOD_TABLE dispatch_method", table, iterations);
+	bench_fast_method(checked, fast, iterations);
+	bench_batch(checked, iterations);
+	bench_ring(checked, iterations);
+	
+	table->release();
+	fast->release();
+	checked->release();
+	return 0;
+}
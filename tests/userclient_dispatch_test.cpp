@@ -0,0 +1,667 @@
+/*
+Host tests for userclient.hpp's argument marshalling: one user client with a
+method of each supported shape, called the way user space would via
+djt_iouc_host_call_method(), through djt_dispatch_batch() and through the
+djt_iouc_ring submission/completion rings. Built a second time with
+DJT_IOUC_METRICS, to check the per-selector metrics and their export selector.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "djt_iouc_host.h"
+
+// Counts hook calls, so the tests can check every dispatch reaches end().
+struct test_trace_policy
+{
+	typedef int token;
+	static inline unsigned begun = 0;
+	static inline unsigned ended = 0;
+	static token begin(const IOExternalMethodArguments*) { ++begun; return 0; }
+	static void end(token, const IOExternalMethodArguments*, IOReturn) { ++ended; }
+	static void struct_mapping_failed(token&, bool) {}
+};
+#define DJT_IOUC_TRACE_POLICY test_trace_policy
+
+#include "userclient.hpp"
+#include "djt_iouc_ring.h"
+#include "djt_test.h"
+#include <stdlib.h>
+
+namespace
+{
+	struct test_point
+	{
+		uint32_t x;
+		uint32_t y;
+	};
+	
+	class TestUserClient : public IOUserClient
+	{
+	public:
+		mach_port_t async_port = MACH_PORT_NULL;
+		uint32_t async_reference_count = 0;
+		uint64_t async_tag = 0;
+		
+		IOReturn add(uint64_t a, uint64_t b, uint64_t* sum)
+		{
+			*sum = a + b;
+			return kIOReturnSuccess;
+		}
+		IOReturn swap(const test_point* in, test_point* out)
+		{
+			out->x = in->y;
+			out->y = in->x;
+			return kIOReturnSuccess;
+		}
+		IOReturn checksum(const void* data, size_t size, uint64_t* sum, uint64_t* length)
+		{
+			uint64_t total = 0;
+			for (size_t i = 0; i < size; ++i)
+				total += static_cast<const uint8_t*>(data)[i];
+			*sum = total;
+			*length = size;
+			return kIOReturnSuccess;
+		}
+		IOReturn fill(uint64_t value, void* data, size_t size)
+		{
+			memset(data, static_cast<int>(value), size);
+			return kIOReturnSuccess;
+		}
+		IOReturn startAsync(mach_port_t port, io_user_reference_t* reference, uint32_t reference_count, uint64_t tag)
+		{
+			(void)reference;
+			this->async_port = port;
+			this->async_reference_count = reference_count;
+			this->async_tag = tag;
+			return kIOReturnSuccess;
+		}
+		IOReturn wired(djt_iouc_wired_input input, uint64_t* length, uint64_t* prepare_count)
+		{
+			*length = input.length;
+			*prepare_count = input.descriptor != nullptr ? input.descriptor->getPrepareCount() : 0;
+			return kIOReturnSuccess;
+		}
+		IOReturn gather(djt_iouc_sg_input input, uint64_t* sum, uint64_t* length)
+		{
+			uint64_t total = 0;
+			for (uint32_t i = 0; i < input.count; ++i)
+				for (size_t j = 0; j < input.segments[i].length; ++j)
+					total += static_cast<const uint8_t*>(input.segments[i].address)[j];
+			*sum = total;
+			*length = input.length;
+			return kIOReturnSuccess;
+		}
+		IOReturn fail()
+		{
+			return kIOReturnError;
+		}
+		
+		IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override;
+	};
+	
+#define TEST_USER_CLIENT_METHODS(METHOD) \
+	METHOD(TestUserClient, add) \
+	METHOD(TestUserClient, swap) \
+	METHOD(TestUserClient, checksum) \
+	METHOD(TestUserClient, fill) \
+	METHOD(TestUserClient, startAsync) \
+	METHOD(TestUserClient, wired) \
+	METHOD(TestUserClient, gather) \
+	METHOD(TestUserClient, fail)
+	
+	DJT_IOUC_SELECTOR_ENUM(TestSelector, TEST_USER_CLIENT_METHODS);
+	typedef DJT_IOUC_METHOD_TABLE(TEST_USER_CLIENT_METHODS) test_method_table;
+	static_assert(test_method_table::selector<&TestUserClient::fill>() == kTestUserClient_fill, "selector<>() must match the enum");
+	
+	// Outside the method table, so batches can't nest
+	const uint32_t kTestUserClient_batch = test_method_table::count;
+	const uint32_t kTestUserClient_metrics = test_method_table::count + 1;
+	
+	IOReturn TestUserClient::externalMethod(uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference)
+	{
+		if (selector == kTestUserClient_batch)
+			return djt_dispatch_batch(test_method_table::methods, this, arguments, reference);
+		if (selector == kTestUserClient_metrics)
+			return IOUserClient::externalMethod(
+				selector, arguments, const_cast<IOExternalMethodDispatch*>(&djt_iouc_metrics_export<TestUserClient>::dispatch), this, reference);
+		return test_method_table::dispatch_method(this, selector, arguments, dispatch, target, reference);
+	}
+	
+	IOReturn call(
+		TestUserClient* client, uint32_t selector, const uint64_t* scalar_input, uint32_t scalar_input_count,
+		const void* struct_input, size_t struct_input_size, uint64_t* scalar_output, uint32_t scalar_output_count,
+		void* struct_output = nullptr, size_t* struct_output_size = nullptr)
+	{
+		uint32_t output_count = scalar_output_count;
+		IOReturn result = djt_iouc_host_call_method(
+			client, selector, scalar_input, scalar_input_count, struct_input, struct_input_size,
+			scalar_output, &output_count, struct_output, struct_output_size);
+		if (result == kIOReturnSuccess)
+			DJT_CHECK_EQ(output_count, scalar_output_count);
+		return result;
+	}
+	
+	void test_scalar(TestUserClient* client)
+	{
+		uint64_t in[2] = { 40, 2 };
+		uint64_t out[1] = {};
+		DJT_CHECK_EQ(call(client, kTestUserClient_add, in, 2, nullptr, 0, out, 1), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], 42);
+		// Wrong scalar counts are rejected before the method runs
+		DJT_CHECK_EQ(call(client, kTestUserClient_add, in, 1, nullptr, 0, out, 1), kIOReturnBadArgument);
+		DJT_CHECK_EQ(call(client, kTestUserClient_add, in, 2, nullptr, 0, out, 0), kIOReturnBadArgument);
+		// Out of range selectors fall through to IOUserClient
+		DJT_CHECK_EQ(call(client, kTestUserClient_metrics + 1, in, 2, nullptr, 0, out, 1), kIOReturnUnsupported);
+	}
+	
+	void test_fixed_struct(TestUserClient* client)
+	{
+		test_point in = { 1, 2 };
+		test_point out = {};
+		size_t out_size = sizeof(out);
+		DJT_CHECK_EQ(call(client, kTestUserClient_swap, nullptr, 0, &in, sizeof(in), nullptr, 0, &out, &out_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(out.x, 2);
+		DJT_CHECK_EQ(out.y, 1);
+		DJT_CHECK_EQ(out_size, sizeof(out));
+		
+		out_size = sizeof(out) - 1;
+		DJT_CHECK_EQ(call(client, kTestUserClient_swap, nullptr, 0, &in, sizeof(in), nullptr, 0, &out, &out_size), kIOReturnBadArgument);
+		out_size = sizeof(out);
+		DJT_CHECK_EQ(call(client, kTestUserClient_swap, nullptr, 0, &in, sizeof(in) + 1, nullptr, 0, &out, &out_size), kIOReturnBadArgument);
+	}
+	
+	void test_variable_struct(TestUserClient* client)
+	{
+		static uint8_t data[3 * kDJTIOUCHostInbandStructMax];
+		for (size_t i = 0; i < sizeof(data); ++i)
+			data[i] = static_cast<uint8_t>(i);
+		uint64_t expected_sum = 0;
+		for (size_t i = 0; i < sizeof(data); ++i)
+			expected_sum += data[i];
+		
+		uint64_t out[2] = {};
+		// Inline, then by memory descriptor (mapped into the "kernel")
+		DJT_CHECK_EQ(call(client, kTestUserClient_checksum, nullptr, 0, data, 100, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], 99 * 100 / 2);
+		DJT_CHECK_EQ(out[1], 100);
+		DJT_CHECK_EQ(call(client, kTestUserClient_checksum, nullptr, 0, data, sizeof(data), out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], expected_sum);
+		DJT_CHECK_EQ(out[1], sizeof(data));
+		DJT_CHECK_EQ(call(client, kTestUserClient_checksum, nullptr, 0, nullptr, 0, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[1], 0);
+		
+		static uint8_t output[2 * kDJTIOUCHostInbandStructMax];
+		uint64_t value = 0x5a;
+		size_t output_size = 64;
+		DJT_CHECK_EQ(call(client, kTestUserClient_fill, &value, 1, nullptr, 0, nullptr, 0, output, &output_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(output_size, 64);
+		DJT_CHECK_EQ(output[63], 0x5a);
+		DJT_CHECK_EQ(output[64], 0);
+		value = 0xa5;
+		output_size = sizeof(output);
+		DJT_CHECK_EQ(call(client, kTestUserClient_fill, &value, 1, nullptr, 0, nullptr, 0, output, &output_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(output_size, sizeof(output));
+		DJT_CHECK_EQ(output[0], 0xa5);
+		DJT_CHECK_EQ(output[sizeof(output) - 1], 0xa5);
+	}
+	
+	void test_async(TestUserClient* client)
+	{
+		io_user_reference_t reference[kOSAsyncRef64Count] = {};
+		uint64_t tag = 7;
+		IOExternalMethodArguments arguments = {};
+		arguments.version = kIOExternalMethodArgumentsCurrentVersion;
+		arguments.selector = kTestUserClient_startAsync;
+		arguments.scalarInput = &tag;
+		arguments.scalarInputCount = 1;
+		
+		// No wake port: refused before reaching the method
+		DJT_CHECK_EQ(client->externalMethod(kTestUserClient_startAsync, &arguments, nullptr, nullptr, nullptr), kIOReturnBadArgument);
+		DJT_CHECK_EQ(client->async_tag, 0);
+		
+		arguments.asyncWakePort = 0x1234;
+		arguments.asyncReference = reference;
+		arguments.asyncReferenceCount = kOSAsyncRef64Count;
+		DJT_CHECK_EQ(client->externalMethod(kTestUserClient_startAsync, &arguments, nullptr, nullptr, nullptr), kIOReturnSuccess);
+		DJT_CHECK_EQ(client->async_port, 0x1234);
+		DJT_CHECK_EQ(client->async_reference_count, kOSAsyncRef64Count);
+		DJT_CHECK_EQ(client->async_tag, 7);
+	}
+	
+	void test_wired(TestUserClient* client)
+	{
+		static uint8_t data[2 * kDJTIOUCHostInbandStructMax];
+		uint64_t out[2] = {};
+		// Inline input is wrapped in a descriptor, out of line input used as is; both prepared once.
+		DJT_CHECK_EQ(call(client, kTestUserClient_wired, nullptr, 0, data, 64, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], 64);
+		DJT_CHECK_EQ(out[1], 1);
+		DJT_CHECK_EQ(call(client, kTestUserClient_wired, nullptr, 0, data, sizeof(data), out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], sizeof(data));
+		DJT_CHECK_EQ(out[1], 1);
+		DJT_CHECK_EQ(call(client, kTestUserClient_wired, nullptr, 0, nullptr, 0, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], 0);
+		
+		// The descriptor is completed again after the call
+		IOMemoryDescriptor* descriptor = IOMemoryDescriptor::withAddress(data, sizeof(data), kIODirectionOut);
+		uint64_t scalar_output[2] = {};
+		IOExternalMethodArguments arguments = {};
+		arguments.version = kIOExternalMethodArgumentsCurrentVersion;
+		arguments.structureInputDescriptor = descriptor;
+		arguments.scalarOutput = scalar_output;
+		arguments.scalarOutputCount = 2;
+		DJT_CHECK_EQ(client->externalMethod(kTestUserClient_wired, &arguments, nullptr, nullptr, nullptr), kIOReturnSuccess);
+		DJT_CHECK_EQ(scalar_output[1], 1);
+		DJT_CHECK_EQ(descriptor->getPrepareCount(), 0);
+		
+		// Failing to wire the input fails the call, but still ends the trace
+		unsigned ended = test_trace_policy::ended;
+		descriptor->setPrepareError(kIOReturnNotPermitted);
+		DJT_CHECK_EQ(client->externalMethod(kTestUserClient_wired, &arguments, nullptr, nullptr, nullptr), kIOReturnNotPermitted);
+		DJT_CHECK_EQ(test_trace_policy::ended, ended + 1);
+		DJT_CHECK_EQ(descriptor->getPrepareCount(), 0);
+		descriptor->release();
+	}
+	
+	void test_sg(TestUserClient* client)
+	{
+		static uint8_t payload[3 * kDJTIOUCHostInbandStructMax];
+		memset(payload, 1, sizeof(payload));
+		uint8_t header[16];
+		memset(header, 2, sizeof(header));
+		djt_iouc_sg_range ranges[2] = {
+			{ reinterpret_cast<uintptr_t>(payload), sizeof(payload) - 100 },
+			{ reinterpret_cast<uintptr_t>(payload + sizeof(payload) - 10), 7 },
+		};
+		char table[256];
+		size_t table_size = djt_iouc_sg_encode(table, sizeof(table), header, sizeof(header), ranges, 2);
+		DJT_CHECK(table_size > 0);
+		
+		uint64_t out[2] = {};
+		const uint64_t expected_length = sizeof(header) + sizeof(payload) - 100 + 7;
+		DJT_CHECK_EQ(call(client, kTestUserClient_gather, nullptr, 0, table, table_size, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(out[0], 2 * sizeof(header) + sizeof(payload) - 100 + 7);
+		DJT_CHECK_EQ(out[1], expected_length);
+		// Truncated tables and empty ranges are malformed
+		DJT_CHECK_EQ(call(client, kTestUserClient_gather, nullptr, 0, table, table_size - 1, out, 2), kIOReturnBadArgument);
+		ranges[1].length = 0;
+		table_size = djt_iouc_sg_encode(table, sizeof(table), header, sizeof(header), ranges, 2);
+		DJT_CHECK_EQ(call(client, kTestUserClient_gather, nullptr, 0, table, table_size, out, 2), kIOReturnBadArgument);
+	}
+	
+	void test_batch(TestUserClient* client)
+	{
+		uint8_t batch[512];
+		size_t used = 0, result_size = 0;
+		uint64_t add_in[2] = { 3, 4 };
+		test_point point = { 5, 6 };
+		DJT_CHECK_EQ(djt_iouc_batch_append(batch, sizeof(batch), &used, &result_size, kTestUserClient_add, add_in, 2, nullptr, 0, 1, 0), 0);
+		DJT_CHECK_EQ(djt_iouc_batch_append(batch, sizeof(batch), &used, &result_size, kTestUserClient_swap, nullptr, 0, &point, sizeof(point), 0, sizeof(point)), 0);
+		DJT_CHECK_EQ(djt_iouc_batch_append(batch, sizeof(batch), &used, &result_size, kTestUserClient_fail, nullptr, 0, nullptr, 0, 0, 0), 0);
+		DJT_CHECK_EQ(djt_iouc_batch_append(batch, sizeof(batch), &used, &result_size, kTestUserClient_add, add_in, 2, nullptr, 0, 1, 0), 0);
+		
+		uint8_t results[512] = {};
+		size_t results_size = result_size;
+		DJT_CHECK_EQ(call(client, kTestUserClient_batch, nullptr, 0, batch, used, nullptr, 0, results, &results_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(results_size, result_size);
+		
+		djt_iouc_batch_header header;
+		memcpy(&header, results, sizeof(header));
+		DJT_CHECK_EQ(header.count, 4);
+		size_t pos = sizeof(header);
+		djt_iouc_batch_result result;
+		uint64_t sum;
+		memcpy(&result, results + pos, sizeof(result));
+		memcpy(&sum, results + pos + sizeof(result), sizeof(sum));
+		DJT_CHECK_EQ(result.result, kIOReturnSuccess);
+		DJT_CHECK_EQ(result.scalar_output_count, 1);
+		DJT_CHECK_EQ(sum, 7);
+		pos += sizeof(result) + sizeof(uint64_t);
+		test_point swapped;
+		memcpy(&result, results + pos, sizeof(result));
+		memcpy(&swapped, results + pos + sizeof(result), sizeof(swapped));
+		DJT_CHECK_EQ(result.result, kIOReturnSuccess);
+		DJT_CHECK_EQ(result.struct_output_size, sizeof(swapped));
+		DJT_CHECK_EQ(swapped.x, 6);
+		DJT_CHECK_EQ(swapped.y, 5);
+		pos += sizeof(result) + djt_iouc_batch_pad(sizeof(swapped));
+		memcpy(&result, results + pos, sizeof(result));
+		DJT_CHECK_EQ(result.result, kIOReturnError);
+		
+		// Stop at the failing entry
+		header.count = 4;
+		header.flags = DJT_IOUC_BATCH_STOP_ON_ERROR;
+		memcpy(batch, &header, sizeof(header));
+		results_size = result_size;
+		DJT_CHECK_EQ(call(client, kTestUserClient_batch, nullptr, 0, batch, used, nullptr, 0, results, &results_size), kIOReturnSuccess);
+		memcpy(&header, results, sizeof(header));
+		DJT_CHECK_EQ(header.count, 3);
+		
+		header.count = 4;
+		header.flags = 0;
+		memcpy(batch, &header, sizeof(header));
+		// Output too small for all the results
+		results_size = result_size - 8;
+		DJT_CHECK_EQ(call(client, kTestUserClient_batch, nullptr, 0, batch, used, nullptr, 0, results, &results_size), kIOReturnBadArgument);
+		// Truncated input
+		results_size = result_size;
+		DJT_CHECK_EQ(call(client, kTestUserClient_batch, nullptr, 0, batch, used - 8, nullptr, 0, results, &results_size), kIOReturnBadArgument);
+	}
+	
+	// Struct sizes which would wrap to a small size if padded in 32 bits
+	void test_batch_size_overflow(TestUserClient* client)
+	{
+		const uint32_t huge_sizes[] = { 0xffffffffu, 0xfffffff9u, 0xfffffff8u };
+		for (uint32_t huge : huge_sizes)
+		{
+			for (int output = 0; output < 2; ++output)
+			{
+				uint8_t batch[sizeof(djt_iouc_batch_header) + sizeof(djt_iouc_batch_entry) + 64] = {};
+				djt_iouc_batch_header header = { 1, 0 };
+				djt_iouc_batch_entry entry = { kTestUserClient_fill, 0, 0, 0, 0 };
+				if (output)
+					entry.struct_output_size = huge;
+				else
+					entry.struct_input_size = huge;
+				memcpy(batch, &header, sizeof(header));
+				memcpy(batch + sizeof(header), &entry, sizeof(entry));
+				
+				uint8_t results[sizeof(djt_iouc_batch_header) + sizeof(djt_iouc_batch_result) + 64] = {};
+				size_t results_size = sizeof(results);
+				DJT_CHECK_EQ(call(client, kTestUserClient_batch, nullptr, 0, batch, sizeof(batch), nullptr, 0, results, &results_size), kIOReturnBadArgument);
+				memcpy(&header, results, sizeof(header));
+				DJT_CHECK_EQ(header.count, 0);
+			}
+		}
+	}
+	
+	struct ring_context
+	{
+		TestUserClient* client;
+		const uint8_t* submission_memory;
+		size_t submission_memory_size;
+		uint32_t dispatched;
+		// Set if a method was handed its arguments in the shared submission ring
+		bool payload_shared;
+	};
+	
+	void ring_dispatch(void* context, const djt_iouc_batch_entry* entry, const uint8_t* payload, uint8_t* result)
+	{
+		ring_context* ring = static_cast<ring_context*>(context);
+		TestUserClient* client = ring->client;
+		++ring->dispatched;
+		if (payload >= ring->submission_memory && payload < ring->submission_memory + ring->submission_memory_size)
+			ring->payload_shared = true;
+		djt_dispatch_packed_call(test_method_table::methods, test_method_table::count, client, nullptr, *entry, payload, result);
+	}
+	
+	void test_ring(TestUserClient* client)
+	{
+		const uint32_t capacity = 4096;
+		void* submission_memory = calloc(1, djt_spsc_ring_total_size(capacity));
+		void* completion_memory = calloc(1, djt_spsc_ring_total_size(capacity));
+		DJT_CHECK(djt_spsc_ring_init(submission_memory, capacity));
+		DJT_CHECK(djt_spsc_ring_init(completion_memory, capacity));
+		
+		djt_iouc_ring_server_t server;
+		static uint8_t server_scratch[2 * capacity];
+		DJT_CHECK(djt_iouc_ring_server_init(
+			&server, submission_memory, djt_spsc_ring_total_size(capacity), completion_memory, capacity,
+			server_scratch, djt_iouc_ring_server_scratch_size(capacity, capacity)));
+		djt_spsc_ring_producer_t submissions;
+		djt_spsc_ring_producer_init(&submissions, submission_memory, capacity);
+		djt_spsc_ring_consumer_t completions;
+		DJT_CHECK(djt_spsc_ring_consumer_init(&completions, completion_memory, djt_spsc_ring_total_size(capacity)));
+		
+		uint8_t scratch[256];
+		bool doorbell = false;
+		uint64_t add_in[2] = { 10, 20 };
+		test_point point = { 8, 9 };
+		DJT_CHECK_EQ(djt_iouc_ring_submit(&submissions, scratch, sizeof(scratch), 100, kTestUserClient_add, add_in, 2, nullptr, 0, 1, 0, &doorbell), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(djt_iouc_ring_submit(&submissions, scratch, sizeof(scratch), 101, kTestUserClient_swap, nullptr, 0, &point, sizeof(point), 0, sizeof(point), &doorbell), DJT_SPSC_RING_OK);
+		DJT_CHECK_EQ(djt_iouc_ring_submit(&submissions, scratch, sizeof(scratch), 102, kTestUserClient_add, add_in, 1, nullptr, 0, 1, 0, &doorbell), DJT_SPSC_RING_OK);
+		
+		ring_context context = { client, static_cast<const uint8_t*>(submission_memory), djt_spsc_ring_total_size(capacity), 0, false };
+		bool wake_client = false;
+		DJT_CHECK_EQ(djt_iouc_ring_drain(&server, ring_dispatch, &context, 16, &wake_client), DJT_SPSC_RING_EMPTY);
+		
+		const void* record;
+		uint32_t length;
+		djt_iouc_ring_completion completion;
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_OK);
+		memcpy(&completion, record, sizeof(completion));
+		uint64_t sum = 0;
+		memcpy(&sum, static_cast<const uint8_t*>(record) + sizeof(completion), sizeof(sum));
+		DJT_CHECK_EQ(completion.user_data, 100);
+		DJT_CHECK_EQ(completion.result.result, kIOReturnSuccess);
+		DJT_CHECK_EQ(sum, 30);
+		djt_spsc_ring_consume(&completions);
+		
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_OK);
+		memcpy(&completion, record, sizeof(completion));
+		test_point swapped = {};
+		memcpy(&swapped, static_cast<const uint8_t*>(record) + sizeof(completion), sizeof(swapped));
+		DJT_CHECK_EQ(completion.user_data, 101);
+		DJT_CHECK_EQ(completion.result.result, kIOReturnSuccess);
+		DJT_CHECK_EQ(swapped.x, 9);
+		DJT_CHECK_EQ(swapped.y, 8);
+		djt_spsc_ring_consume(&completions);
+		
+		// Wrong scalar count: the method table rejects it as for a direct call
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_OK);
+		memcpy(&completion, record, sizeof(completion));
+		DJT_CHECK_EQ(completion.user_data, 102);
+		DJT_CHECK_EQ(completion.result.result, kIOReturnBadArgument);
+		djt_spsc_ring_consume(&completions);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_EMPTY);
+		DJT_CHECK_EQ(context.dispatched, 3);
+		DJT_CHECK(!context.payload_shared);
+		
+		// The server has gone idle, so the next submission asks for the doorbell
+		DJT_CHECK_EQ(djt_iouc_ring_submit(&submissions, scratch, sizeof(scratch), 103, kTestUserClient_add, add_in, 2, nullptr, 0, 1, 0, &doorbell), DJT_SPSC_RING_OK);
+		DJT_CHECK(doorbell);
+		DJT_CHECK_EQ(djt_iouc_ring_drain(&server, ring_dispatch, &context, 16, &wake_client), DJT_SPSC_RING_EMPTY);
+		DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_OK);
+		djt_spsc_ring_consume(&completions);
+		
+		/* Hand-built records with struct sizes which would wrap if computed in
+		 * 32 bits, or which don't fit the scratch buffer: rejected without
+		 * dispatching. */
+		const uint32_t bad_sizes[] = { 0xffffffffu, 0xfffffff9u, 0xfffffff0u, capacity };
+		uint64_t user_data = 200;
+		for (uint32_t bad_size : bad_sizes)
+		{
+			for (int output = 0; output < 2; ++output)
+			{
+				djt_iouc_ring_submission submission = { user_data, { kTestUserClient_fill, 0, 0, 0, 0 } };
+				if (output)
+					submission.entry.struct_output_size = bad_size;
+				else
+					submission.entry.struct_input_size = bad_size;
+				DJT_CHECK_EQ(djt_spsc_ring_enqueue(&submissions, &submission, sizeof(submission), &doorbell), DJT_SPSC_RING_OK);
+				uint32_t dispatched = context.dispatched;
+				DJT_CHECK_EQ(djt_iouc_ring_drain(&server, ring_dispatch, &context, 16, &wake_client), DJT_SPSC_RING_EMPTY);
+				DJT_CHECK_EQ(context.dispatched, dispatched);
+				DJT_CHECK_EQ(djt_spsc_ring_peek(&completions, &record, &length), DJT_SPSC_RING_OK);
+				DJT_CHECK_EQ(length, sizeof(completion));
+				memcpy(&completion, record, sizeof(completion));
+				DJT_CHECK_EQ(completion.user_data, user_data);
+				DJT_CHECK_EQ(completion.result.result, DJT_IOUC_RING_RESULT_BAD_ARGUMENT);
+				djt_spsc_ring_consume(&completions);
+				++user_data;
+			}
+		}
+		
+		free(completion_memory);
+		free(submission_memory);
+	}
+	
+#ifdef DJT_IOUC_METRICS
+	struct metrics_export
+	{
+		uint64_t count;
+		size_t size;
+		djt_iouc_selector_metrics selectors[DJT_IOUC_METRICS_MAX_SELECTORS];
+	};
+	
+	void export_metrics(TestUserClient* client, metrics_export* metrics)
+	{
+		memset(metrics, 0xcc, sizeof(*metrics));
+		metrics->size = sizeof(metrics->selectors);
+		DJT_CHECK_EQ(call(client, kTestUserClient_metrics, nullptr, 0, nullptr, 0, &metrics->count, 1, metrics->selectors, &metrics->size), kIOReturnSuccess);
+	}
+	
+	/* The metrics are per class and never reset, so this checks the change
+	 * across a known set of calls. */
+	void test_metrics(TestUserClient* client)
+	{
+		static metrics_export before;
+		static metrics_export after;
+		export_metrics(client, &before);
+		// One slot per possible selector, indexed by selector, so too big to pass inline
+		DJT_CHECK(sizeof(before.selectors) > kDJTIOUCHostInbandStructMax);
+		DJT_CHECK_EQ(before.count, DJT_IOUC_METRICS_MAX_SELECTORS);
+		DJT_CHECK_EQ(before.size, sizeof(before.selectors));
+		
+		uint64_t in[2] = { 40, 2 };
+		uint64_t out[2] = {};
+		for (unsigned i = 0; i < 3; ++i)
+			DJT_CHECK_EQ(call(client, kTestUserClient_add, in, 2, nullptr, 0, out, 1), kIOReturnSuccess);
+		// Rejected by the argument checks before reaching the method: not recorded
+		DJT_CHECK_EQ(call(client, kTestUserClient_add, in, 1, nullptr, 0, out, 1), kIOReturnBadArgument);
+		
+		// Struct input inline and by descriptor
+		static uint8_t data[3 * kDJTIOUCHostInbandStructMax];
+		DJT_CHECK_EQ(call(client, kTestUserClient_checksum, nullptr, 0, data, 100, out, 2), kIOReturnSuccess);
+		DJT_CHECK_EQ(call(client, kTestUserClient_checksum, nullptr, 0, data, sizeof(data), out, 2), kIOReturnSuccess);
+		// Struct output inline and by descriptor
+		uint64_t value = 1;
+		size_t output_size = 64;
+		DJT_CHECK_EQ(call(client, kTestUserClient_fill, &value, 1, nullptr, 0, nullptr, 0, data, &output_size), kIOReturnSuccess);
+		output_size = sizeof(data);
+		DJT_CHECK_EQ(call(client, kTestUserClient_fill, &value, 1, nullptr, 0, nullptr, 0, data, &output_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(call(client, kTestUserClient_fail, nullptr, 0, nullptr, 0, nullptr, 0), kIOReturnError);
+		DJT_CHECK_EQ(call(client, kTestUserClient_fail, nullptr, 0, nullptr, 0, nullptr, 0), kIOReturnError);
+		
+		export_metrics(client, &after);
+		DJT_CHECK_EQ(after.count, DJT_IOUC_METRICS_MAX_SELECTORS);
+		DJT_CHECK_EQ(after.size, sizeof(after.selectors));
+		struct expected_change
+		{
+			uint32_t selector;
+			uint64_t calls;
+			uint64_t bytes_in;
+			uint64_t bytes_out;
+			uint64_t errors;
+		};
+		const expected_change expected[] = {
+			{ kTestUserClient_add, 3, 0, 0, 0 },
+			{ kTestUserClient_swap, 0, 0, 0, 0 },
+			{ kTestUserClient_checksum, 2, 100 + sizeof(data), 0, 0 },
+			{ kTestUserClient_fill, 2, 0, 64 + sizeof(data), 0 },
+			{ kTestUserClient_fail, 2, 0, 0, 2 },
+		};
+		for (const expected_change& change : expected)
+		{
+			const djt_iouc_selector_metrics* old_metrics = &before.selectors[change.selector];
+			const djt_iouc_selector_metrics* new_metrics = &after.selectors[change.selector];
+			DJT_CHECK_EQ(new_metrics->latency.num_samples_1 - old_metrics->latency.num_samples_1, change.calls);
+			DJT_CHECK_EQ(new_metrics->latency.num_samples_2 - old_metrics->latency.num_samples_2, change.calls);
+			DJT_CHECK_EQ(new_metrics->bytes_in - old_metrics->bytes_in, change.bytes_in);
+			DJT_CHECK_EQ(new_metrics->bytes_out - old_metrics->bytes_out, change.bytes_out);
+			DJT_CHECK_EQ(new_metrics->errors - old_metrics->errors, change.errors);
+			if (new_metrics->latency.num_samples_2 > 0)
+				DJT_CHECK(new_metrics->latency.min_ns <= new_metrics->latency.max_ns);
+		}
+		// Slots for selectors outside the method table stay in their initial state
+		const djt_iouc_selector_metrics* unused = &after.selectors[DJT_IOUC_METRICS_MAX_SELECTORS - 1];
+		DJT_CHECK_EQ(unused->latency.num_samples_2, 0);
+		DJT_CHECK_EQ(unused->latency.min_ns, UINT64_MAX);
+		DJT_CHECK_EQ(unused->bytes_in, 0);
+		
+		// A short buffer gets the leading whole slots only
+		size_t short_size = 2 * sizeof(djt_iouc_selector_metrics) + 8;
+		memset(&after, 0xcc, sizeof(after));
+		DJT_CHECK_EQ(call(client, kTestUserClient_metrics, nullptr, 0, nullptr, 0, &after.count, 1, after.selectors, &short_size), kIOReturnSuccess);
+		DJT_CHECK_EQ(after.count, DJT_IOUC_METRICS_MAX_SELECTORS);
+		DJT_CHECK_EQ(short_size, 2 * sizeof(djt_iouc_selector_metrics));
+		DJT_CHECK_EQ(after.selectors[kTestUserClient_add].latency.num_samples_2, before.selectors[kTestUserClient_add].latency.num_samples_2 + 3);
+		DJT_CHECK_EQ(after.selectors[2].bytes_in, 0xccccccccccccccccull);
+		// The scalar output carries the slot count
+		DJT_CHECK_EQ(call(client, kTestUserClient_metrics, nullptr, 0, nullptr, 0, nullptr, 0, after.selectors, &short_size), kIOReturnBadArgument);
+	}
+#else
+	void test_metrics(TestUserClient* client)
+	{
+		uint64_t count = 0;
+		djt_iouc_selector_metrics metrics[1];
+		size_t size = sizeof(metrics);
+		DJT_CHECK_EQ(call(client, kTestUserClient_metrics, nullptr, 0, nullptr, 0, &count, 1, metrics, &size), kIOReturnUnsupported);
+	}
+#endif
+}
+
+int main()
+{
+	TestUserClient* client = new TestUserClient();
+	test_metrics(client);
+	test_scalar(client);
+	test_fixed_struct(client);
+	test_variable_struct(client);
+	test_async(client);
+	test_wired(client);
+	test_sg(client);
+	test_batch(client);
+	test_batch_size_overflow(client);
+	test_ring(client);
+	DJT_CHECK_EQ(client->getRetainCount(), 1);
+	DJT_CHECK(test_trace_policy::begun > 0);
+	DJT_CHECK_EQ(test_trace_policy::ended, test_trace_policy::begun);
+	client->release();
+	return djt_test_report("userclient_dispatch_test");
+}
@@ -0,0 +1,342 @@
+/*
+Benchmark of DJTWorkStealingPool against a pool of the same size sharing one
+mutex-protected queue: a batch of small independent tasks submitted from
+outside, and recursive fork-join, where subtasks are submitted and waited on
+from inside tasks. Like DJTPoolWorkerContext::wait(), the shared queue pool
+runs queued tasks while waiting from inside a task, so both can join there.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+#include "DJTWorkStealingPool.hpp"
+#include "djt_bench.h"
+#include <pthread.h>
+
+namespace
+{
+	// The baseline: every submission and every worker goes through one lock.
+	class shared_queue_pool
+	{
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		DJTPoolTask* head;
+		DJTPoolTask* tail;
+		bool stopping;
+		pthread_t* threads;
+		unsigned thread_count;
+		
+		// Called with mutex held
+		DJTPoolTask* take()
+		{
+			DJTPoolTask* task = this->head;
+			if (task != nullptr)
+			{
+				this->head = task->next;
+				if (this->head == nullptr)
+					this->tail = nullptr;
+			}
+			return task;
+		}
+		
+		void run(DJTPoolTask* task)
+		{
+			DJTPoolTaskGroup* group = task->group;
+			task->function(task, this);
+			if (group != nullptr && __atomic_sub_fetch(&group->pending, 1, __ATOMIC_ACQ_REL) == 0)
+			{
+				pthread_mutex_lock(&this->mutex);
+				pthread_cond_broadcast(&this->cond);
+				pthread_mutex_unlock(&this->mutex);
+			}
+		}
+		
+		static void* workerMain(void* arg)
+		{
+			shared_queue_pool* pool = static_cast<shared_queue_pool*>(arg);
+			pthread_mutex_lock(&pool->mutex);
+			while (true)
+			{
+				DJTPoolTask* task = pool->take();
+				if (task != nullptr)
+				{
+					pthread_mutex_unlock(&pool->mutex);
+					pool->run(task);
+					pthread_mutex_lock(&pool->mutex);
+				}
+				else if (pool->stopping)
+					break;
+				else
+					pthread_cond_wait(&pool->cond, &pool->mutex);
+			}
+			pthread_mutex_unlock(&pool->mutex);
+			return nullptr;
+		}
+		
+	public:
+		shared_queue_pool() :
+			head(nullptr), tail(nullptr), stopping(false), threads(nullptr), thread_count(0)
+		{
+			pthread_mutex_init(&this->mutex, nullptr);
+			pthread_cond_init(&this->cond, nullptr);
+		}
+		~shared_queue_pool()
+		{
+			this->stop();
+			pthread_cond_destroy(&this->cond);
+			pthread_mutex_destroy(&this->mutex);
+		}
+		
+		void start(unsigned count)
+		{
+			this->threads = new pthread_t[count];
+			this->thread_count = count;
+			for (unsigned i = 0; i < count; ++i)
+				pthread_create(&this->threads[i], nullptr, workerMain, this);
+		}
+		void stop()
+		{
+			if (this->threads == nullptr)
+				return;
+			pthread_mutex_lock(&this->mutex);
+			this->stopping = true;
+			pthread_cond_broadcast(&this->cond);
+			pthread_mutex_unlock(&this->mutex);
+			for (unsigned i = 0; i < this->thread_count; ++i)
+				pthread_join(this->threads[i], nullptr);
+			delete[] this->threads;
+			this->threads = nullptr;
+		}
+		
+		void submitBatch(DJTPoolTask* const tasks[], uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				if (tasks[i]->group != nullptr)
+					__atomic_fetch_add(&tasks[i]->group->pending, 1, __ATOMIC_RELAXED);
+			pthread_mutex_lock(&this->mutex);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				tasks[i]->next = nullptr;
+				if (this->tail != nullptr)
+					this->tail->next = tasks[i];
+				else
+					this->head = tasks[i];
+				this->tail = tasks[i];
+			}
+			if (count == 1)
+				pthread_cond_signal(&this->cond);
+			else
+				pthread_cond_broadcast(&this->cond);
+			pthread_mutex_unlock(&this->mutex);
+		}
+		void submit(DJTPoolTask* task)
+		{
+			this->submitBatch(&task, 1);
+		}
+		
+		// From outside the pool
+		void wait(DJTPoolTaskGroup* group)
+		{
+			pthread_mutex_lock(&this->mutex);
+			while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+				pthread_cond_wait(&this->cond, &this->mutex);
+			pthread_mutex_unlock(&this->mutex);
+		}
+		// From inside a task: runs queued tasks while the group is pending.
+		void waitInside(DJTPoolTaskGroup* group)
+		{
+			pthread_mutex_lock(&this->mutex);
+			while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+			{
+				DJTPoolTask* task = this->take();
+				if (task != nullptr)
+				{
+					pthread_mutex_unlock(&this->mutex);
+					this->run(task);
+					pthread_mutex_lock(&this->mutex);
+				}
+				else
+					pthread_cond_wait(&this->cond, &this->mutex);
+			}
+			pthread_mutex_unlock(&this->mutex);
+		}
+	};
+	
+	typedef DJTWorkStealingPool<> stealing_pool;
+	
+	// How a task submits and joins subtasks, given its context argument.
+	struct stealing_inside
+	{
+		static void submit(void* context, DJTPoolTask* task) { DJTPoolWorkerContext<>::fromContext(context)->submit(task); }
+		static void wait(void* context, DJTPoolTaskGroup* group) { DJTPoolWorkerContext<>::fromContext(context)->wait(group); }
+	};
+	struct shared_inside
+	{
+		static void submit(void* context, DJTPoolTask* task) { static_cast<shared_queue_pool*>(context)->submit(task); }
+		static void wait(void* context, DJTPoolTaskGroup* group) { static_cast<shared_queue_pool*>(context)->waitInside(group); }
+	};
+	
+	// A little arithmetic, so tasks aren't entirely scheduling overhead.
+	uint64_t work(uint64_t seed, unsigned rounds)
+	{
+		for (unsigned i = 0; i < rounds; ++i)
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		return seed;
+	}
+	
+	struct leaf_task : DJTPoolTask
+	{
+		uint64_t result;
+	};
+	
+	void leaf_task_run(DJTPoolTask* task, void*)
+	{
+		leaf_task* leaf = static_cast<leaf_task*>(task);
+		leaf->result = work(leaf->result, 64);
+	}
+	
+	template <typename POOL> void bench_batch(const char* name, POOL* pool, uint32_t batch_size, uint64_t tasks)
+	{
+		leaf_task* leaves = new leaf_task[batch_size];
+		DJTPoolTask** pointers = new DJTPoolTask*[batch_size];
+		uint64_t rounds = tasks / batch_size > 0 ? tasks / batch_size : 1;
+		djt_bench_run(name, rounds, [&](uint64_t round) {
+			DJTPoolTaskGroup group = {};
+			for (uint32_t i = 0; i < batch_size; ++i)
+			{
+				leaves[i].function = leaf_task_run;
+				leaves[i].group = &group;
+				leaves[i].result = round + i;
+				pointers[i] = &leaves[i];
+			}
+			pool->submitBatch(pointers, batch_size);
+			pool->wait(&group);
+		}, batch_size);
+		delete[] pointers;
+		delete[] leaves;
+	}
+	
+	struct tree_task : DJTPoolTask
+	{
+		unsigned depth;
+		uint64_t result;
+	};
+	
+	template <typename INSIDE> void tree_task_run(DJTPoolTask* task, void* context)
+	{
+		tree_task* node = static_cast<tree_task*>(task);
+		if (node->depth == 0)
+		{
+			node->result = work(node->result, 64);
+			return;
+		}
+		DJTPoolTaskGroup group = {};
+		tree_task children[2];
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			children[i].function = tree_task_run<INSIDE>;
+			children[i].group = &group;
+			children[i].depth = node->depth - 1;
+			children[i].result = node->result * 2 + i;
+			INSIDE::submit(context, &children[i]);
+		}
+		INSIDE::wait(context, &group);
+		node->result = children[0].result ^ children[1].result;
+	}
+	
+	// Operations are leaf tasks; each tree also has as many inner tasks.
+	template <typename POOL, typename INSIDE> void bench_tree(const char* name, POOL* pool, unsigned depth, uint64_t tasks)
+	{
+		uint64_t leaves = 1ull << depth;
+		uint64_t rounds = tasks / leaves > 0 ? tasks / leaves : 1;
+		djt_bench_run(name, rounds, [&](uint64_t round) {
+			DJTPoolTaskGroup group = {};
+			tree_task root;
+			root.function = tree_task_run<INSIDE>;
+			root.group = &group;
+			root.depth = depth;
+			root.result = round;
+			pool->submit(&root);
+			pool->wait(&group);
+		}, leaves);
+	}
+	
+	void bench_pools(unsigned workers, uint64_t tasks)
+	{
+		char name[80];
+		stealing_pool stealing;
+		stealing.start(workers);
+		shared_queue_pool shared;
+		shared.start(workers);
+		
+		const uint32_t batch_sizes[] = { 16, 1024 };
+		for (uint32_t batch_size : batch_sizes)
+		{
+			snprintf(name, sizeof(name), "work stealing, %u workers: submitBatch of %u + wait", workers, batch_size);
+			bench_batch(name, &stealing, batch_size, tasks);
+			snprintf(name, sizeof(name), "shared queue, %u workers: submitBatch of %u + wait", workers, batch_size);
+			bench_batch(name, &shared, batch_size, tasks);
+		}
+		
+		const unsigned depth = 10;
+		snprintf(name, sizeof(name), "work stealing, %u workers: fork-join tree of depth %u", workers, depth);
+		bench_tree<stealing_pool, stealing_inside>(name, &stealing, depth, tasks);
+		snprintf(name, sizeof(name), "shared queue, %u workers: fork-join tree of depth %u", workers, depth);
+		bench_tree<shared_queue_pool, shared_inside>(name, &shared, depth, tasks);
+		
+		stealing.stop();
+		shared.stop();
+	}
+}
+
+// Optional argument: tasks per measurement.
+int main(int argc, char** argv)
+{
+	uint64_t tasks = djt_bench_iterations(argc, argv, 1u << 20);
+	bench_pools(1, tasks);
+	bench_pools(4, tasks);
+	return 0;
+}
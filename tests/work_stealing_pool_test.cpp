@@ -0,0 +1,295 @@
+/*
+Tests for DJTWorkStealingPool on the pthread platform: recursive fork-join
+with task groups waited on from inside tasks, submitBatch() from outside the
+pool, stealing from a worker whose deque holds all the work, and stop() with
+tasks (and the subtasks they spawn) still queued.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+#include "DJTWorkStealingPool.hpp"
+#include "djt_bench.h"
+#include "djt_test.h"
+#include <sched.h>
+
+namespace
+{
+	typedef DJTWorkStealingPool<> test_pool;
+	typedef DJTPoolWorkerContext<> test_context;
+	
+	const uint32_t WORKER_COUNT = 4;
+	
+	void test_start_arguments()
+	{
+		test_pool pool;
+		DJT_CHECK(!pool.start(0));
+		DJT_CHECK(!pool.start(2, 100));
+		DJT_CHECK(pool.start(2, 16));
+		DJT_CHECK_EQ(pool.workerCount(), 2);
+		pool.stop();
+		DJT_CHECK_EQ(pool.workerCount(), 0);
+		// Stopping again is harmless
+		pool.stop();
+	}
+	
+	// Splits until depth 0, waiting for both halves from inside the task.
+	struct tree_task : DJTPoolTask
+	{
+		unsigned depth;
+		uint64_t leaves;
+	};
+	
+	void tree_task_run(DJTPoolTask* task, void* context)
+	{
+		tree_task* node = static_cast<tree_task*>(task);
+		if (node->depth == 0)
+		{
+			node->leaves = 1;
+			return;
+		}
+		DJTPoolTaskGroup group = {};
+		tree_task children[2];
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			children[i].function = tree_task_run;
+			children[i].group = &group;
+			children[i].next = nullptr;
+			children[i].depth = node->depth - 1;
+			children[i].leaves = 0;
+			test_context::fromContext(context)->submit(&children[i]);
+		}
+		test_context::fromContext(context)->wait(&group);
+		DJT_CHECK_EQ(group.pending, 0);
+		node->leaves = children[0].leaves + children[1].leaves;
+	}
+	
+	void test_nested_groups(unsigned depth)
+	{
+		test_pool pool;
+		DJT_CHECK(pool.start(WORKER_COUNT));
+		for (unsigned round = 0; round < 4; ++round)
+		{
+			DJTPoolTaskGroup group = {};
+			tree_task root;
+			root.function = tree_task_run;
+			root.group = &group;
+			root.next = nullptr;
+			root.depth = depth;
+			root.leaves = 0;
+			pool.submit(&root);
+			pool.wait(&group);
+			DJT_CHECK_EQ(group.pending, 0);
+			DJT_CHECK_EQ(root.leaves, 1ull << depth);
+		}
+		pool.stop();
+	}
+	
+	struct counted_task : DJTPoolTask
+	{
+		uint32_t runs;
+		// Submitted from inside this task, if set
+		counted_task* child;
+	};
+	
+	void counted_task_run(DJTPoolTask* task, void* context)
+	{
+		counted_task* counted = static_cast<counted_task*>(task);
+		__atomic_fetch_add(&counted->runs, 1, __ATOMIC_RELAXED);
+		if (counted->child != nullptr)
+			test_context::fromContext(context)->submit(counted->child);
+	}
+	
+	void init_counted_tasks(counted_task* tasks, DJTPoolTask** pointers, uint32_t count, DJTPoolTaskGroup* group)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			tasks[i].function = counted_task_run;
+			tasks[i].group = group;
+			tasks[i].next = nullptr;
+			tasks[i].runs = 0;
+			tasks[i].child = nullptr;
+			if (pointers != nullptr)
+				pointers[i] = &tasks[i];
+		}
+	}
+	
+	// Batches of varying size, including ones larger than a deque.
+	void test_submit_batch()
+	{
+		test_pool pool;
+		DJT_CHECK(pool.start(WORKER_COUNT, 16));
+		const uint32_t max_batch = 1000;
+		counted_task* tasks = new counted_task[max_batch];
+		DJTPoolTask** pointers = new DJTPoolTask*[max_batch];
+		const uint32_t batch_sizes[] = { 0, 1, 3, 16, 17, 256, max_batch };
+		for (uint32_t batch_size : batch_sizes)
+		{
+			DJTPoolTaskGroup group = {};
+			init_counted_tasks(tasks, pointers, batch_size, &group);
+			pool.submitBatch(pointers, batch_size);
+			pool.wait(&group);
+			DJT_CHECK_EQ(group.pending, 0);
+			uint32_t wrong_counts = 0;
+			for (uint32_t i = 0; i < batch_size; ++i)
+				if (__atomic_load_n(&tasks[i].runs, __ATOMIC_RELAXED) != 1)
+					++wrong_counts;
+			DJT_CHECK_EQ(wrong_counts, 0);
+		}
+		delete[] pointers;
+		delete[] tasks;
+		pool.stop();
+	}
+	
+	/* One task pushes all the work onto its own worker's deque. Children run by
+	 * that worker hold it up until some other worker has stolen a child, so
+	 * the test only passes if stealing happens. */
+	struct imbalance_state
+	{
+		uint32_t owner;
+		uint32_t stolen;
+		uint32_t completed;
+		uint64_t deadline_ns;
+	};
+	
+	struct imbalance_task : DJTPoolTask
+	{
+		imbalance_state* state;
+	};
+	
+	void imbalance_child_run(DJTPoolTask* task, void* context)
+	{
+		imbalance_state* state = static_cast<imbalance_task*>(task)->state;
+		if (test_context::fromContext(context)->workerIndex() != state->owner)
+			__atomic_fetch_add(&state->stolen, 1, __ATOMIC_RELAXED);
+		else
+			while (__atomic_load_n(&state->stolen, __ATOMIC_RELAXED) == 0 && djt_bench_now_ns() < state->deadline_ns)
+				sched_yield();
+		__atomic_fetch_add(&state->completed, 1, __ATOMIC_RELAXED);
+	}
+	
+	const uint32_t IMBALANCE_CHILDREN = 64;
+	
+	void imbalance_root_run(DJTPoolTask* task, void* context)
+	{
+		imbalance_state* state = static_cast<imbalance_task*>(task)->state;
+		test_context* worker = test_context::fromContext(context);
+		state->owner = worker->workerIndex();
+		DJTPoolTaskGroup group = {};
+		imbalance_task children[IMBALANCE_CHILDREN];
+		for (uint32_t i = 0; i < IMBALANCE_CHILDREN; ++i)
+		{
+			children[i].function = imbalance_child_run;
+			children[i].group = &group;
+			children[i].next = nullptr;
+			children[i].state = state;
+			worker->submit(&children[i]);
+		}
+		worker->wait(&group);
+	}
+	
+	void test_stealing()
+	{
+		test_pool pool;
+		DJT_CHECK(pool.start(WORKER_COUNT));
+		imbalance_state state = {};
+		state.deadline_ns = djt_bench_now_ns() + 10000000000ull;
+		DJTPoolTaskGroup group = {};
+		imbalance_task root;
+		root.function = imbalance_root_run;
+		root.group = &group;
+		root.next = nullptr;
+		root.state = &state;
+		pool.submit(&root);
+		pool.wait(&group);
+		DJT_CHECK_EQ(state.completed, IMBALANCE_CHILDREN);
+		DJT_CHECK(state.stolen > 0);
+		pool.stop();
+	}
+	
+	/* stop() runs everything already queued, including subtasks submitted by
+	 * tasks that are still running, before the workers exit. */
+	void test_stop_with_queued_work()
+	{
+		const uint32_t count = 500;
+		counted_task* tasks = new counted_task[count];
+		counted_task* children = new counted_task[count];
+		DJTPoolTask** pointers = new DJTPoolTask*[count];
+		for (unsigned round = 0; round < 10; ++round)
+		{
+			init_counted_tasks(tasks, pointers, count, nullptr);
+			init_counted_tasks(children, nullptr, count, nullptr);
+			for (uint32_t i = 0; i < count; ++i)
+				tasks[i].child = &children[i];
+			
+			test_pool pool;
+			DJT_CHECK(pool.start(WORKER_COUNT, 8));
+			pool.submitBatch(pointers, count);
+			pool.stop();
+			
+			uint32_t wrong_counts = 0;
+			for (uint32_t i = 0; i < count; ++i)
+				if (tasks[i].runs != 1 || children[i].runs != 1)
+					++wrong_counts;
+			DJT_CHECK_EQ(wrong_counts, 0);
+		}
+		delete[] pointers;
+		delete[] children;
+		delete[] tasks;
+	}
+}
+
+// Optional argument: depth of the fork-join tree.
+int main(int argc, char** argv)
+{
+	unsigned depth = (unsigned)djt_bench_iterations(argc, argv, 14);
+	test_start_arguments();
+	test_nested_groups(depth);
+	test_submit_batch();
+	test_stealing();
+	test_stop_with_queued_work();
+	return djt_test_report("work_stealing_pool_test");
+}
@@ -51,12 +51,230 @@ misrepresented as being the original software.
 
 #pragma once
 
+#if __cplusplus < 201103L
+#error userclient.hpp requires C++11 or later
+#endif
+
+#ifdef DJT_IOUC_HOST
+#include "djt_iouc_host.h"
+#else
 #include <IOKit/IOReturn.h>
 #include <libkern/c++/OSObject.h>
+#include <kern/task.h>
+#endif
 #include <stdint.h>
 #include <sys/types.h>
+#include "djt_iouc_batch.h"
+#include "djt_iouc_selectors.h"
+#include "djt_iouc_sg.h"
+#include "profiling.h"
 
 class IOMemoryMap;
+class IOMemoryDescriptor;
+
+/* Method parameter type for a variable sized struct input which is handed to
+ * the method as a prepared (wired) memory descriptor rather than mapped into
+ * the kernel, e.g. for programming DMA straight from the client's pages. The
+ * descriptor is only valid, and only wired, for the duration of the call, and
+ * is null if the client passed no struct input. Takes the place of the
+ * method's one struct input. */
+struct djt_iouc_wired_input
+{
+	IOMemoryDescriptor* descriptor;
+	size_t length;
+};
+
+/* Method parameter type for a scatter-gather struct input (see djt_iouc_sg.h):
+ * the inline data, if any, followed by one segment per range, each mapped
+ * read-only from the calling task for the duration of the call. Segments are
+ * not coalesced. Takes the place of the method's one struct input; a method
+ * called with no struct input at all sees zero segments. */
+struct djt_iouc_sg_segment
+{
+	const void* address;
+	size_t length;
+};
+
+struct djt_iouc_sg_input
+{
+	const djt_iouc_sg_segment* segments;
+	uint32_t count;
+	size_t length; // total over all segments
+};
+
+/* Tracing policy for the userclient_method dispatch path. By default, dispatch
+ * is silent and the hooks compile away entirely. Define DJT_IOUC_TRACE before
+ * including this header to record a djt_iouc_trace_record (selector, argument
+ * sizes, result, latency) per call into a ring buffer, without any string
+ * formatting on the hot path; link userclient_trace.cpp and export the buffer
+ * to user space with djt_iouc_trace_export(). Alternatively, define
+ * DJT_IOUC_TRACE_POLICY to a type of your own with the same static members as
+ * djt_iouc_trace_none. */
+struct djt_iouc_trace_none
+{
+	typedef int token;
+	static token begin(const IOExternalMethodArguments*) { return 0; }
+	static void end(token, const IOExternalMethodArguments*, IOReturn) {}
+	static void struct_mapping_failed(token&, bool) {}
+};
+
+struct djt_iouc_trace_record
+{
+	// 0 while the slot is being written
+	uint64_t sequence;
+	uint64_t latency_ns;
+	uint32_t selector;
+	IOReturn result;
+	uint32_t scalar_input_count;
+	uint32_t scalar_output_count;
+	uint32_t struct_input_size;
+	uint32_t struct_output_size;
+	// Bit 0: struct input mapping failed, bit 1: struct output mapping failed
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+#define DJT_IOUC_TRACE_RING_SIZE 256u
+
+struct djt_iouc_trace_ring
+{
+	uint64_t next_sequence;
+	djt_iouc_trace_record records[DJT_IOUC_TRACE_RING_SIZE];
+};
+
+#ifdef DJT_IOUC_TRACE
+#include <kern/clock.h>
+
+// Defined in userclient_trace.cpp
+extern djt_iouc_trace_ring djt_iouc_trace_buffer;
+
+struct djt_iouc_trace_records
+{
+	struct token
+	{
+		uint64_t start_abs;
+		uint32_t flags;
+	};
+	static token begin(const IOExternalMethodArguments*)
+	{
+		token start = { mach_absolute_time(), 0 };
+		return start;
+	}
+	static void end(token start, const IOExternalMethodArguments* arguments, IOReturn result)
+	{
+		uint64_t latency_abs = mach_absolute_time() - start.start_abs;
+		uint64_t sequence = __atomic_add_fetch(&djt_iouc_trace_buffer.next_sequence, 1, __ATOMIC_RELAXED);
+		djt_iouc_trace_record* record = &djt_iouc_trace_buffer.records[(sequence - 1) % DJT_IOUC_TRACE_RING_SIZE];
+		__atomic_store_n(&record->sequence, 0, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		// Converted to nanoseconds on export
+		record->latency_ns = latency_abs;
+		record->selector = arguments->selector;
+		record->result = result;
+		record->scalar_input_count = arguments->scalarInputCount;
+		record->scalar_output_count = arguments->scalarOutputCount;
+		record->struct_input_size = arguments->structureInputSize;
+		record->struct_output_size = arguments->structureOutputSize;
+		record->flags = start.flags;
+		__atomic_store_n(&record->sequence, sequence, __ATOMIC_RELEASE);
+	}
+	static void struct_mapping_failed(token& trace, bool output)
+	{
+		trace.flags |= output ? 2u : 1u;
+	}
+};
+#endif
+
+#ifndef DJT_IOUC_TRACE_POLICY
+#ifdef DJT_IOUC_TRACE
+#define DJT_IOUC_TRACE_POLICY djt_iouc_trace_records
+#else
+#define DJT_IOUC_TRACE_POLICY djt_iouc_trace_none
+#endif
+#endif
+
+/* Metrics policy: per user client class and selector call counts, latency
+ * statistics (a dj_profile_probe, see profiling.h), bytes in and out and error
+ * counts, without instrumenting the methods themselves. The counters are
+ * static, so they're shared by all instances (i.e. all open connections) of a
+ * user client class and kept until the kext unloads. Off by default; define
+ * DJT_IOUC_METRICS (and DJ_PROFILE_ENABLE, linking profiling.cpp) before
+ * including this header to enable it, or DJT_IOUC_METRICS_POLICY to a type of
+ * your own with the same members as djt_iouc_metrics_none. Selectors are the
+ * method table indices; those from DJT_IOUC_METRICS_MAX_SELECTORS upwards are
+ * not recorded. Put djt_iouc_metrics_export<YourUserClient>::dispatch in the
+ * method table to let user space read them. */
+#define DJT_IOUC_METRICS_MAX_SELECTORS 64u
+
+struct djt_iouc_selector_metrics
+{
+	dj_profile_probe_t latency; // num_samples_2 is the number of calls
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t errors;
+};
+
+struct djt_iouc_metrics_none
+{
+	typedef int token;
+	template <class UCC> static token begin(const IOExternalMethodArguments*) { return 0; }
+	template <class UCC> static void end(token, const IOExternalMethodArguments*, IOReturn) {}
+};
+
+#ifdef DJT_IOUC_METRICS
+#ifndef DJ_PROFILE_ENABLE
+#error DJT_IOUC_METRICS requires DJ_PROFILE_ENABLE
+#endif
+
+template <class UCC> struct djt_iouc_metrics_table
+{
+	struct slot
+	{
+		djt_iouc_selector_metrics metrics = { DJ_PROFILE_PROBE_INIT, 0, 0, 0 };
+	};
+	static slot slots[DJT_IOUC_METRICS_MAX_SELECTORS];
+};
+template <class UCC> typename djt_iouc_metrics_table<UCC>::slot djt_iouc_metrics_table<UCC>::slots[DJT_IOUC_METRICS_MAX_SELECTORS];
+
+struct djt_iouc_metrics_probes
+{
+	typedef uint64_t token;
+	template <class UCC> static token begin(const IOExternalMethodArguments*)
+	{
+		return dj_absolute_nanoseconds();
+	}
+	template <class UCC> static void end(token start_ns, const IOExternalMethodArguments* arguments, IOReturn result)
+	{
+		uint64_t end_ns = dj_absolute_nanoseconds();
+		if (arguments->selector >= DJT_IOUC_METRICS_MAX_SELECTORS)
+			return;
+		djt_iouc_selector_metrics* metrics = &djt_iouc_metrics_table<UCC>::slots[arguments->selector].metrics;
+		uint64_t bytes_in = arguments->structureInputSize;
+		if (bytes_in == 0 && arguments->structureInputDescriptor != nullptr)
+			bytes_in = arguments->structureInputDescriptor->getLength();
+		__atomic_add_fetch(&metrics->bytes_in, bytes_in, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&metrics->bytes_out, arguments->structureOutputSize, __ATOMIC_RELAXED);
+		if (result != kIOReturnSuccess)
+			__atomic_add_fetch(&metrics->errors, 1, __ATOMIC_RELAXED);
+		dj_profile_sample(&metrics->latency, start_ns, end_ns);
+	}
+};
+#endif
+
+#ifndef DJT_IOUC_METRICS_POLICY
+#ifdef DJT_IOUC_METRICS
+#define DJT_IOUC_METRICS_POLICY djt_iouc_metrics_probes
+#else
+#define DJT_IOUC_METRICS_POLICY djt_iouc_metrics_none
+#endif
+#endif
+
+/* External IOUserClient method implementation exporting the trace ring: expects
+ * 1 scalar output (number of records written so far) and a variable sized
+ * struct output for up to DJT_IOUC_TRACE_RING_SIZE djt_iouc_trace_record
+ * structs, oldest first. Returns kIOReturnUnsupported unless built with
+ * DJT_IOUC_TRACE. */
+IOReturn djt_iouc_trace_export(IOExternalMethodArguments* arguments);
 
 /* I don't like casting function pointers, it's fragile as accidental prototype
  * changes are not caught. External methods are expected to be of type
@@ -71,20 +289,19 @@ class IOMemoryMap;
  */
 namespace
 {
-	IOReturn map_struct_arguments(IOMemoryMap*& in_map, IOMemoryMap*& out_map, IOExternalMethodArguments* arguments)
+	IOReturn map_struct_arguments(IOMemoryMap*& in_map, IOMemoryMap*& out_map, IOExternalMethodArguments* arguments, DJT_IOUC_TRACE_POLICY::token& trace, bool map_input = true)
 	{
-				if (arguments->structureInputSize == 0 && arguments->structureInputDescriptor != nullptr)
+				if (map_input && arguments->structureInputSize == 0 && arguments->structureInputDescriptor != nullptr)
 				{
 					in_map = arguments->structureInputDescriptor->createMappingInTask(kernel_task, 0, kIOMapAnywhere | kIOMapReadOnly);
 					if (in_map != nullptr)
 					{
 						arguments->structureInputSize = static_cast<uint32_t>(in_map->getLength());
 						arguments->structureInput = reinterpret_cast<const void*>(in_map->getAddress());
-						kprintf("mapped struct input at %p, %u\n", arguments->structureInput, arguments->structureInputSize);
 					}
 					else
 					{
-						kprintf("mapping struct input failed\n");
+						DJT_IOUC_TRACE_POLICY::struct_mapping_failed(trace, false);
 					}
 				}
 				if (arguments->structureOutputSize == 0 && arguments->structureOutputDescriptor != nullptr)
@@ -94,16 +311,218 @@ namespace
 					{
 						arguments->structureOutputSize = static_cast<uint32_t>(out_map->getLength());
 						arguments->structureOutput = reinterpret_cast<void*>(out_map->getAddress());
-						kprintf("mapped struct output at %p, %u\n", arguments->structureOutput, arguments->structureOutputSize);
 					}
 					else
 					{
-						kprintf("mapping struct output failed");
+						DJT_IOUC_TRACE_POLICY::struct_mapping_failed(trace, true);
 					}
 				}
 		return kIOReturnSuccess;
 	}
+	IOReturn map_struct_arguments(IOMemoryMap*& in_map, IOMemoryMap*& out_map, IOExternalMethodArguments* arguments)
+	{
+		DJT_IOUC_TRACE_POLICY::token trace = DJT_IOUC_TRACE_POLICY::token();
+		return map_struct_arguments(in_map, out_map, arguments, trace);
+	}
+	
+	/* Standard selector exporting UCC's djt_iouc_selector_metrics, for the
+	 * class as a whole rather than the connection it's called on: 1 scalar
+	 * output (DJT_IOUC_METRICS_MAX_SELECTORS) and a variable sized struct output
+	 * for up to that many djt_iouc_selector_metrics, indexed by selector.
+	 * Latency probes are snapshotted as by dj_profile_iouc_export(). Returns
+	 * kIOReturnUnsupported unless built with DJT_IOUC_METRICS. */
+	template <class UCC> struct djt_iouc_metrics_export
+	{
+		static IOReturn export_method(OSObject*, void*, IOExternalMethodArguments* arguments)
+		{
+#ifdef DJT_IOUC_METRICS
+			IOMemoryMap* in_map = nullptr;
+			IOMemoryMap* out_map = nullptr;
+			map_struct_arguments(in_map, out_map, arguments);
+			IOReturn result = kIOReturnSuccess;
+			if (arguments->scalarOutputCount != 1
+			    || (arguments->structureOutputSize > 0 && arguments->structureOutput == nullptr))
+			{
+				result = kIOReturnBadArgument;
+			}
+			else
+			{
+				arguments->scalarOutput[0] = DJT_IOUC_METRICS_MAX_SELECTORS;
+				uint32_t count = arguments->structureOutputSize / sizeof(djt_iouc_selector_metrics);
+				if (count > DJT_IOUC_METRICS_MAX_SELECTORS)
+					count = DJT_IOUC_METRICS_MAX_SELECTORS;
+				djt_iouc_selector_metrics* export_metrics = static_cast<djt_iouc_selector_metrics*>(arguments->structureOutput);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const djt_iouc_selector_metrics* metrics = &djt_iouc_metrics_table<UCC>::slots[i].metrics;
+					djt_iouc_selector_metrics copy = {};
+					dj_profile_probe_snapshot(&metrics->latency, &copy.latency);
+					copy.bytes_in = __atomic_load_n(&metrics->bytes_in, __ATOMIC_RELAXED);
+					copy.bytes_out = __atomic_load_n(&metrics->bytes_out, __ATOMIC_RELAXED);
+					copy.errors = __atomic_load_n(&metrics->errors, __ATOMIC_RELAXED);
+					memcpy(&export_metrics[i], &copy, sizeof(copy));
+				}
+				arguments->structureOutputSize = count * static_cast<uint32_t>(sizeof(djt_iouc_selector_metrics));
+			}
+			OSSafeReleaseNULL(in_map);
+			OSSafeReleaseNULL(out_map);
+			return result;
+#else
+			(void)arguments;
+			return kIOReturnUnsupported;
+#endif
+		}
+		
+		constexpr static const IOExternalMethodDispatch dispatch = {
+			export_method,
+			0,
+			0,
+			1,
+			kIOUCVariableStructureSize
+		};
+	};
 
+	
+	/* For methods taking a djt_iouc_wired_input: instead of mapping the struct
+	 * input into the kernel, wire it with prepare() and leave the descriptor in
+	 * arguments->structureInputDescriptor. Inline struct inputs, which the
+	 * kernel has already copied in, are wrapped in a descriptor, 'created'. */
+	IOReturn prepare_wired_struct_input(IOExternalMethodArguments* arguments, IOMemoryDescriptor*& created)
+	{
+		created = nullptr;
+		IOMemoryDescriptor* descriptor = arguments->structureInputDescriptor;
+		if (descriptor == nullptr)
+		{
+			if (arguments->structureInput == nullptr || arguments->structureInputSize == 0)
+				return kIOReturnSuccess; // no struct input at all
+			created = IOMemoryDescriptor::withAddress(const_cast<void*>(arguments->structureInput), arguments->structureInputSize, kIODirectionOut);
+			if (created == nullptr)
+				return kIOReturnNoMemory;
+			descriptor = created;
+		}
+		IOReturn result = descriptor->prepare(kIODirectionOut);
+		if (result != kIOReturnSuccess)
+		{
+			OSSafeReleaseNULL(created);
+			return result;
+		}
+		arguments->structureInputDescriptor = descriptor;
+		return kIOReturnSuccess;
+	}
+	void complete_wired_struct_input(IOExternalMethodArguments* arguments, IOMemoryDescriptor*& created)
+	{
+		if (arguments->structureInputDescriptor != nullptr)
+			arguments->structureInputDescriptor->complete(kIODirectionOut);
+		if (created != nullptr)
+		{
+			arguments->structureInputDescriptor = nullptr;
+			OSSafeReleaseNULL(created);
+		}
+	}
+
+	/* Per-call state for methods taking a djt_iouc_sg_input, on the
+	 * dispatcher's stack: the only allocations are the range mappings.
+	 * map() parses the (already mapped) struct input as a segment table, maps
+	 * each range from the calling task, and points arguments->structureInput at
+	 * 'input' for arg_sel_sg_struct_input; unmap() undoes all of that. */
+	struct sg_struct_input
+	{
+		djt_iouc_sg_segment segments[DJT_IOUC_SG_MAX_RANGES + 1];
+		IOMemoryMap* maps[DJT_IOUC_SG_MAX_RANGES];
+		uint32_t map_count;
+		djt_iouc_sg_input input;
+		const void* table;
+		
+		IOReturn map(IOExternalMethodArguments* arguments)
+		{
+			this->map_count = 0;
+			this->input.segments = this->segments;
+			this->input.count = 0;
+			this->input.length = 0;
+			this->table = arguments->structureInput;
+			IOReturn result = this->map_segments(arguments);
+			if (result != kIOReturnSuccess)
+			{
+				this->unmap(arguments);
+				return result;
+			}
+			arguments->structureInput = &this->input;
+			return kIOReturnSuccess;
+		}
+		
+		void unmap(IOExternalMethodArguments* arguments)
+		{
+			for (uint32_t i = 0; i < this->map_count; ++i)
+				OSSafeReleaseNULL(this->maps[i]);
+			this->map_count = 0;
+			arguments->structureInput = this->table;
+		}
+		
+	private:
+		IOReturn map_segments(const IOExternalMethodArguments* arguments)
+		{
+			const char* table = static_cast<const char*>(arguments->structureInput);
+			uint32_t table_size = arguments->structureInputSize;
+			if (table == nullptr || table_size == 0)
+				return kIOReturnSuccess;
+			
+			djt_iouc_sg_header header;
+			if (table_size < sizeof(header))
+				return kIOReturnBadArgument;
+			memcpy(&header, table, sizeof(header));
+			if (header.range_count > DJT_IOUC_SG_MAX_RANGES || djt_iouc_sg_size(header.range_count, header.inline_size) != table_size)
+				return kIOReturnBadArgument;
+			
+			const char* ranges = table + sizeof(header);
+			if (header.inline_size > 0)
+			{
+				djt_iouc_sg_segment segment = { ranges + sizeof(djt_iouc_sg_range) * header.range_count, header.inline_size };
+				this->segments[this->input.count++] = segment;
+				this->input.length += header.inline_size;
+			}
+			if (header.range_count == 0)
+				return kIOReturnSuccess;
+			
+			// Ranges refer to the client's address space, so there must be a client on the other end
+			task_t task = current_task();
+			if (task == kernel_task)
+				return kIOReturnNotPermitted;
+			for (uint32_t i = 0; i < header.range_count; ++i)
+			{
+				djt_iouc_sg_range range;
+				memcpy(&range, ranges + sizeof(range) * i, sizeof(range));
+				if (range.length == 0 || range.length > SIZE_MAX - this->input.length)
+					return kIOReturnBadArgument;
+				IOMemoryDescriptor* descriptor = IOMemoryDescriptor::withAddressRange(range.address, range.length, kIODirectionOut, task);
+				if (descriptor == nullptr)
+					return kIOReturnNoMemory;
+				IOMemoryMap* map = descriptor->createMappingInTask(kernel_task, 0, kIOMapAnywhere | kIOMapReadOnly);
+				OSSafeReleaseNULL(descriptor);
+				if (map == nullptr)
+					return kIOReturnBadArgument;
+				this->maps[this->map_count++] = map;
+				djt_iouc_sg_segment segment = { reinterpret_cast<const void*>(map->getAddress()), static_cast<size_t>(range.length) };
+				this->segments[this->input.count++] = segment;
+				this->input.length += segment.length;
+			}
+			return kIOReturnSuccess;
+		}
+	};
+	
+	struct no_sg_struct_input
+	{
+		IOReturn map(IOExternalMethodArguments*) { return kIOReturnSuccess; }
+		void unmap(IOExternalMethodArguments*) {}
+	};
+	
+	template <bool HAS_SG_INPUT> struct sg_struct_input_state
+	{
+		typedef no_sg_struct_input type;
+	};
+	template <> struct sg_struct_input_state<true>
+	{
+		typedef sg_struct_input type;
+	};
 
 	template <class UCC> struct userclient_external_methods
 	{
@@ -115,9 +534,15 @@ namespace
 				return kIOReturnBadArgument;
 			return (uc->*method)(reference, arguments);
 		}
+		// For tables only dispatched with a UCC target, see userclient_method::unchecked_external_method.
+		template <IOReturn (UCC::*method)(void* reference, IOExternalMethodArguments* arguments)>
+			static IOReturn unchecked_external_method(OSObject* target, void* reference, IOExternalMethodArguments* arguments)
+		{
+			assert(OSDynamicCast(UCC, target) != nullptr);
+			return (static_cast<UCC*>(target)->*method)(reference, arguments);
+		}
 	};
 	
-#if (__cplusplus >= 201103L) || __has_feature(cxx_variadic_templates)
 	template<typename... Args> struct scalar_input_arg_count;
 
 	// termination condition
@@ -150,6 +575,16 @@ namespace
 	struct scalar_input_arg_count<mach_port_t, io_user_reference_t*, uint32_t, Args...> {
 		static const int count = scalar_input_arg_count<Args...>::count;
 	};
+	// ignore wired struct input
+	template<typename... Args>
+	struct scalar_input_arg_count<djt_iouc_wired_input, Args...> {
+		static const int count = scalar_input_arg_count<Args...>::count;
+	};
+	// ignore scatter-gather struct input
+	template<typename... Args>
+	struct scalar_input_arg_count<djt_iouc_sg_input, Args...> {
+		static const int count = scalar_input_arg_count<Args...>::count;
+	};
 	// everything else must be a scalar input
 	template<typename T, typename... Args>
 	struct scalar_input_arg_count<T, Args...> {
@@ -172,6 +607,16 @@ namespace
 			static const int size = sizeof(T);
 			static_assert(size != 0,"zero-sized input structs not allowed");
 		};
+	template<typename... Args>
+	struct struct_input_arg_size<djt_iouc_wired_input, Args...> {
+		static_assert(struct_input_arg_size<Args...>::size == 0,"Only one struct input allowed.");
+			static const int size = kIOUCVariableStructureSize;
+	};
+	template<typename... Args>
+	struct struct_input_arg_size<djt_iouc_sg_input, Args...> {
+		static_assert(struct_input_arg_size<Args...>::size == 0,"Only one struct input allowed.");
+			static const int size = kIOUCVariableStructureSize;
+	};
 	template<typename T, typename... Args>
 	struct struct_input_arg_size<T, Args...> {
 			static const int size = struct_input_arg_size<Args...>::size;
@@ -251,7 +696,28 @@ namespace
 	template<typename T, typename... Args> struct is_async_method<T, Args...> {
 		static const bool value = is_async_method<Args...>::value;
 	};
-#endif
+	
+	template<typename... Args> struct has_wired_struct_input;
+	template<> struct has_wired_struct_input<> {
+		static const bool value = false;
+	};
+	template<typename... Args> struct has_wired_struct_input<djt_iouc_wired_input, Args...> {
+		static const bool value = true;
+	};
+	template<typename T, typename... Args> struct has_wired_struct_input<T, Args...> {
+		static const bool value = has_wired_struct_input<Args...>::value;
+	};
+	
+	template<typename... Args> struct has_sg_struct_input;
+	template<> struct has_sg_struct_input<> {
+		static const bool value = false;
+	};
+	template<typename... Args> struct has_sg_struct_input<djt_iouc_sg_input, Args...> {
+		static const bool value = true;
+	};
+	template<typename T, typename... Args> struct has_sg_struct_input<T, Args...> {
+		static const bool value = has_sg_struct_input<Args...>::value;
+	};
 
 	/* We want the wrapped function call to expand to something like this:
 	 * return (target->*METHOD)(
@@ -317,6 +783,29 @@ namespace
 			}
 		};
 	
+	struct arg_sel_wired_struct_input
+	{
+		typedef djt_iouc_wired_input type;
+		// prepare_wired_struct_input() has replaced any inline input with a descriptor
+		static djt_iouc_wired_input extract_argument(const IOExternalMethodArguments* arguments)
+		{
+			djt_iouc_wired_input input = { arguments->structureInputDescriptor, 0 };
+			if (input.descriptor != nullptr)
+				input.length = input.descriptor->getLength();
+			return input;
+		}
+	};
+	
+	struct arg_sel_sg_struct_input
+	{
+		typedef djt_iouc_sg_input type;
+		// sg_struct_input::map() has pointed structureInput at the parsed segment list
+		static djt_iouc_sg_input extract_argument(const IOExternalMethodArguments* arguments)
+		{
+			return *static_cast<const djt_iouc_sg_input*>(arguments->structureInput);
+		}
+	};
+	
 	struct arg_sel_variable_struct_input_size
 	{
 		typedef size_t type;
@@ -341,7 +830,6 @@ namespace
 		typedef void* type;
 		static void* extract_argument(const IOExternalMethodArguments* arguments)
 		{
-			kprintf("arg_sel_variable_struct_output_ptr: %p\n", arguments->structureOutput);
 			return arguments->structureOutput;
 		}
 	};
@@ -350,7 +838,6 @@ namespace
 		typedef size_t type;
 		static size_t extract_argument(const IOExternalMethodArguments* arguments)
 		{
-			kprintf("arg_sel_variable_struct_output_size: %u\n", arguments->structureOutputSize);
 			return arguments->structureOutputSize;
 		}
 	};
@@ -392,7 +879,6 @@ namespace
 	 * no remaining parameters.
 	 */
 
-#if __cplusplus >= 201103L || __has_feature(cxx_variadic_templates)
 	// dummy type that we only use for its type pack. (which will be a sequence of arg_sel types)
 	template <typename... ARGSELS> struct arg_seq
 	{};
@@ -437,6 +923,30 @@ namespace
 			>::seq seq;
 	};
 
+	// The recurrence relation for wired struct inputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, arg_seq<ARGSELS...>, djt_iouc_wired_input, REMAIN_ARGS...>
+	{
+		typedef typename arg_seq_accum<
+			NEXT_INPUT,
+			NEXT_OUTPUT,
+			arg_seq<ARGSELS..., arg_sel_wired_struct_input>, // create a new arg_sel and append it to the existing ones
+			REMAIN_ARGS... // Drop the wired input from parameters
+			>::seq seq;
+	};
+
+	// The recurrence relation for scatter-gather struct inputs
+	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
+		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, arg_seq<ARGSELS...>, djt_iouc_sg_input, REMAIN_ARGS...>
+	{
+		typedef typename arg_seq_accum<
+			NEXT_INPUT,
+			NEXT_OUTPUT,
+			arg_seq<ARGSELS..., arg_sel_sg_struct_input>, // create a new arg_sel and append it to the existing ones
+			REMAIN_ARGS... // Drop the scatter-gather input from parameters
+			>::seq seq;
+	};
+
 	// The recurrence relation for variable-sized struct outputs
 	template <int NEXT_INPUT, int NEXT_OUTPUT, typename... ARGSELS, typename... REMAIN_ARGS>
 		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, arg_seq<ARGSELS...>, void*, size_t, REMAIN_ARGS...>
@@ -508,22 +1018,47 @@ namespace
 		static constexpr const uint32_t struct_input_size = struct_input_arg_size<Args...>::size;
 		static constexpr const uint32_t struct_output_size = struct_output_arg_size<Args...>::size;
 		static constexpr const bool is_async = is_async_method<Args...>::value;
+		static constexpr const bool has_wired_input = has_wired_struct_input<Args...>::value;
+		static constexpr const bool has_sg_input = has_sg_struct_input<Args...>::value;
 		
 		template <typename... ARGSELS>
 			static IOReturn apply_fn(UCC* target, IOExternalMethodArguments* arguments, arg_seq<ARGSELS...>)
 			{
+				typename DJT_IOUC_METRICS_POLICY::token metrics = DJT_IOUC_METRICS_POLICY::template begin<UCC>(arguments);
+				DJT_IOUC_TRACE_POLICY::token trace = DJT_IOUC_TRACE_POLICY::begin(arguments);
 				IOMemoryMap* in_map = nullptr;
 				IOMemoryMap* out_map = nullptr;
-				IOReturn result = map_struct_arguments(in_map, out_map, arguments);
-				if (result != kIOReturnSuccess)
-					return result;
-				result = (target->*METHOD)(get_element<ARGSELS>(arguments) ...);
+				IOMemoryDescriptor* wired_created = nullptr;
+				bool wired_prepared = false;
+				IOReturn result = kIOReturnSuccess;
+				if (has_wired_input)
+				{
+					result = prepare_wired_struct_input(arguments, wired_created);
+					wired_prepared = (result == kIOReturnSuccess);
+				}
+				if (result == kIOReturnSuccess)
+					result = map_struct_arguments(in_map, out_map, arguments, trace, !has_wired_input);
+				if (result == kIOReturnSuccess)
+				{
+					typename sg_struct_input_state<has_sg_input>::type sg;
+					result = sg.map(arguments);
+					if (result == kIOReturnSuccess)
+					{
+						result = (target->*METHOD)(get_element<ARGSELS>(arguments) ...);
+						sg.unmap(arguments);
+					}
+				}
+				// Failures above end up here too, so the end hooks always run.
 				OSSafeReleaseNULL(in_map);
 				OSSafeReleaseNULL(out_map);
+				if (wired_prepared)
+					complete_wired_struct_input(arguments, wired_created);
+				DJT_IOUC_TRACE_POLICY::end(trace, arguments, result);
+				DJT_IOUC_METRICS_POLICY::template end<UCC>(metrics, arguments, result);
 				return result;
 			}
 	
-		static IOReturn external_method(OSObject* target, void* reference, IOExternalMethodArguments* arguments)
+		static IOReturn external_method(OSObject* target, void*, IOExternalMethodArguments* arguments)
 		{
 			UCC* uc = OSDynamicCast(UCC, target);
 			if (!uc)
@@ -533,7 +1068,18 @@ namespace
 			return apply_fn(uc, arguments, typename gen_arg_seq<Args...>::type());
 		}
 		
-#if __cplusplus >= 201103L
+		/* As external_method, but trusts that target is a UCC and downcasts
+		 * statically instead of walking the metaclass chain on every call. Only
+		 * reachable via fast_dispatch entries, see DJT_IOUC_FAST_METHOD. */
+		static IOReturn unchecked_external_method(OSObject* target, void*, IOExternalMethodArguments* arguments)
+		{
+			assert(OSDynamicCast(UCC, target) != nullptr);
+			UCC* uc = static_cast<UCC*>(target);
+			if (is_async_method<Args...>::value && (arguments->asyncWakePort == MACH_PORT_NULL || arguments->asyncReference == nullptr || arguments->asyncReferenceCount == 0))
+				return kIOReturnBadArgument;
+			return apply_fn(uc, arguments, typename gen_arg_seq<Args...>::type());
+		}
+		
 		constexpr static const IOExternalMethodDispatch dispatch = {
 			external_method,
 			inputs,
@@ -541,606 +1087,276 @@ namespace
 			outputs,
 			struct_output_size
 		};
-#else
-		template <IOExternalMethodAction action, uint32_t num_inputs, uint32_t num_outputs, uint32_t input_size, uint32_t output_size>
-			struct IOExternalMethodDispatchGenerator
+		
+		/* Dispatch entry for tables only ever dispatched with a CLIENT_CLASS
+		 * target, i.e. via djt_dispatch_methods() from CLIENT_CLASS's own
+		 * externalMethod(). The class relationship is checked once, when the
+		 * table is compiled, rather than on every call. */
+		template <class CLIENT_CLASS> constexpr static IOExternalMethodDispatch fast_dispatch()
 		{
-			constexpr operator IOExternalMethodDispatch() const
-			{
-				return (IOExternalMethodDispatch){ action, num_inputs, input_size, num_outputs, output_size };
-			}
-		};
-
-		static const IOExternalMethodDispatchGenerator<external_method, inputs, outputs, struct_input_size, struct_output_size> dispatch;
-#endif
-	};
-#else
-	template <typename MethodPointerSignature, MethodPointerSignature METHOD> struct userclient_method;
-	
-	struct EmptyTypeList;
-	template <typename T, typename REST>
-		struct TypeListItem
-	{
-		typedef T first;
-		typedef REST rest;
-	};
-	
-	template <typename ArgumentTypeList> struct scalar_input_arg_count;
-	// termination condition
-	template <> struct scalar_input_arg_count<EmptyTypeList>
-	{
-		static const unsigned count = 0;
-	};
-	// ignore output scalar
-	template<typename REST>
-		struct scalar_input_arg_count<TypeListItem<uint64_t*, REST> > {
-			static const int count = scalar_input_arg_count<REST>::count;
-		};
-	// ignore variable sized input struct
-	template<typename REST>
-		struct scalar_input_arg_count<TypeListItem<const void*, TypeListItem<size_t, REST> > > {
-			static const int count = scalar_input_arg_count<REST>::count;
-		};
-	// ignore variable sized output struct
-	template<typename REST>
-		struct scalar_input_arg_count<TypeListItem<void*, TypeListItem<size_t, REST > > > {
-			static const int count = scalar_input_arg_count<REST>::count;
-		};
-	// ignore output struct
-	template<typename STRUCT_T, typename REST>
-	struct scalar_input_arg_count<TypeListItem<STRUCT_T*, REST> > {
-			static const int count = scalar_input_arg_count<REST>::count;
-	};
-	// ignore the async argument triple
-	template<typename REST>
-	struct scalar_input_arg_count<TypeListItem<mach_port_t, TypeListItem<io_user_reference_t*, TypeListItem<uint32_t, REST> > > > {
-		static const int count = scalar_input_arg_count<REST>::count;
-	};
-	// everything else must be a scalar input
-	template<typename T, typename REST>
-	struct scalar_input_arg_count<TypeListItem<T, REST> > {
-			static const int count = 1 + scalar_input_arg_count<REST>::count;
+			static_assert(__is_base_of(UCC, CLIENT_CLASS), "Method must belong to the user client class or one of its superclasses");
+			return IOExternalMethodDispatch {
+				unchecked_external_method,
+				inputs,
+				struct_input_size,
+				outputs,
+				struct_output_size
+			};
+		}
 	};
 
-
-	template <typename ArgumentTypeList> struct scalar_output_arg_count;
-	template <> struct scalar_output_arg_count<EmptyTypeList>
+	/* Whether a method pointer's parameter list matches a plain function type, as
+	 * used by the user space proxies in djt_iouc_client.hpp. */
+	template <typename MethodPointerSignature, typename Signature> struct djt_iouc_method_has_signature
 	{
-		static const unsigned count = 0;
-	};
-
-	template<typename REST>
-		struct scalar_output_arg_count<TypeListItem<uint64_t*, REST> > {
-			static const int count = 1 + scalar_output_arg_count<REST>::count;
-	};
-	template<typename T, typename REST>
-		struct scalar_output_arg_count<TypeListItem<T, REST> > {
-			static const int count = scalar_output_arg_count<REST>::count;
-	};
-	// ignore the async argument triple
-	template<typename REST>
-		struct scalar_output_arg_count<TypeListItem<mach_port_t, TypeListItem<io_user_reference_t*, TypeListItem<uint32_t, REST> > > > {
-			static const int count = scalar_output_arg_count<REST>::count;
-	};
-
-	template<typename REST> struct is_async_method;
-
-	// termination condition for non-async methods
-	template<> struct is_async_method<EmptyTypeList> {
 		static const bool value = false;
 	};
-	
-	template<typename REST> struct is_async_method<TypeListItem<mach_port_t, TypeListItem<io_user_reference_t*, TypeListItem<uint32_t, REST> > > > {
-		static const bool value = true;
-	};
-	template<typename T, typename REST> struct is_async_method<TypeListItem<T, REST> > {
-		static const bool value = is_async_method<REST>::value;
-	};
-
-
-	template<typename ArgumentTypeList> struct struct_input_arg_size;
-	template<>
-	struct struct_input_arg_size<EmptyTypeList> {
-			static const unsigned size = 0;
-	};
-	template<typename RestTypeList>
-	struct struct_input_arg_size<TypeListItem<const void*, TypeListItem<size_t, RestTypeList> > > {
-		static_assert(struct_input_arg_size<RestTypeList>::size == 0,"Only one struct input allowed.");
-			static const int size = kIOUCVariableStructureSize;
-	};
-	template<typename T, typename RestTypeList>
-		struct struct_input_arg_size<TypeListItem<const T*, RestTypeList> > {
-			static_assert(struct_input_arg_size<RestTypeList>::size == 0,"Only one struct input allowed.");
-			static const int size = sizeof(T);
-			static_assert(size != 0,"zero-sized input structs not allowed");
-		};
-	template<typename T, typename RestTypeList>
-	struct struct_input_arg_size<TypeListItem<T, RestTypeList> > {
-			static const int size = struct_input_arg_size<RestTypeList>::size;
-	};
-
-
-
-	template<typename ArgTypeList> struct struct_output_arg_size;
-	template<>
-	struct struct_output_arg_size<EmptyTypeList> {
-			static const unsigned size = 0;
-	};
-	template<typename RestArgTypeList>
-		struct struct_output_arg_size<TypeListItem<const void*, TypeListItem<size_t, RestArgTypeList> > > {
-			static const int size = struct_output_arg_size<RestArgTypeList>::size;
-		};
-	template<typename T, typename RestArgTypeList>
-		struct struct_output_arg_size<TypeListItem<const T*, RestArgTypeList> > {
-			static const int size = struct_output_arg_size<RestArgTypeList>::size;
-		};
-	// ignore the async argument triple
-	template<typename RestArgTypeList>
-		struct struct_output_arg_size<TypeListItem<mach_port_t, TypeListItem<io_user_reference_t*, TypeListItem<uint32_t, RestArgTypeList> > > > {
-			static const int size = struct_output_arg_size<RestArgTypeList>::size;
-		};
-
-	template<typename RestArgTypeList>
-	struct struct_output_arg_size<TypeListItem<void*, TypeListItem<size_t, RestArgTypeList> > > {
-		static_assert(struct_output_arg_size<RestArgTypeList>::size == 0,"Only one struct output allowed.");
-			static const int size = kIOUCVariableStructureSize;
-	};
-	template<typename T, typename RestArgTypeList>
-		struct struct_output_arg_size<TypeListItem<T*, RestArgTypeList> > {
-			static_assert(struct_output_arg_size<RestArgTypeList>::size == 0,"Only one struct output allowed.");
-			static const int size = sizeof(T);
-			static_assert(size != 0, "No zero-sized output struct types");
-		};
-	template<typename RestArgTypeList>
-	struct struct_output_arg_size<TypeListItem<uint64_t*, RestArgTypeList> > {
-			static const int size = struct_output_arg_size<RestArgTypeList>::size;
-	};
-	template<typename T, typename RestArgTypeList>
-	struct struct_output_arg_size<TypeListItem<T, RestArgTypeList> > {
-			static const int size = struct_output_arg_size<RestArgTypeList>::size;
-	};
-
-	
-	// Recursively invoked type; result will be in the 'seq' member type.
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARG_SEQ, typename REMAIN_ARGLIST>
-		struct arg_seq_accum;
-	
-	// The recurrence relation; current argument has type T and index NEXT_INPUT
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS, typename T, typename REMAIN_ARGLIST>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<T, REMAIN_ARGLIST> >
-	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT + 1, // increment index
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_scalar_input<T, NEXT_INPUT>, ARGSELS>, // create a new arg_sel and prepend it to the existing ones
-			REMAIN_ARGLIST // Drop 'T' from parameters
-			>::seq seq;
-	};
-
-	// The recurrence relation for fixed-sized struct inputs
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename T, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<const T*, REMAIN_ARGS> >
-	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_fixed_struct_input_ptr<T>, ARGSELS>, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop 'const T*' from parameters
-			>::seq seq;
-	};
-
-	// The recurrence relation for variable-sized struct inputs
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<const void*, TypeListItem<size_t, REMAIN_ARGS> > >
+	template <class UCC, typename... Args> struct djt_iouc_method_has_signature<IOReturn(UCC::*)(Args...), IOReturn(Args...)>
 	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_variable_struct_input_size, TypeListItem<arg_sel_variable_struct_input_ptr, ARGSELS> >, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop 'T' from parameters
-			>::seq seq;
+		static const bool value = true;
 	};
 
-	// The recurrence relation for variable-sized struct outputs
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<void*, TypeListItem<size_t, REMAIN_ARGS> > >
+	template <typename T, size_t N> constexpr size_t array_length(T(&)[N])
 	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_variable_struct_output_size, TypeListItem<arg_sel_variable_struct_output_ptr, ARGSELS> >, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop 'T' from parameters
-			>::seq seq;
-	};
-
-	// The recurrence relation for the async triple
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<mach_port_t, TypeListItem<io_user_reference_t*, TypeListItem<uint32_t, REMAIN_ARGS> > > >
+		return N;
+	}
+	
+	template <size_t NUM_SEL> IOReturn djt_dispatch_methods(
+		const IOExternalMethodDispatch (&methods)[NUM_SEL], IOUserClient* client, uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference)
 	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_async_ref_count, TypeListItem<arg_sel_async_ref, TypeListItem<arg_sel_async_mach_port, ARGSELS> > >, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop the triple from parameters
-			>::seq seq;
-	};
+		IOExternalMethodDispatch method_dispatch = {};
+		if (selector < array_length(methods) && methods[selector].function != nullptr)
+		{
+			method_dispatch = methods[selector];
+			dispatch = &method_dispatch;
+			target = client;
+		}
+		return client->IOUserClient::externalMethod(selector, arguments, dispatch, target, reference);
+	}
 
-	// The recurrence relation for scalar outputs
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<uint64_t*, REMAIN_ARGS> >
+	/* Dispatches one packed call in the djt_iouc_batch.h format through the
+	 * method table: 'payload' points at the entry's scalars and struct input,
+	 * which must be entry.scalar_input_count * 8 + entry.struct_input_size
+	 * bytes, and the result is written to 'result', which must have room for
+	 * djt_iouc_batch_result_size(&entry) bytes. The caller validates the entry
+	 * against DJT_IOUC_BATCH_MAX_SCALARS and its buffer sizes. */
+	inline IOReturn djt_dispatch_packed_call(
+		const IOExternalMethodDispatch* methods, size_t method_count, IOUserClient* client, void* reference,
+		const djt_iouc_batch_entry& entry, const uint8_t* payload, uint8_t* result)
 	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT + 1, // increment index
-			TypeListItem<arg_sel_scalar_output<NEXT_OUTPUT>, ARGSELS>, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop 'T' from parameters
-			>::seq seq;
-	};
-
-	// The recurrence relation for fixed-sized struct outputs
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename T, typename ARGSELS, typename REMAIN_ARGS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, TypeListItem<T*, REMAIN_ARGS> >
+		uint64_t scalars_in[DJT_IOUC_BATCH_MAX_SCALARS];
+		uint64_t scalars_out[DJT_IOUC_BATCH_MAX_SCALARS] = {};
+		// The payload may be in memory shared with the client: read the scalars once.
+		memcpy(scalars_in, payload, sizeof(uint64_t) * entry.scalar_input_count);
+		const uint8_t* struct_in = payload + sizeof(uint64_t) * entry.scalar_input_count;
+		uint8_t* struct_out = result + sizeof(djt_iouc_batch_result) + sizeof(uint64_t) * entry.scalar_output_count;
+		
+		IOExternalMethodArguments call = {};
+		call.version = kIOExternalMethodArgumentsCurrentVersion;
+		call.selector = entry.selector;
+		call.scalarInput = scalars_in;
+		call.scalarInputCount = entry.scalar_input_count;
+		call.structureInput = entry.struct_input_size > 0 ? struct_in : nullptr;
+		call.structureInputSize = entry.struct_input_size;
+		call.scalarOutput = scalars_out;
+		call.scalarOutputCount = entry.scalar_output_count;
+		call.structureOutput = entry.struct_output_size > 0 ? struct_out : nullptr;
+		call.structureOutputSize = entry.struct_output_size;
+		
+		djt_iouc_batch_result call_result = {};
+		if (entry.selector < method_count && methods[entry.selector].function != nullptr)
+		{
+			IOExternalMethodDispatch method_dispatch = methods[entry.selector];
+			call_result.result = client->IOUserClient::externalMethod(entry.selector, &call, &method_dispatch, client, reference);
+		}
+		else
+		{
+			call_result.result = kIOReturnBadArgument;
+		}
+		call_result.scalar_output_count = static_cast<uint16_t>(call.scalarOutputCount);
+		call_result.struct_output_size = call.structureOutputSize;
+		memcpy(result, &call_result, sizeof(call_result));
+		memcpy(result + sizeof(call_result), scalars_out, sizeof(uint64_t) * entry.scalar_output_count);
+		return call_result.result;
+	}
+	
+	/* Implementation of a batch selector: runs each entry of the packed batch in
+	 * the struct input (see djt_iouc_batch.h) through the corresponding entry of
+	 * 'methods', exactly as djt_dispatch_methods() would for an individual call,
+	 * and packs the results into the struct output. Call it from externalMethod
+	 * for a selector outside the 'methods' table, so batches can't nest.
+	 * Returns kIOReturnBadArgument if the batch is malformed or the output too
+	 * small; entries processed up to that point have their results written. */
+	template <size_t NUM_SEL> IOReturn djt_dispatch_batch(
+		const IOExternalMethodDispatch (&methods)[NUM_SEL], IOUserClient* client, IOExternalMethodArguments* arguments, void* reference)
 	{
-		typedef typename arg_seq_accum<
-			NEXT_INPUT,
-			NEXT_OUTPUT,
-			TypeListItem<arg_sel_fixed_struct_output_ptr<T>, ARGSELS>, // create a new arg_sel and append it to the existing ones
-			REMAIN_ARGS // Drop 'T' from parameters
-			>::seq seq;
-	};
+		IOMemoryMap* in_map = nullptr;
+		IOMemoryMap* out_map = nullptr;
+		map_struct_arguments(in_map, out_map, arguments);
+		
+		const uint8_t* in = static_cast<const uint8_t*>(arguments->structureInput);
+		uint8_t* out = static_cast<uint8_t*>(arguments->structureOutput);
+		const uint64_t in_size = arguments->structureInputSize;
+		const uint64_t out_size = arguments->structureOutputSize;
+		djt_iouc_batch_header header = {};
+		IOReturn batch_result = kIOReturnSuccess;
+		uint64_t in_pos = sizeof(header), out_pos = sizeof(header);
+		uint32_t done = 0;
+		
+		if (in == nullptr || out == nullptr || in_size < sizeof(header) || out_size < sizeof(header))
+		{
+			batch_result = kIOReturnBadArgument;
+		}
+		else
+		{
+			// The batch may be in memory shared with the client: read each part once.
+			memcpy(&header, in, sizeof(header));
+			for (; done < header.count; ++done)
+			{
+				djt_iouc_batch_entry entry;
+				if (in_size - in_pos < sizeof(entry))
+				{
+					batch_result = kIOReturnBadArgument;
+					break;
+				}
+				memcpy(&entry, in + in_pos, sizeof(entry));
+				if (entry.scalar_input_count > DJT_IOUC_BATCH_MAX_SCALARS || entry.scalar_output_count > DJT_IOUC_BATCH_MAX_SCALARS
+					|| djt_iouc_batch_entry_size(&entry) > in_size - in_pos
+					|| djt_iouc_batch_result_size(&entry) > out_size - out_pos)
+				{
+					batch_result = kIOReturnBadArgument;
+					break;
+				}
+				
+				IOReturn result = djt_dispatch_packed_call(
+					methods, array_length(methods), client, reference, entry, in + in_pos + sizeof(entry), out + out_pos);
+				
+				in_pos += djt_iouc_batch_entry_size(&entry);
+				out_pos += djt_iouc_batch_result_size(&entry);
+				if (result != kIOReturnSuccess && (header.flags & DJT_IOUC_BATCH_STOP_ON_ERROR))
+				{
+					++done;
+					break;
+				}
+			}
+			header.count = done;
+			memcpy(out, &header, sizeof(header));
+			arguments->structureOutputSize = static_cast<uint32_t>(out_pos);
+		}
+		
+		OSSafeReleaseNULL(in_map);
+		OSSafeReleaseNULL(out_map);
+		return batch_result;
+	}
 
-	// Termination condition
-	template <int NEXT_INPUT, int NEXT_OUTPUT, typename ARGSELS>
-		struct arg_seq_accum<NEXT_INPUT, NEXT_OUTPUT, ARGSELS, EmptyTypeList>
+#if __cplusplus >= 201703L
+	template <size_t... I> struct djt_index_seq
+	{};
+	template <size_t N, size_t... I> struct djt_make_index_seq : djt_make_index_seq<N - 1, N - 1, I...>
+	{};
+	template <size_t... I> struct djt_make_index_seq<0, I...>
 	{
-		typedef ARGSELS seq;
+		typedef djt_index_seq<I...> type;
 	};
 	
-	template <typename TYPELIST, typename REVERSED = EmptyTypeList> struct reverse_typelist;
-	template <typename REVERSED> struct reverse_typelist<EmptyTypeList, REVERSED> 
-	{
-		typedef REVERSED type;
-	};
-	template <typename T, typename REST, typename REVERSED> struct reverse_typelist<TypeListItem<T, REST>, REVERSED>
-	{
-		typedef typename reverse_typelist<REST, TypeListItem<T, REVERSED> >::type type;
-	};
+	template <auto VALUE> struct djt_iouc_value_tag
+	{};
 	
-	// This is really just a convenience for starting the accumulator off with the right initial conditions
-	template <typename ARGS> struct gen_arg_seq
+	// The checks IOUserClient::externalMethod() applies to a dispatch entry before calling it
+	inline bool djt_check_method_arguments(const IOExternalMethodDispatch& dispatch, const IOExternalMethodArguments* arguments)
 	{
-		// start with an empty arg_sel sequence, index 0, and all parameters remaining
-		typedef typename reverse_typelist<typename arg_seq_accum<0, 0, EmptyTypeList, ARGS>::seq>::type type;
-	};
-	
-	template <typename TYPE_LIST, unsigned index> struct TypeListItemIndex;
+		if (dispatch.checkScalarInputCount != kIOUCVariableStructureSize
+			&& dispatch.checkScalarInputCount != arguments->scalarInputCount)
+			return false;
+		if (dispatch.checkStructureInputSize != kIOUCVariableStructureSize
+			&& dispatch.checkStructureInputSize != (arguments->structureInputDescriptor != nullptr
+				? arguments->structureInputDescriptor->getLength() : arguments->structureInputSize))
+			return false;
+		if (dispatch.checkScalarOutputCount != kIOUCVariableStructureSize
+			&& dispatch.checkScalarOutputCount != arguments->scalarOutputCount)
+			return false;
+		if (dispatch.checkStructureOutputSize != kIOUCVariableStructureSize
+			&& dispatch.checkStructureOutputSize != (arguments->structureOutputDescriptor != nullptr
+				? arguments->structureOutputDescriptor->getLength() : arguments->structureOutputSize))
+			return false;
+		return true;
+	}
 	
-	template <typename T, typename REST_TYPE_LIST> struct TypeListItemIndex<TypeListItem<T, REST_TYPE_LIST>, 0>
-	{
-		typedef T type;
-	};
-	template <typename T, typename REST, unsigned index> struct TypeListItemIndex<TypeListItem<T, REST>, index>
-	{
-		typedef typename TypeListItemIndex<REST, index - 1>::type type;
-	};
-		
-	template <class UCC, IOReturn(UCC::*METHOD)()>
-		struct userclient_method<IOReturn(UCC::*)(), METHOD>
+	/* Method table generated from a list of member function pointers, whose
+	 * order defines the selectors. Usually instantiated from an X-macro list via
+	 * DJT_IOUC_METHOD_TABLE, so the selector enum (see djt_iouc_selectors.h)
+	 * can't get out of step. Provides:
+	 *  - methods: the constexpr IOExternalMethodDispatch array, as built with
+	 *    DJT_IOUC_METHOD, e.g. for djt_dispatch_methods() or djt_dispatch_batch();
+	 *  - fast_methods<CLIENT_CLASS>: the same with DJT_IOUC_FAST_METHOD entries;
+	 *  - selector<&Class::method>(): a method's selector, at compile time;
+	 *  - dispatch_method(): a dispatcher for externalMethod() which compiles to
+	 *    a switch over the selector, checks arguments as IOUserClient would and
+	 *    calls each method's shim directly, so the compiler can inline it. Out
+	 *    of range selectors are passed on to IOUserClient::externalMethod(). */
+	template <auto... METHODS> struct djt_iouc_method_table
 	{
-		typedef EmptyTypeList argument_types;
-		typedef typename gen_arg_seq<argument_types>::type gen_args;
-		static const unsigned inputs = scalar_input_arg_count<argument_types>::count;
-		static const unsigned outputs = scalar_output_arg_count<argument_types>::count;
-		static const uint32_t struct_input_size = struct_input_arg_size<argument_types>::size;
-		static const uint32_t struct_output_size = struct_output_arg_size<argument_types>::size;
-		static const bool is_async = is_async_method<argument_types>::value;
+		static_assert(sizeof...(METHODS) > 0, "Method table must not be empty");
+		static constexpr uint32_t count = sizeof...(METHODS);
 		
-			static IOReturn apply_fn(UCC* target, IOExternalMethodArguments* arguments)
-			{
-				IOMemoryMap* in_map = nullptr;
-				IOMemoryMap* out_map = nullptr;
-				IOReturn result = map_struct_arguments(in_map, out_map, arguments);
-				if (result != kIOReturnSuccess)
-					return result;
-				result = (target->*METHOD)();
-				OSSafeReleaseNULL(in_map);
-				OSSafeReleaseNULL(out_map);
-				return result;
-			}
+		static constexpr IOExternalMethodDispatch methods[] = {
+			userclient_method<decltype(METHODS), METHODS>::dispatch...
+		};
+		template <class CLIENT_CLASS> static constexpr IOExternalMethodDispatch fast_methods[] = {
+			userclient_method<decltype(METHODS), METHODS>::template fast_dispatch<CLIENT_CLASS>()...
+		};
 		
-		static IOReturn external_method(OSObject* target, void* reference, IOExternalMethodArguments* arguments)
+		template <auto METHOD> static constexpr uint32_t selector()
 		{
-			UCC* uc = OSDynamicCast(UCC, target);
-			if (!uc)
-				return kIOReturnBadArgument;
-			if (is_async_method<argument_types>::value && (arguments->asyncWakePort == MACH_PORT_NULL || arguments->asyncReference == nullptr || arguments->asyncReferenceCount == 0))
-				return kIOReturnBadArgument;
-			return apply_fn(uc, arguments);
+			constexpr uint32_t index = index_of<METHOD>();
+			static_assert(index < count, "method not in table");
+			return index;
 		}
-
 		
-		static IOExternalMethodDispatch get_dispatch()
+		template <class CLIENT_CLASS> static IOReturn dispatch_method(
+			CLIENT_CLASS* client, uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference)
 		{
-			return (IOExternalMethodDispatch){ external_method, inputs, 0, outputs, 0 };
+			return dispatch_indexed(client, selector, arguments, dispatch, target, reference, typename djt_make_index_seq<count>::type());
 		}
-	};
-	template <class UCC, typename AT1, IOReturn(UCC::*METHOD)(AT1)>
-		struct userclient_method<IOReturn(UCC::*)(AT1), METHOD>
-	{
-		typedef TypeListItem<AT1, EmptyTypeList> argument_types;
-		typedef typename gen_arg_seq<argument_types>::type gen_args;
-		static const unsigned inputs = scalar_input_arg_count<argument_types>::count;
-		static const unsigned outputs = scalar_output_arg_count<argument_types>::count;
-		static const uint32_t struct_input_size = struct_input_arg_size<argument_types>::size;
-		static const uint32_t struct_output_size = struct_output_arg_size<argument_types>::size;
-		static const bool is_async = is_async_method<argument_types>::value;
 		
-			static IOReturn apply_fn(UCC* target, IOExternalMethodArguments* arguments)
-			{
-				IOMemoryMap* in_map = nullptr;
-				IOMemoryMap* out_map = nullptr;
-				IOReturn result = map_struct_arguments(in_map, out_map, arguments);
-				if (result != kIOReturnSuccess)
-					return result;
-				result = (target->*METHOD)(get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments));
-				OSSafeReleaseNULL(in_map);
-				OSSafeReleaseNULL(out_map);
-				return result;
-			}
+	private:
+		// count if METHOD is not in the table
+		template <auto METHOD> static constexpr uint32_t index_of()
+		{
+			constexpr bool matches[] = { __is_same(djt_iouc_value_tag<METHOD>, djt_iouc_value_tag<METHODS>)... };
+			uint32_t index = 0;
+			while (index < count && !matches[index])
+				++index;
+			return index;
+		}
 		
-		static IOReturn external_method(OSObject* target, void* reference, IOExternalMethodArguments* arguments)
+		template <class CLIENT_CLASS, auto METHOD> static IOReturn call_method(CLIENT_CLASS* client, void* reference, IOExternalMethodArguments* arguments)
 		{
-			UCC* uc = OSDynamicCast(UCC, target);
-			if (!uc)
+			typedef userclient_method<decltype(METHOD), METHOD> method;
+			constexpr IOExternalMethodDispatch entry = method::template fast_dispatch<CLIENT_CLASS>();
+			if (!djt_check_method_arguments(entry, arguments))
 				return kIOReturnBadArgument;
-			if (is_async_method<argument_types>::value && (arguments->asyncWakePort == MACH_PORT_NULL || arguments->asyncReference == nullptr || arguments->asyncReferenceCount == 0))
-				return kIOReturnBadArgument;
-			return apply_fn(uc, arguments);
+			return method::unchecked_external_method(client, reference, arguments);
 		}
-
 		
-		static IOExternalMethodDispatch get_dispatch()
+		template <class CLIENT_CLASS, size_t... I> static IOReturn dispatch_indexed(
+			CLIENT_CLASS* client, uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference,
+			djt_index_seq<I...>)
 		{
-			return (IOExternalMethodDispatch){ external_method, inputs, struct_input_size, outputs, struct_output_size };
+			IOReturn result = kIOReturnBadArgument;
+			bool handled = ((selector == I && (result = call_method<CLIENT_CLASS, METHODS>(client, reference, arguments), true)) || ...);
+			if (!handled)
+				result = client->IOUserClient::externalMethod(selector, arguments, dispatch, target, reference);
+			return result;
 		}
 	};
 	
-	#define UC_METHOD_PROPERTY_DEFS \
-		typedef typename gen_arg_seq<argument_types>::type gen_args; \
-		static const unsigned inputs = scalar_input_arg_count<argument_types>::count; \
-		static const unsigned outputs = scalar_output_arg_count<argument_types>::count; \
-		static const uint32_t struct_input_size = struct_input_arg_size<argument_types>::size; \
-		static const uint32_t struct_output_size = struct_output_arg_size<argument_types>::size; \
-		static const bool is_async = is_async_method<argument_types>::value;
-
-	#define UC_METHOD_APPLY_DEF(...) \
-			static IOReturn apply_fn(UCC* target, IOExternalMethodArguments* arguments) \
-			{ \
-				IOMemoryMap* in_map = nullptr; \
-				IOMemoryMap* out_map = nullptr; \
-				IOReturn result = map_struct_arguments(in_map, out_map, arguments); \
-				if (result != kIOReturnSuccess) \
-					return result; \
-				result = (target->*METHOD)(__VA_ARGS__); \
-				OSSafeReleaseNULL(in_map); \
-				OSSafeReleaseNULL(out_map); \
-				return result; \
-			} \
-		static IOReturn external_method(OSObject* target, void* reference, IOExternalMethodArguments* arguments) \
-		{ \
-			UCC* uc = OSDynamicCast(UCC, target); \
-			if (!uc) \
-				return kIOReturnBadArgument; \
-			if (is_async_method<argument_types>::value && (arguments->asyncWakePort == MACH_PORT_NULL || arguments->asyncReference == nullptr || arguments->asyncReferenceCount == 0)) \
-				return kIOReturnBadArgument; \
-			return apply_fn(uc, arguments); \
-		} \
-		static IOExternalMethodDispatch get_dispatch() \
-		{ \
-			return (IOExternalMethodDispatch){ external_method, inputs, struct_input_size, outputs, struct_output_size }; \
-		}
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			IOReturn(UCC::*METHOD)(AT1, AT2)>
-		struct userclient_method<IOReturn(UCC::*)(AT1, AT2), METHOD>
+	// Helper for DJT_IOUC_METHOD_TABLE, which can't avoid a leading comma.
+	template <int, auto... METHODS> struct djt_iouc_method_list
 	{
-		typedef TypeListItem<AT1, TypeListItem<AT2, EmptyTypeList> > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments))
-		
+		typedef djt_iouc_method_table<METHODS...> table;
 	};
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			IOReturn(UCC::*METHOD)(AT1, AT2, AT3)>
-		struct userclient_method<IOReturn(UCC::*)(AT1, AT2, AT3), METHOD>
-	{
-		typedef TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, EmptyTypeList> > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments)
-			)
-		
-	};
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			typename AT4,
-			IOReturn(UCC::*METHOD)(
-				AT1, AT2, AT3, AT4
-				)>
-		struct userclient_method<IOReturn(UCC::*)(
-			AT1, AT2, AT3, AT4
-			), METHOD>
-	{
-		typedef
-			TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, TypeListItem<AT4, EmptyTypeList> > > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 3>::type>(arguments)
-			)		
-	};
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			typename AT4,
-			typename AT5,
-			IOReturn(UCC::*METHOD)(
-				AT1, AT2, AT3, AT4, AT5
-				)>
-		struct userclient_method<IOReturn(UCC::*)(
-			AT1, AT2, AT3, AT4, AT5
-			), METHOD>
-	{
-		typedef
-			TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, TypeListItem<AT4, TypeListItem<AT5, EmptyTypeList> > > > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 3>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 4>::type>(arguments)
-			)		
-	};
-
-
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			typename AT4,
-			typename AT5,
-			typename AT6,
-			IOReturn(UCC::*METHOD)(
-				AT1, AT2, AT3, AT4, AT5, AT6
-				)>
-		struct userclient_method<IOReturn(UCC::*)(
-			AT1, AT2, AT3, AT4, AT5, AT6
-			), METHOD>
-	{
-		typedef
-			TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, TypeListItem<AT4, TypeListItem<AT5, TypeListItem<AT6, EmptyTypeList> > > > > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 3>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 4>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 5>::type>(arguments)
-			)		
-	};
-
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			typename AT4,
-			typename AT5,
-			typename AT6,
-			typename AT7,
-			IOReturn(UCC::*METHOD)(
-				AT1, AT2, AT3, AT4, AT5, AT6, AT7
-				)>
-		struct userclient_method<IOReturn(UCC::*)(
-			AT1, AT2, AT3, AT4, AT5, AT6, AT7
-			), METHOD>
-	{
-		typedef
-			TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, TypeListItem<AT4, TypeListItem<AT5, TypeListItem<AT6, TypeListItem<AT7, EmptyTypeList> > > > > > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 3>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 4>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 5>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 6>::type>(arguments)
-			)		
-	};
-
-
-	template <
-			class UCC,
-			typename AT1,
-			typename AT2,
-			typename AT3,
-			typename AT4,
-			typename AT5,
-			typename AT6,
-			typename AT7,
-			typename AT8,
-			IOReturn(UCC::*METHOD)(
-				AT1, AT2, AT3, AT4, AT5, AT6, AT7, AT8
-				)>
-		struct userclient_method<IOReturn(UCC::*)(
-			AT1, AT2, AT3, AT4, AT5, AT6, AT7, AT8
-			), METHOD>
-	{
-		typedef
-			TypeListItem<AT1, TypeListItem<AT2, TypeListItem<AT3, TypeListItem<AT4, TypeListItem<AT5, TypeListItem<AT6, TypeListItem<AT7, TypeListItem<AT8, EmptyTypeList> > > > > > > > argument_types;
-		UC_METHOD_PROPERTY_DEFS
-		UC_METHOD_APPLY_DEF(
-			get_element<typename TypeListItemIndex<gen_args, 0>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 1>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 2>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 3>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 4>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 5>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 6>::type>(arguments),
-			get_element<typename TypeListItemIndex<gen_args, 7>::type>(arguments)
-			)		
-	};
-
-
-#endif
-
-#if (__cplusplus >= 201103L)
-	template <typename T, size_t N> constexpr size_t array_length(T(&a)[N])
-	{
-		return N;
-	}
-#else
-	#define array_length(A) (sizeof((A)[0])/sizeof(A))
 #endif
-	
-	template <size_t NUM_SEL> IOReturn djt_dispatch_methods(
-		const IOExternalMethodDispatch (&methods)[NUM_SEL], IOUserClient* client, uint32_t selector, IOExternalMethodArguments* arguments, IOExternalMethodDispatch* dispatch, OSObject* target, void* reference)
-	{
-		IOExternalMethodDispatch method_dispatch = {};
-		if (selector < array_length(methods) && methods[selector].function != nullptr)
-		{
-			method_dispatch = methods[selector];
-			dispatch = &method_dispatch;
-			target = client;
-		}
-		return client->IOUserClient::externalMethod(selector, arguments, dispatch, target, reference);
-	}
 
 }
 
@@ -1148,3 +1364,18 @@ const void* dj_iouserclient_map_input_struct(
 	IOExternalMethodArguments* args, IOMemoryMap*& out_map, uint32_t& out_size);
 
 #define DJT_IOUC_METHOD(METHOD) userclient_method<decltype(&METHOD), &METHOD>::dispatch
+// Fails to compile unless METHOD's parameters match the user space SIGNATURE (see djt_iouc_client.hpp)
+#define DJT_IOUC_CHECK_SIGNATURE(METHOD, SIGNATURE) \
+	static_assert(djt_iouc_method_has_signature<decltype(&METHOD), SIGNATURE>::value, #METHOD " does not match " #SIGNATURE)
+/* Like DJT_IOUC_METHOD, but skips the per-call OSDynamicCast of the target. The
+ * table must only be used by djt_dispatch_methods() (or djt_dispatch_batch())
+ * called from CLIENT_CLASS, which always passes the client as the target;
+ * building it fails to compile if METHOD isn't a CLIENT_CLASS method. */
+#define DJT_IOUC_FAST_METHOD(CLIENT_CLASS, METHOD) userclient_method<decltype(&METHOD), &METHOD>::template fast_dispatch<CLIENT_CLASS>()
+/* Method table type from an X-macro method list (see djt_iouc_selectors.h),
+ * e.g. in the user client's externalMethod():
+ *   typedef DJT_IOUC_METHOD_TABLE(MY_USER_CLIENT_METHODS) methods;
+ *   static_assert(methods::count == kMyUserClientSelectorCount, "");
+ *   return methods::dispatch_method(this, selector, arguments, dispatch, target, reference); */
+#define DJT_IOUC_METHOD_TABLE_ENTRY(CLASS, METHOD) , &CLASS::METHOD
+#define DJT_IOUC_METHOD_TABLE(LIST) djt_iouc_method_list<0 LIST(DJT_IOUC_METHOD_TABLE_ENTRY)>::table
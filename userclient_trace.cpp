@@ -0,0 +1,95 @@
+/*
+Kextgizmo IOUserClient dispatch tracing.
+
+
+Dual-licensed under the MIT and zLib licenses.
+
+
+Copyright 2026 Phillip & Laura Dennis-Jordan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+
+Copyright (c) 2026 Phillip & Laura Dennis-Jordan
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use
+of this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject
+to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim
+that you wrote the original software. If you use this software in a product,
+an acknowledgment in the product documentation would be appreciated but is not
+required.
+
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+#include <IOKit/IOUserClient.h>
+#include "userclient.hpp"
+
+#ifdef DJT_IOUC_TRACE
+
+djt_iouc_trace_ring djt_iouc_trace_buffer;
+
+IOReturn djt_iouc_trace_export(IOExternalMethodArguments* arguments)
+{
+	if (arguments->scalarOutputCount != 1
+	    || (arguments->structureOutputSize > 0 && arguments->structureOutput == nullptr))
+		return kIOReturnBadArgument;
+	
+	uint64_t next = __atomic_load_n(&djt_iouc_trace_buffer.next_sequence, __ATOMIC_ACQUIRE);
+	arguments->scalarOutput[0] = next;
+	
+	uint64_t available = next < DJT_IOUC_TRACE_RING_SIZE ? next : DJT_IOUC_TRACE_RING_SIZE;
+	uint64_t max_records = arguments->structureOutputSize / sizeof(djt_iouc_trace_record);
+	if (available > max_records)
+		available = max_records;
+	
+	djt_iouc_trace_record* export_records = static_cast<djt_iouc_trace_record*>(arguments->structureOutput);
+	uint32_t exported = 0;
+	for (uint64_t sequence = next - available + 1; sequence <= next; ++sequence)
+	{
+		const djt_iouc_trace_record* record = &djt_iouc_trace_buffer.records[(sequence - 1) % DJT_IOUC_TRACE_RING_SIZE];
+		djt_iouc_trace_record copy = *record;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		// Skip slots being (re)written concurrently
+		if (copy.sequence != sequence || __atomic_load_n(&record->sequence, __ATOMIC_RELAXED) != sequence)
+			continue;
+		absolutetime_to_nanoseconds(copy.latency_ns, &copy.latency_ns);
+		export_records[exported++] = copy;
+	}
+	arguments->structureOutputSize = exported * static_cast<uint32_t>(sizeof(djt_iouc_trace_record));
+	return kIOReturnSuccess;
+}
+#else
+IOReturn djt_iouc_trace_export(IOExternalMethodArguments*)
+{
+	return kIOReturnUnsupported;
+}
+#endif